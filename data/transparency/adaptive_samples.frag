@@ -0,0 +1,22 @@
+#version 150 core
+
+uniform usampler2D tileCoverageTexture;
+uniform int tileSize;
+uniform bool adaptiveSamples;
+uniform uint adaptiveFragmentThreshold;
+uniform uint adaptiveNumSamples;
+
+
+// all samples, or only the first adaptiveNumSamples in tiles that hold few transparent fragments
+uint activeSamplesMask()
+{
+    if (!adaptiveSamples)
+        return 0xffffffffu;
+
+    uint numFragments = texelFetch(tileCoverageTexture, ivec2(gl_FragCoord.xy) / tileSize, 0).r;
+
+    if (numFragments > adaptiveFragmentThreshold)
+        return 0xffffffffu;
+
+    return (1u << adaptiveNumSamples) - 1u;
+}
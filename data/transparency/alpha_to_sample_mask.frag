@@ -0,0 +1,25 @@
+#version 150 core
+#extension GL_ARB_sample_shading : require
+#extension GL_ARB_explicit_attrib_location : require
+
+in vec3 v_normal;
+
+layout(location = 0) out vec4 fragColor;
+
+
+uint coverageMask();
+uint activeSamplesMask();
+
+void main()
+{
+    // each sample of the table or procedural mask is set with probability alpha, so is each sample of the subset
+    uint mask = coverageMask() & activeSamplesMask();
+
+    if (mask == 0u)
+        discard;
+
+    gl_SampleMask[0] = int(mask);
+
+    vec3 color = vec3(v_normal * 0.5 + 0.5);
+    fragColor = vec4(color, 1.0);
+}
@@ -8,7 +8,16 @@ layout (location = 0) out vec3 fragColor;
 uniform sampler2DMS opaqueColorTexture;
 uniform sampler2DMS totalAlphaTexture;
 uniform sampler2DMS transparentColorTexture;
-uniform int numSamples;
+uniform usampler2D tileCoverageTexture;
+uniform sampler2DMS opaqueDepthTexture;
+uniform int tileSize;
+uniform bool tileClassification;
+uniform int resolutionDivisor;
+uniform bool adaptiveSamples;
+uniform uint adaptiveFragmentThreshold;
+uniform int adaptiveNumSamples;
+
+const int numSamples = NUM_SAMPLES;
 
 
 vec4 filteredTexelFetch(in sampler2DMS texture, in ivec2 coordinate)
@@ -21,13 +30,94 @@ vec4 filteredTexelFetch(in sampler2DMS texture, in ivec2 coordinate)
     return texelSum / float(numSamples);
 }
 
+vec4 filteredTexelFetch(in sampler2DMS texture, in ivec2 coordinate, in int count)
+{
+    vec4 texelSum = vec4(0.0);
+
+    for (int i = 0; i < count; ++i)
+        texelSum += texelFetch(texture, coordinate, i);
+
+    return texelSum / float(count);
+}
+
+// the transparent passes only wrote the first adaptiveNumSamples in tiles with few transparent fragments
+int numTransparentSamples(in ivec2 coordinate)
+{
+    if (adaptiveSamples && texelFetch(tileCoverageTexture, coordinate / tileSize, 0).r <= adaptiveFragmentThreshold)
+        return adaptiveNumSamples;
+
+    return numSamples;
+}
+
+float opaqueDepth(in ivec2 coordinate)
+{
+    return texelFetch(opaqueDepthTexture, coordinate, 0).r;
+}
+
+// Joint bilateral upsampling of the reduced resolution transparency targets, guided by the full resolution opaque depth
+void upsampledTransparency(in ivec2 coordinate, out float complTotalAlpha, out vec4 transparentColor)
+{
+    ivec2 size = textureSize(totalAlphaTexture);
+    ivec2 fullSize = textureSize(opaqueDepthTexture);
+
+    vec2 position = (vec2(coordinate) + 0.5) / float(resolutionDivisor) - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = fract(position);
+
+    float depth = opaqueDepth(coordinate);
+
+    float weightSum = 0.0;
+    complTotalAlpha = 0.0;
+    transparentColor = vec4(0.0);
+
+    for (int y = 0; y < 2; ++y)
+    {
+        for (int x = 0; x < 2; ++x)
+        {
+            ivec2 texel = clamp(base + ivec2(x, y), ivec2(0), size - 1);
+            ivec2 center = min(texel * resolutionDivisor + resolutionDivisor / 2, fullSize - 1);
+
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float weight = bilinear / (1.0e-4 + abs(depth - opaqueDepth(center)));
+
+            int count = numTransparentSamples(texel * resolutionDivisor);
+
+            complTotalAlpha += filteredTexelFetch(totalAlphaTexture, texel, count).r * weight;
+            transparentColor += filteredTexelFetch(transparentColorTexture, texel, count) * weight;
+            weightSum += weight;
+        }
+    }
+
+    complTotalAlpha /= weightSum;
+    transparentColor /= weightSum;
+}
+
 void main()
 {
     ivec2 coordinate = ivec2(gl_FragCoord.xy);
 
     vec3 opaqueColor = filteredTexelFetch(opaqueColorTexture, coordinate).rgb;
-    float complTotalAlpha = filteredTexelFetch(totalAlphaTexture, coordinate).r;
-    vec4 transparentColor = filteredTexelFetch(transparentColorTexture, coordinate);
+
+    if (tileClassification && texelFetch(tileCoverageTexture, coordinate / tileSize, 0).r == 0u)
+    {
+        fragColor = opaqueColor;
+        return;
+    }
+
+    float complTotalAlpha;
+    vec4 transparentColor;
+
+    if (resolutionDivisor > 1)
+    {
+        upsampledTransparency(coordinate, complTotalAlpha, transparentColor);
+    }
+    else
+    {
+        int count = numTransparentSamples(coordinate);
+
+        complTotalAlpha = filteredTexelFetch(totalAlphaTexture, coordinate, count).r;
+        transparentColor = filteredTexelFetch(transparentColorTexture, coordinate, count);
+    }
 
     if (transparentColor.a != 0.0)
         fragColor = opaqueColor * complTotalAlpha + transparentColor.rgb * ((1.0 - complTotalAlpha) / transparentColor.a);
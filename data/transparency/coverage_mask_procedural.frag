@@ -0,0 +1,57 @@
+#version 150 core
+
+flat in float v_rand;
+
+uniform uint transparency;
+uniform uint numSamples;
+uniform float seed;
+
+
+uint hash(uint x)
+{
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+float unitFloat(uint x)
+{
+    return float(x >> 8u) / 16777216.0;
+}
+
+uint coverageMask()
+{
+    // depends on pixel and primitive only, so all sample invocations of a fragment agree on the mask
+    uvec2 pixel = uvec2(gl_FragCoord.xy);
+    uint state = hash(uint(fract(seed) * 16777216.0));
+    state = hash(uint(v_rand) ^ state);
+    state = hash(pixel.x ^ state);
+    state = hash(pixel.y ^ state);
+
+    // stochastic rounding keeps the expected coverage at exactly alpha
+    float expectedNumSamples = float(transparency) / 255.0 * float(numSamples);
+    uint numSetSamples = uint(expectedNumSamples);
+
+    state = hash(state);
+    if (unitFloat(state) < fract(expectedNumSamples))
+        ++numSetSamples;
+
+    // selection sampling, every combination of numSetSamples bits is equally likely
+    uint mask = 0u;
+
+    for (uint i = 0u; i < numSamples && numSetSamples > 0u; ++i)
+    {
+        state = hash(state);
+
+        if (unitFloat(state) * float(numSamples - i) < float(numSetSamples))
+        {
+            mask |= 1u << i;
+            --numSetSamples;
+        }
+    }
+
+    return mask;
+}
@@ -0,0 +1,33 @@
+#version 150 core
+
+flat in float v_rand;
+
+uniform uint transparency;
+uniform usampler2D masksTexture;
+uniform vec2 viewport;
+uniform float seed;
+
+
+float rand();
+
+uint coverageMask()
+{
+    ivec2 index = ivec2(rand() * 1023.0, transparency);
+    return texelFetch(masksTexture, index, 0).r;
+}
+
+highp float rand(vec2 co)
+{
+    highp float a = 12.9898;
+    highp float b = 78.233;
+    highp float c = 43758.5453;
+    highp float dt= dot(co.xy ,vec2(a,b));
+    highp float sn= mod(dt,3.14);
+    return fract(sin(sn) * c);
+}
+
+float rand()
+{
+    vec2 normFragCoord = floor(gl_FragCoord.xy) / viewport * v_rand;
+    return rand(normFragCoord.xy + seed);
+}
@@ -0,0 +1,12 @@
+#version 150 core
+#extension GL_ARB_shader_image_load_store : require
+
+layout(early_fragment_tests) in;
+
+layout(r32ui) uniform coherent uimage2D depthComplexityImage;
+
+
+void main()
+{
+    imageAtomicAdd(depthComplexityImage, ivec2(gl_FragCoord.xy), 1u);
+}
@@ -0,0 +1,40 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+in vec2 v_uv;
+
+layout(location = 0) out vec4 fragColor;
+
+uniform usampler2D depthComplexityTexture;
+uniform uint maxLayers;
+
+
+vec3 heat(float t)
+{
+    const vec3 colors[5] = vec3[5](
+        vec3(0.0, 0.0, 0.5),
+        vec3(0.0, 0.5, 1.0),
+        vec3(0.0, 0.9, 0.3),
+        vec3(1.0, 0.9, 0.0),
+        vec3(1.0, 0.0, 0.0));
+
+    float position = clamp(t, 0.0, 1.0) * 4.0;
+    int index = min(int(position), 3);
+
+    return mix(colors[index], colors[index + 1], position - float(index));
+}
+
+
+void main()
+{
+    ivec2 size = textureSize(depthComplexityTexture, 0);
+    uint layers = texelFetch(depthComplexityTexture, ivec2(v_uv * vec2(size)), 0).r;
+
+    if (layers == 0u)
+        fragColor = vec4(vec3(0.1), 1.0);
+    // white marks pixels beyond the scale
+    else if (layers > maxLayers)
+        fragColor = vec4(1.0);
+    else
+        fragColor = vec4(heat(float(layers - 1u) / float(max(maxLayers - 1u, 1u))), 1.0);
+}
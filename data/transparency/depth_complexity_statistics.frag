@@ -0,0 +1,54 @@
+#version 150 core
+#extension GL_ARB_shader_image_load_store : require
+
+const int tileSize = 8;
+const int numBuckets = 16;
+
+const int sumIndex = numBuckets;
+const int maxIndex = numBuckets + 1;
+const int coveredIndex = numBuckets + 2;
+
+layout(r32ui) uniform readonly uimage2D depthComplexityImage;
+layout(r32ui) uniform coherent uimage1D statisticsImage;
+
+uniform ivec2 size;
+
+
+void main()
+{
+    uint buckets[numBuckets];
+
+    for (int i = 0; i < numBuckets; ++i)
+        buckets[i] = 0u;
+
+    uint sum = 0u;
+    uint maxLayers = 0u;
+    uint covered = 0u;
+
+    // each fragment reduces a tile first, this keeps the number of atomics per frame small
+    ivec2 origin = ivec2(gl_FragCoord.xy) * tileSize;
+    ivec2 end = min(origin + ivec2(tileSize), size);
+
+    for (int y = origin.y; y < end.y; ++y)
+    {
+        for (int x = origin.x; x < end.x; ++x)
+        {
+            uint layers = imageLoad(depthComplexityImage, ivec2(x, y)).r;
+
+            ++buckets[min(layers, uint(numBuckets - 1))];
+            sum += layers;
+            maxLayers = max(maxLayers, layers);
+            covered += layers > 0u ? 1u : 0u;
+        }
+    }
+
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        if (buckets[i] > 0u)
+            imageAtomicAdd(statisticsImage, i, buckets[i]);
+    }
+
+    imageAtomicAdd(statisticsImage, sumIndex, sum);
+    imageAtomicMax(statisticsImage, maxIndex, maxLayers);
+    imageAtomicAdd(statisticsImage, coveredIndex, covered);
+}
@@ -0,0 +1,18 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+layout (location = 0) out vec4 fragColor;
+
+uniform sampler2D backColorTexture;
+
+
+void main()
+{
+    vec4 backColor = texelFetch(backColorTexture, ivec2(gl_FragCoord.xy), 0);
+
+    // discarded samples are not counted by the occlusion query, which ends peeling
+    if (backColor.a == 0.0)
+        discard;
+
+    fragColor = backColor;
+}
@@ -0,0 +1,19 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+layout (location = 0) out vec3 fragColor;
+
+uniform sampler2D opaqueColorTexture;
+uniform sampler2D frontColorTexture;
+
+
+void main()
+{
+    ivec2 coordinate = ivec2(gl_FragCoord.xy);
+
+    // the opaque color already holds all back layers
+    vec3 backColor = texelFetch(opaqueColorTexture, coordinate, 0).rgb;
+    vec4 frontColor = texelFetch(frontColorTexture, coordinate, 0);
+
+    fragColor = frontColor.rgb + backColor * (1.0 - frontColor.a);
+}
@@ -0,0 +1,10 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+layout(location = 0) out vec2 fragMinMaxDepth;
+
+
+void main()
+{
+    fragMinMaxDepth = vec2(-gl_FragCoord.z, gl_FragCoord.z);
+}
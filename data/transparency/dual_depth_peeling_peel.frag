@@ -0,0 +1,57 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+const float kMaxDepth = 1.0;
+
+in vec3 v_normal;
+
+layout(location = 0) out vec2 fragMinMaxDepth;
+layout(location = 1) out vec4 fragFrontColor;
+layout(location = 2) out vec4 fragBackColor;
+
+uniform sampler2D minMaxDepthTexture;
+uniform sampler2D frontColorTexture;
+
+uniform uint transparency;
+
+
+void main()
+{
+    ivec2 coordinate = ivec2(gl_FragCoord.xy);
+    float depth = gl_FragCoord.z;
+
+    vec2 minMaxDepth = texelFetch(minMaxDepthTexture, coordinate, 0).xy;
+    vec4 frontColor = texelFetch(frontColorTexture, coordinate, 0);
+
+    float nearestDepth = -minMaxDepth.x;
+    float farthestDepth = minMaxDepth.y;
+
+    // defaults are neutral under max blending, the front color is carried over into the current target
+    fragMinMaxDepth = vec2(-kMaxDepth);
+    fragFrontColor = frontColor;
+    fragBackColor = vec4(0.0);
+
+    // already peeled
+    if (depth < nearestDepth || depth > farthestDepth)
+        return;
+
+    // remaining layers, the nearest and farthest of them are peeled next
+    if (depth > nearestDepth && depth < farthestDepth)
+    {
+        fragMinMaxDepth = vec2(-depth, depth);
+        return;
+    }
+
+    float alpha = float(transparency) / 255.0;
+    vec3 color = vec3(v_normal * 0.5 + 0.5);
+
+    if (depth == nearestDepth)
+    {
+        fragFrontColor.rgb += color * alpha * (1.0 - frontColor.a);
+        fragFrontColor.a = 1.0 - (1.0 - frontColor.a) * (1.0 - alpha);
+    }
+    else
+    {
+        fragBackColor = vec4(color, alpha);
+    }
+}
@@ -0,0 +1,47 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+#extension GL_ARB_shader_image_load_store : require
+#extension GL_ARB_shader_atomic_counters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+
+layout(early_fragment_tests) in;
+
+in vec3 v_normal;
+
+struct Node
+{
+    vec4 color;
+    float depth;
+    uint next;
+    uint padding0;
+    uint padding1;
+};
+
+layout(std430, binding = 0) buffer NodeBuffer
+{
+    Node nodes[];
+};
+
+layout(binding = 0, offset = 0) uniform atomic_uint nodeCounter;
+
+layout(r32ui) uniform coherent uimage2D headPointerImage;
+
+uniform uint transparency;
+uniform uint nodeCapacity;
+
+
+void main()
+{
+    uint index = atomicCounterIncrement(nodeCounter);
+
+    // the counter keeps running so the painter can report the required capacity
+    if (index >= nodeCapacity)
+        return;
+
+    float alpha = float(transparency) / 255.0;
+
+    nodes[index].color = vec4(v_normal * 0.5 + 0.5, alpha);
+    nodes[index].depth = gl_FragCoord.z;
+    nodes[index].next = imageAtomicExchange(headPointerImage, ivec2(gl_FragCoord.xy), index);
+}
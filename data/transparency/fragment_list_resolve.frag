@@ -0,0 +1,111 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+#extension GL_ARB_shader_atomic_counters : require
+#extension GL_ARB_shader_image_load_store : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+
+const uint kEndOfList = 0xffffffffu;
+const int kMaxFragments = 64;
+
+in vec2 v_uv;
+
+layout(location = 0) out vec4 fragColor;
+
+struct Node
+{
+    vec4 color;
+    float depth;
+    uint next;
+    uint padding0;
+    uint padding1;
+};
+
+layout(std430, binding = 0) buffer NodeBuffer
+{
+    Node nodes[];
+};
+
+layout(binding = 0, offset = 4) uniform atomic_uint truncatedCounter;
+
+layout(r32ui) uniform readonly uimage2D headPointerImage;
+
+uniform sampler2D opaqueColorTexture;
+
+uniform bool kBuffer;
+uniform int k;
+uniform uint nodeCapacity;
+
+vec4 fragments[kMaxFragments];
+float depths[kMaxFragments];
+
+
+void main()
+{
+    int capacity = kBuffer ? clamp(k, 1, kMaxFragments) : kMaxFragments;
+    int count = 0;
+
+    // fragments that do not fit are blended unordered behind the sorted ones
+    vec3 tailColor = vec3(0.0);
+    float tailAlpha = 0.0;
+    float tailTransmittance = 1.0;
+    bool truncated = false;
+
+    uint index = imageLoad(headPointerImage, ivec2(gl_FragCoord.xy)).r;
+
+    while (index != kEndOfList && index < nodeCapacity)
+    {
+        vec4 color = nodes[index].color;
+        float depth = nodes[index].depth;
+        index = nodes[index].next;
+
+        // insertion sort, nearest first
+        int i = count;
+        if (count == capacity)
+        {
+            truncated = true;
+
+            if (depth >= depths[capacity - 1])
+            {
+                tailColor += color.rgb * color.a;
+                tailAlpha += color.a;
+                tailTransmittance *= 1.0 - color.a;
+                continue;
+            }
+
+            vec4 evicted = fragments[capacity - 1];
+            tailColor += evicted.rgb * evicted.a;
+            tailAlpha += evicted.a;
+            tailTransmittance *= 1.0 - evicted.a;
+
+            i = capacity - 1;
+        }
+        else
+        {
+            ++count;
+        }
+
+        for (; i > 0 && depths[i - 1] > depth; --i)
+        {
+            fragments[i] = fragments[i - 1];
+            depths[i] = depths[i - 1];
+        }
+
+        fragments[i] = color;
+        depths[i] = depth;
+    }
+
+    vec3 color = texture(opaqueColorTexture, v_uv).rgb;
+
+    // the k-buffer drops fragments by design, exact lists only when they exceed kMaxFragments
+    if (!kBuffer && truncated)
+        atomicCounterIncrement(truncatedCounter);
+
+    if (tailAlpha > 0.0)
+        color = tailColor / tailAlpha * (1.0 - tailTransmittance) + color * tailTransmittance;
+
+    for (int i = count - 1; i >= 0; --i)
+        color = fragments[i].rgb * fragments[i].a + color * (1.0 - fragments[i].a);
+
+    fragColor = vec4(color, 1.0);
+}
@@ -4,12 +4,16 @@
 layout(location = 0) in vec3 a_vertex;
 layout(location = 1) in vec3 a_normal;
 
+// dequantization of positions stored as 16 bit unorm, constant per mesh
+layout(location = 2) in vec3 a_vertexScale;
+layout(location = 3) in vec3 a_vertexOffset;
+
 out vec3 v_normal;
 
 uniform mat4 transform;
 
 void main()
 {
-	gl_Position = transform * vec4(a_vertex, 1.0);
+	gl_Position = transform * vec4(a_vertex * a_vertexScale + a_vertexOffset, 1.0);
     v_normal = a_normal;
 }
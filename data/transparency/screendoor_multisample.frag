@@ -17,12 +17,32 @@ void main()
     );
 
     ivec2 fragCoord = ivec2(mod(floor(gl_FragCoord.xy), 2));
+
+#if SAMPLE_MASK
+    // shaded once per pixel, the samples below the threshold are written through the sample mask
+    int mask = 0;
+
+    for (int sampleID = 0; sampleID < 4; ++sampleID)
+    {
+        ivec2 sampleCoord = ivec2((sampleID / 2), mod(sampleID, 2));
+        int index = (fragCoord.y * 2 + sampleCoord.y) * 4 + (fragCoord.x * 2 + sampleCoord.x);
+
+        if (thresholdMatrix[index] <= transparency)
+            mask |= 1 << sampleID;
+    }
+
+    if (mask == 0)
+        discard;
+
+    gl_SampleMask[0] = mask;
+#else
     ivec2 sampleCoord = ivec2((gl_SampleID / 2), mod(gl_SampleID, 2));
     int index = (fragCoord.y * 2 + sampleCoord.y) * 4 + (fragCoord.x * 2 + sampleCoord.x);
     float threshold = thresholdMatrix[index];
 
     if (threshold > transparency)
         discard;
+#endif
 
 	fragColor = vec4(v_normal * 0.5 + 0.5, 1.0);
 }
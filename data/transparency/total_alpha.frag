@@ -1,12 +1,28 @@
 #version 150 core
 #extension GL_ARB_explicit_attrib_location : require
+#extension GL_ARB_shader_image_load_store : require
+
+layout(early_fragment_tests) in;
 
 layout(location = 0) out float fragTransparency;
 
 uniform uint transparency;
+uniform int tileSize;
+uniform bool tileClassification;
+uniform bool adaptiveSamples;
+
+layout(r32ui) uniform uimage2D tileCoverageImage;
 
 
 void main()
 {
+    ivec2 tile = ivec2(gl_FragCoord.xy) / tileSize;
+
+    // the fragment count also classifies the tile, it is only zero where there is no transparent coverage
+    if (adaptiveSamples)
+        imageAtomicAdd(tileCoverageImage, tile, 1u);
+    else if (tileClassification)
+        imageStore(tileCoverageImage, tile, uvec4(1u));
+
     fragTransparency = float(transparency) / 255.0;
 }
@@ -0,0 +1,63 @@
+#version 150 core
+#extension GL_ARB_sample_shading : require
+#extension GL_ARB_gpu_shader5 : require
+#extension GL_ARB_post_depth_coverage : require
+#extension GL_ARB_explicit_attrib_location : require
+#extension GL_ARB_shader_image_load_store : require
+
+layout(early_fragment_tests) in;
+layout(post_depth_coverage) in;
+
+in vec3 v_normal;
+in vec4 v_position;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out float fragTransparency;
+
+uniform uint transparency;
+uniform sampler2DMS stochasticDepthTexture;
+uniform int tileSize;
+uniform bool tileClassification;
+uniform uint numSamples;
+uniform float depthEpsilon;
+
+layout(r32ui) uniform writeonly uimage2D tileCoverageImage;
+
+
+// Shaded once per pixel: the stochastic depth test is done for each covered sample here and the color
+// is weighted by the passing fraction, which the compositing resolves to the same average as per sample shading.
+void main()
+{
+    if (tileClassification)
+        imageStore(tileCoverageImage, ivec2(gl_FragCoord.xy) / tileSize, uvec4(1u));
+
+    float alpha = float(transparency) / 255.0;
+    fragTransparency = alpha;
+
+    int numCovered = 0;
+    int numPassed = 0;
+
+    for (int i = 0; i < int(numSamples); ++i)
+    {
+        if ((gl_SampleMaskIn[0] & (1 << i)) == 0)
+            continue;
+
+        vec4 position = interpolateAtSample(v_position, i);
+        float depth = position.z / position.w * 0.5 + 0.5;
+        float stochasticDepth = texelFetch(stochasticDepthTexture, ivec2(gl_FragCoord.xy), i).r;
+
+        ++numCovered;
+
+        if (depth <= stochasticDepth + depthEpsilon)
+            ++numPassed;
+    }
+
+    if (numPassed == 0)
+    {
+        fragColor = vec4(0.0);
+        return;
+    }
+
+    vec3 color = vec3(v_normal * 0.5 + 0.5);
+    fragColor = vec4(color * alpha, alpha) * (float(numPassed) / float(numCovered));
+}
@@ -0,0 +1,22 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+layout(location = 0) in vec3 a_vertex;
+layout(location = 1) in vec3 a_normal;
+
+// dequantization of positions stored as 16 bit unorm, constant per mesh
+layout(location = 2) in vec3 a_vertexScale;
+layout(location = 3) in vec3 a_vertexOffset;
+
+out vec3 v_normal;
+out vec4 v_position;
+
+uniform mat4 transform;
+
+
+void main()
+{
+    gl_Position = transform * vec4(a_vertex * a_vertexScale + a_vertexOffset, 1.0);
+    v_normal = a_normal;
+    v_position = gl_Position;
+}
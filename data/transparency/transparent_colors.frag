@@ -9,8 +9,13 @@ layout(location = 0) out vec4 fragColor;
 uniform uint transparency;
 
 
+uint activeSamplesMask();
+
 void main()
 {
+    // only accumulates into the samples the alpha to coverage pass could have written
+    gl_SampleMask[0] = int(activeSamplesMask());
+
     float alpha = float(transparency) / 255.0;
     vec3 color = vec3(v_normal * 0.5 + 0.5);
     fragColor = vec4(color * alpha, alpha);
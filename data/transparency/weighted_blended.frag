@@ -0,0 +1,22 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+in vec3 v_normal;
+
+layout(location = 0) out vec4 fragAccumulation;
+layout(location = 1) out float fragRevealage;
+
+uniform uint transparency;
+
+
+void main()
+{
+    float alpha = float(transparency) / 255.0;
+    vec3 color = vec3(v_normal * 0.5 + 0.5);
+
+    // depth weight favoring close fragments (McGuire and Bavoil 2013)
+    float weight = alpha * clamp(3.0e3 * pow(1.0 - gl_FragCoord.z, 3.0), 1.0e-2, 3.0e3);
+
+    fragAccumulation = vec4(color * alpha, alpha) * weight;
+    fragRevealage = alpha;
+}
@@ -0,0 +1,29 @@
+#version 150 core
+#extension GL_ARB_explicit_attrib_location : require
+
+in vec2 v_uv;
+
+layout (location = 0) out vec3 fragColor;
+
+uniform sampler2D opaqueColorTexture;
+uniform sampler2D accumulationTexture;
+uniform sampler2D revealageTexture;
+
+
+void main()
+{
+    ivec2 coordinate = ivec2(gl_FragCoord.xy);
+
+    vec3 opaqueColor = texelFetch(opaqueColorTexture, coordinate, 0).rgb;
+    vec4 accumulation = texelFetch(accumulationTexture, coordinate, 0);
+    float revealage = texelFetch(revealageTexture, coordinate, 0).r;
+
+    if (revealage == 1.0)
+    {
+        fragColor = opaqueColor;
+        return;
+    }
+
+    vec3 averageColor = accumulation.rgb / max(accumulation.a, 1.0e-5);
+    fragColor = opaqueColor * revealage + averageColor * (1.0 - revealage);
+}
@@ -0,0 +1,242 @@
+#include "Image.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
+
+
+namespace
+{
+
+bool hasExtension(const std::string & filename, const std::string & extension)
+{
+    return filename.size() >= extension.size()
+        && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool isLittleEndian()
+{
+    const auto value = uint16_t{1u};
+    return *reinterpret_cast<const unsigned char *>(&value) == 1u;
+}
+
+float swapBytes(float value)
+{
+    auto bytes = reinterpret_cast<unsigned char *>(&value);
+    std::reverse(bytes, bytes + sizeof(value));
+    return value;
+}
+
+}
+
+Image::Image()
+:   m_width{0u}
+,   m_height{0u}
+{
+}
+
+Image::Image(unsigned int width, unsigned int height, const glm::vec3 & color)
+:   m_width{width}
+,   m_height{height}
+,   m_pixels(width * height, color)
+{
+}
+
+unsigned int Image::width() const
+{
+    return m_width;
+}
+
+unsigned int Image::height() const
+{
+    return m_height;
+}
+
+glm::vec3 & Image::at(unsigned int x, unsigned int y)
+{
+    assert(x < m_width && y < m_height);
+    return m_pixels[y * m_width + x];
+}
+
+const glm::vec3 & Image::at(unsigned int x, unsigned int y) const
+{
+    assert(x < m_width && y < m_height);
+    return m_pixels[y * m_width + x];
+}
+
+bool Image::load(const std::string & filename)
+{
+    std::ifstream stream(filename, std::ios::binary);
+
+    if (!stream)
+        return false;
+
+    if (hasExtension(filename, ".pfm"))
+        return loadPfm(stream);
+
+    if (hasExtension(filename, ".ppm"))
+        return loadPpm(stream);
+
+    return false;
+}
+
+bool Image::save(const std::string & filename) const
+{
+    std::ofstream stream(filename, std::ios::binary);
+
+    if (!stream)
+        return false;
+
+    if (hasExtension(filename, ".pfm"))
+        return savePfm(stream);
+
+    if (hasExtension(filename, ".ppm"))
+        return savePpm(stream);
+
+    return false;
+}
+
+ImageError Image::compare(const Image & reference) const
+{
+    assert(m_width == reference.m_width && m_height == reference.m_height);
+
+    auto error = ImageError{0.0, 0.0, 0.0, std::numeric_limits<double>::infinity()};
+
+    if (m_pixels.empty())
+        return error;
+
+    auto sumError = 0.0;
+    auto sumSquaredError = 0.0;
+
+    for (auto i = size_t{0u}; i < m_pixels.size(); ++i)
+    {
+        for (auto channel = 0; channel < 3; ++channel)
+        {
+            const auto difference = std::abs(static_cast<double>(m_pixels[i][channel]) - reference.m_pixels[i][channel]);
+
+            sumError += difference;
+            sumSquaredError += difference * difference;
+            error.maxError = std::max(error.maxError, difference);
+        }
+    }
+
+    const auto numValues = static_cast<double>(m_pixels.size() * 3u);
+
+    error.meanError = sumError / numValues;
+    error.rmse = std::sqrt(sumSquaredError / numValues);
+
+    if (error.rmse > 0.0)
+        error.psnr = 20.0 * std::log10(1.0 / error.rmse);
+
+    return error;
+}
+
+bool Image::loadPfm(std::istream & stream)
+{
+    auto magic = std::string{};
+    auto width = 0u, height = 0u;
+    auto scale = 0.0f;
+
+    stream >> magic >> width >> height >> scale;
+    stream.get();
+
+    if (!stream || magic != "PF")
+        return false;
+
+    // a negative scale marks little endian data
+    const auto swap = (scale < 0.0f) != isLittleEndian();
+
+    auto pixels = std::vector<glm::vec3>(width * height);
+
+    for (auto & pixel : pixels)
+    {
+        auto values = std::array<float, 3>{};
+        stream.read(reinterpret_cast<char *>(values.data()), sizeof(values));
+
+        for (auto channel = 0; channel < 3; ++channel)
+            pixel[channel] = swap ? swapBytes(values[channel]) : values[channel];
+    }
+
+    if (!stream)
+        return false;
+
+    m_width = width;
+    m_height = height;
+    m_pixels = std::move(pixels);
+
+    return true;
+}
+
+bool Image::loadPpm(std::istream & stream)
+{
+    auto magic = std::string{};
+    auto width = 0u, height = 0u, maxValue = 0u;
+
+    stream >> magic >> width >> height >> maxValue;
+    stream.get();
+
+    if (!stream || magic != "P6" || maxValue != 255u)
+        return false;
+
+    auto pixels = std::vector<glm::vec3>(width * height);
+
+    // ppm rows are stored top to bottom
+    for (auto y = height; y-- > 0u;)
+    {
+        for (auto x = 0u; x < width; ++x)
+        {
+            auto values = std::array<unsigned char, 3>{};
+            stream.read(reinterpret_cast<char *>(values.data()), sizeof(values));
+
+            for (auto channel = 0; channel < 3; ++channel)
+                pixels[y * width + x][channel] = values[channel] / 255.0f;
+        }
+    }
+
+    if (!stream)
+        return false;
+
+    m_width = width;
+    m_height = height;
+    m_pixels = std::move(pixels);
+
+    return true;
+}
+
+bool Image::savePfm(std::ostream & stream) const
+{
+    stream << "PF\n" << m_width << " " << m_height << "\n" << (isLittleEndian() ? "-1.0" : "1.0") << "\n";
+
+    for (const auto & pixel : m_pixels)
+    {
+        const auto values = std::array<float, 3>{{ pixel.x, pixel.y, pixel.z }};
+        stream.write(reinterpret_cast<const char *>(values.data()), sizeof(values));
+    }
+
+    return static_cast<bool>(stream);
+}
+
+bool Image::savePpm(std::ostream & stream) const
+{
+    stream << "P6\n" << m_width << " " << m_height << "\n255\n";
+
+    for (auto y = m_height; y-- > 0u;)
+    {
+        for (auto x = 0u; x < m_width; ++x)
+        {
+            const auto & pixel = m_pixels[y * m_width + x];
+            auto values = std::array<unsigned char, 3>{};
+
+            for (auto channel = 0; channel < 3; ++channel)
+                values[channel] = static_cast<unsigned char>(std::min(std::max(pixel[channel], 0.0f), 1.0f) * 255.0f + 0.5f);
+
+            stream.write(reinterpret_cast<const char *>(values.data()), sizeof(values));
+        }
+    }
+
+    return static_cast<bool>(stream);
+}
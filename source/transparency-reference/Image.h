@@ -0,0 +1,47 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+struct ImageError
+{
+    double meanError;
+    double maxError;
+    double rmse;
+    double psnr;
+};
+
+/** Linear RGB float image, rows are stored bottom to top like OpenGL framebuffers */
+class Image
+{
+public:
+    Image();
+    Image(unsigned int width, unsigned int height, const glm::vec3 & color = glm::vec3{0.0f});
+
+    unsigned int width() const;
+    unsigned int height() const;
+
+    glm::vec3 & at(unsigned int x, unsigned int y);
+    const glm::vec3 & at(unsigned int x, unsigned int y) const;
+
+    // format is chosen by extension, .pfm keeps full precision, .ppm is quantized to 8 bits
+    bool load(const std::string & filename);
+    bool save(const std::string & filename) const;
+
+    ImageError compare(const Image & reference) const;
+
+protected:
+    bool loadPfm(std::istream & stream);
+    bool loadPpm(std::istream & stream);
+    bool savePfm(std::ostream & stream) const;
+    bool savePpm(std::ostream & stream) const;
+
+private:
+    unsigned int m_width;
+    unsigned int m_height;
+    std::vector<glm::vec3> m_pixels;
+};
@@ -0,0 +1,120 @@
+#include "Mesh.h"
+
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+
+namespace
+{
+
+// resolves a one based or negative, relative OBJ index, returns -1 if it is missing or out of range
+long resolveIndex(const std::string & text, std::size_t count)
+{
+    if (text.empty())
+        return -1;
+
+    auto end = static_cast<char *>(nullptr);
+    const auto index = std::strtol(text.c_str(), &end, 10);
+
+    if (*end != '\0' || index == 0)
+        return -1;
+
+    const auto resolved = index < 0 ? static_cast<long>(count) + index : index - 1;
+
+    return resolved >= 0 && resolved < static_cast<long>(count) ? resolved : -1;
+}
+
+}
+
+unsigned int Mesh::numTriangles() const
+{
+    return static_cast<unsigned int>(indices.size() / 3u);
+}
+
+bool Mesh::loadObj(const std::string & filename)
+{
+    std::ifstream stream(filename);
+
+    if (!stream)
+        return false;
+
+    auto objVertices = std::vector<glm::vec3>{};
+    auto objNormals = std::vector<glm::vec3>{};
+    auto objIndices = std::vector<unsigned int>{};
+    auto cornerNormals = std::vector<glm::vec3>{};
+
+    auto line = std::string{};
+    auto face = std::vector<unsigned int>{};
+    auto faceNormals = std::vector<long>{};
+
+    while (std::getline(stream, line))
+    {
+        std::istringstream lineStream(line);
+
+        auto keyword = std::string{};
+        lineStream >> keyword;
+
+        if (keyword == "v")
+        {
+            auto vertex = glm::vec3{};
+            lineStream >> vertex.x >> vertex.y >> vertex.z;
+            objVertices.push_back(vertex);
+        }
+        else if (keyword == "vn")
+        {
+            auto normal = glm::vec3{};
+            lineStream >> normal.x >> normal.y >> normal.z;
+            objNormals.push_back(normal);
+        }
+        else if (keyword == "f")
+        {
+            face.clear();
+            faceNormals.clear();
+
+            auto token = std::string{};
+
+            while (lineStream >> token)
+            {
+                // v, v/vt, v//vn or v/vt/vn, negative indices are relative to the end
+                const auto firstSlash = token.find('/');
+                const auto secondSlash = firstSlash == std::string::npos ? std::string::npos : token.find('/', firstSlash + 1u);
+
+                const auto vertex = resolveIndex(token.substr(0, firstSlash), objVertices.size());
+
+                if (vertex < 0)
+                    return false;
+
+                face.push_back(static_cast<unsigned int>(vertex));
+                faceNormals.push_back(secondSlash == std::string::npos
+                    ? -1 : resolveIndex(token.substr(secondSlash + 1u), objNormals.size()));
+            }
+
+            for (auto i = size_t{2u}; i < face.size(); ++i)
+            {
+                const auto corners = std::array<size_t, 3>{{ 0u, i - 1u, i }};
+
+                const auto & v0 = objVertices[face[corners[0]]];
+                const auto & v1 = objVertices[face[corners[1]]];
+                const auto & v2 = objVertices[face[corners[2]]];
+
+                const auto flatNormal = glm::cross(v1 - v0, v2 - v0);
+                const auto length = glm::length(flatNormal);
+
+                for (const auto corner : corners)
+                {
+                    objIndices.push_back(face[corner]);
+                    cornerNormals.push_back(faceNormals[corner] >= 0 ? objNormals[faceNormals[corner]]
+                        : length > 0.0f ? flatNormal / length : glm::vec3{0.0f});
+                }
+            }
+        }
+    }
+
+    vertices = std::move(objVertices);
+    indices = std::move(objIndices);
+    normals = std::move(cornerNormals);
+
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+/** Triangle soup of all meshes of a scene, in file order */
+struct Mesh
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<unsigned int> indices;
+
+    // one per index, like the painters' import the normals of the file are used and flat normals generated otherwise
+    std::vector<glm::vec3> normals;
+
+    unsigned int numTriangles() const;
+
+    // reads positions, normals and faces of a Wavefront OBJ file, polygons are triangulated as fans
+    bool loadObj(const std::string & filename);
+};
@@ -0,0 +1,410 @@
+#include "Rasterizer.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "Mesh.h"
+#include "TaskScheduler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REFERENCE_RASTERIZER_SSE2
+#endif
+
+
+namespace
+{
+
+// a triangle clipped against near and far plane has at most five vertices
+using polygon_t = std::vector<glm::vec4>;
+
+float nearDistance(const glm::vec4 & vertex)
+{
+    return vertex.z + vertex.w;
+}
+
+float farDistance(const glm::vec4 & vertex)
+{
+    return vertex.w - vertex.z;
+}
+
+template <typename Distance>
+polygon_t clip(const polygon_t & polygon, Distance distance)
+{
+    auto result = polygon_t{};
+
+    for (auto i = size_t{0u}; i < polygon.size(); ++i)
+    {
+        const auto & current = polygon[i];
+        const auto & next = polygon[(i + 1u) % polygon.size()];
+
+        const auto currentDistance = distance(current);
+        const auto nextDistance = distance(next);
+
+        if (currentDistance >= 0.0f)
+            result.push_back(current);
+
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+        {
+            const auto t = currentDistance / (currentDistance - nextDistance);
+            result.push_back(current + (next - current) * t);
+        }
+    }
+
+    return result;
+}
+
+}
+
+std::vector<glm::vec2> Rasterizer::samplePositions(unsigned int numSamples)
+{
+    assert(numSamples > 0u && numSamples <= s_maxNumSamples);
+
+    if (numSamples == 1u)
+        return { glm::vec2{0.5f} };
+
+    // R2 sequence, well distributed for every sample count
+    const auto g = 1.32471795724474602596;
+    const auto a1 = 1.0 / g;
+    const auto a2 = 1.0 / (g * g);
+
+    auto positions = std::vector<glm::vec2>{};
+
+    for (auto i = 0u; i < numSamples; ++i)
+    {
+        const auto x = std::fmod(0.5 + a1 * i, 1.0);
+        const auto y = std::fmod(0.5 + a2 * i, 1.0);
+        positions.push_back(glm::vec2{static_cast<float>(x), static_cast<float>(y)});
+    }
+
+    return positions;
+}
+
+Rasterizer::Rasterizer(unsigned int width, unsigned int height, const std::vector<glm::vec2> & samplePositions)
+:   m_width{width}
+,   m_height{height}
+,   m_numTilesX{(width + s_tileSize - 1u) / s_tileSize}
+,   m_numTilesY{(height + s_tileSize - 1u) / s_tileSize}
+,   m_samplePositions(samplePositions)
+,   m_bins(m_numTilesX * m_numTilesY)
+{
+    assert(!m_samplePositions.empty() && m_samplePositions.size() <= s_maxNumSamples);
+}
+
+Rasterizer::~Rasterizer() = default;
+
+unsigned int Rasterizer::width() const
+{
+    return m_width;
+}
+
+unsigned int Rasterizer::height() const
+{
+    return m_height;
+}
+
+unsigned int Rasterizer::numTilesX() const
+{
+    return m_numTilesX;
+}
+
+unsigned int Rasterizer::numTilesY() const
+{
+    return m_numTilesY;
+}
+
+unsigned int Rasterizer::numTiles() const
+{
+    return m_numTilesX * m_numTilesY;
+}
+
+const std::vector<glm::vec2> & Rasterizer::samplePositions() const
+{
+    return m_samplePositions;
+}
+
+const Rasterizer::Triangle & Rasterizer::triangle(unsigned int index) const
+{
+    return m_triangles[index];
+}
+
+float Rasterizer::depth(const Triangle & triangle, float x, float y) const
+{
+    return triangle.depthA * x + (triangle.depthB * y + triangle.depthC);
+}
+
+glm::vec3 Rasterizer::barycentrics(const Triangle & triangle, float x, float y) const
+{
+    const auto weights = triangle.barycentrics * glm::vec3{x, y, 1.0f};
+    return weights / (weights.x + weights.y + weights.z);
+}
+
+void Rasterizer::setup(const Mesh & mesh, const glm::mat4 & transform, bool backFaceCulling, const TaskScheduler & scheduler)
+{
+    const auto numTriangles = mesh.numTriangles();
+    const auto numChunks = std::max(std::min(scheduler.numThreads() * 4u, numTriangles / 1024u), 1u);
+    const auto trianglesPerChunk = (numTriangles + numChunks - 1u) / numChunks;
+
+    // chunks are merged in order afterwards, so the submission order does not depend on the scheduling
+    auto chunkTriangles = std::vector<std::vector<Triangle>>(numChunks);
+    auto chunkBins = std::vector<std::vector<std::vector<unsigned int>>>(numChunks);
+
+    scheduler.run(numChunks, [&] (unsigned int chunk, unsigned int)
+    {
+        const auto begin = std::min(chunk * trianglesPerChunk, numTriangles);
+        const auto end = std::min(begin + trianglesPerChunk, numTriangles);
+
+        auto & triangles = chunkTriangles[chunk];
+        auto & bins = chunkBins[chunk];
+        bins.resize(numTiles());
+
+        for (auto i = begin; i < end; ++i)
+        {
+            auto clipVertices = std::array<glm::vec4, 3>{};
+
+            for (auto j = 0u; j < 3u; ++j)
+                clipVertices[j] = transform * glm::vec4{mesh.vertices[mesh.indices[i * 3u + j]], 1.0f};
+
+            const auto first = static_cast<unsigned int>(triangles.size());
+            setupTriangle(clipVertices, i, backFaceCulling, triangles);
+
+            for (auto index = first; index < triangles.size(); ++index)
+            {
+                const auto & triangle = triangles[index];
+
+                for (auto tileY = triangle.minY / static_cast<int>(s_tileSize); tileY <= triangle.maxY / static_cast<int>(s_tileSize); ++tileY)
+                    for (auto tileX = triangle.minX / static_cast<int>(s_tileSize); tileX <= triangle.maxX / static_cast<int>(s_tileSize); ++tileX)
+                        bins[tileY * m_numTilesX + tileX].push_back(index);
+            }
+        }
+    });
+
+    auto chunkOffsets = std::vector<unsigned int>(numChunks, 0u);
+
+    m_triangles.clear();
+
+    for (auto chunk = 0u; chunk < numChunks; ++chunk)
+    {
+        chunkOffsets[chunk] = static_cast<unsigned int>(m_triangles.size());
+        m_triangles.insert(m_triangles.end(), chunkTriangles[chunk].begin(), chunkTriangles[chunk].end());
+    }
+
+    scheduler.run(numTiles(), [&] (unsigned int tile, unsigned int)
+    {
+        auto & bin = m_bins[tile];
+        bin.clear();
+
+        for (auto chunk = 0u; chunk < numChunks; ++chunk)
+        {
+            for (const auto index : chunkBins[chunk][tile])
+                bin.push_back(chunkOffsets[chunk] + index);
+        }
+    });
+}
+
+void Rasterizer::setupTriangle(
+    const std::array<glm::vec4, 3> & clipVertices,
+    unsigned int source,
+    bool backFaceCulling,
+    std::vector<Triangle> & triangles) const
+{
+    auto polygon = polygon_t(clipVertices.begin(), clipVertices.end());
+
+    const auto inside = std::all_of(polygon.begin(), polygon.end(), [] (const glm::vec4 & vertex)
+    {
+        return nearDistance(vertex) >= 0.0f && farDistance(vertex) >= 0.0f;
+    });
+
+    if (!inside)
+    {
+        polygon = clip(polygon, nearDistance);
+        polygon = clip(polygon, farDistance);
+    }
+
+    if (polygon.size() < 3u)
+        return;
+
+    // homogeneous barycentrics: the clip space x, y and w of the vertices span the ray through each window position
+    const auto vertexMatrix = glm::mat3{
+        glm::vec3{clipVertices[0].x, clipVertices[0].y, clipVertices[0].w},
+        glm::vec3{clipVertices[1].x, clipVertices[1].y, clipVertices[1].w},
+        glm::vec3{clipVertices[2].x, clipVertices[2].y, clipVertices[2].w}};
+
+    // the triangle is seen edge-on if its plane contains the eye
+    if (glm::determinant(vertexMatrix) == 0.0f)
+        return;
+
+    const auto windowToNdc = glm::mat3{
+        glm::vec3{2.0f / m_width, 0.0f, 0.0f},
+        glm::vec3{0.0f, 2.0f / m_height, 0.0f},
+        glm::vec3{-1.0f, -1.0f, 1.0f}};
+
+    const auto barycentrics = glm::inverse(vertexMatrix) * windowToNdc;
+
+    auto window = std::vector<glm::vec3>{};
+
+    for (const auto & vertex : polygon)
+    {
+        const auto ndc = glm::vec3{vertex} / vertex.w;
+
+        window.push_back(glm::vec3{
+            (ndc.x * 0.5f + 0.5f) * m_width,
+            (ndc.y * 0.5f + 0.5f) * m_height,
+            ndc.z * 0.5f + 0.5f});
+    }
+
+    for (auto i = size_t{2u}; i < window.size(); ++i)
+    {
+        const auto & v0 = window[0];
+        const auto & v1 = window[i - 1u];
+        const auto & v2 = window[i];
+
+        const auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+        if (area == 0.0f || (backFaceCulling && area < 0.0f))
+            continue;
+
+        const auto minX = std::max(static_cast<int>(std::floor(std::min(std::min(v0.x, v1.x), v2.x))), 0);
+        const auto minY = std::max(static_cast<int>(std::floor(std::min(std::min(v0.y, v1.y), v2.y))), 0);
+        const auto maxX = std::min(static_cast<int>(std::floor(std::max(std::max(v0.x, v1.x), v2.x))), static_cast<int>(m_width) - 1);
+        const auto maxY = std::min(static_cast<int>(std::floor(std::max(std::max(v0.y, v1.y), v2.y))), static_cast<int>(m_height) - 1);
+
+        if (minX > maxX || minY > maxY)
+            continue;
+
+        auto triangle = Triangle{};
+
+        const auto vertices = std::array<const glm::vec3 *, 3>{{ &v0, &v1, &v2 }};
+        const auto sign = area > 0.0f ? 1.0f : -1.0f;
+
+        for (auto edge = 0u; edge < 3u; ++edge)
+        {
+            const auto & p = *vertices[(edge + 1u) % 3u];
+            const auto & q = *vertices[(edge + 2u) % 3u];
+
+            triangle.a[edge] = sign * (p.y - q.y);
+            triangle.b[edge] = sign * (q.x - p.x);
+            triangle.c[edge] = sign * ((q.y - p.y) * p.x - (q.x - p.x) * p.y);
+            triangle.owned[edge] = triangle.a[edge] > 0.0f || (triangle.a[edge] == 0.0f && triangle.b[edge] > 0.0f);
+        }
+
+        triangle.depthA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+        triangle.depthB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+        triangle.depthC = v0.z - triangle.depthA * v0.x - triangle.depthB * v0.y;
+        triangle.barycentrics = barycentrics;
+
+        triangle.minX = minX;
+        triangle.minY = minY;
+        triangle.maxX = maxX;
+        triangle.maxY = maxY;
+        triangle.source = source;
+
+        triangles.push_back(triangle);
+    }
+}
+
+void Rasterizer::rasterizeTile(unsigned int tile, std::vector<Fragment> & fragments) const
+{
+    fragments.clear();
+
+    const auto tileMinX = static_cast<int>((tile % m_numTilesX) * s_tileSize);
+    const auto tileMinY = static_cast<int>((tile / m_numTilesX) * s_tileSize);
+    const auto tileMaxX = std::min(tileMinX + static_cast<int>(s_tileSize), static_cast<int>(m_width)) - 1;
+    const auto tileMaxY = std::min(tileMinY + static_cast<int>(s_tileSize), static_cast<int>(m_height)) - 1;
+
+    for (const auto index : m_bins[tile])
+        rasterizeTriangle(index, tileMinX, tileMinY, tileMaxX, tileMaxY, fragments);
+}
+
+void Rasterizer::rasterizeTriangle(
+    unsigned int index,
+    int tileMinX,
+    int tileMinY,
+    int tileMaxX,
+    int tileMaxY,
+    std::vector<Fragment> & fragments) const
+{
+    const auto & triangle = m_triangles[index];
+
+    const auto minX = std::max(triangle.minX, tileMinX);
+    const auto minY = std::max(triangle.minY, tileMinY);
+    const auto maxX = std::min(triangle.maxX, tileMaxX);
+    const auto maxY = std::min(triangle.maxY, tileMaxY);
+
+    const auto numSamples = static_cast<unsigned int>(m_samplePositions.size());
+
+#ifdef REFERENCE_RASTERIZER_SSE2
+    // four horizontally adjacent pixels per iteration, one sample position at a time
+    const auto laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const auto zero = _mm_setzero_ps();
+
+    __m128 a[3], owned[3];
+
+    for (auto edge = 0u; edge < 3u; ++edge)
+    {
+        a[edge] = _mm_set1_ps(triangle.a[edge]);
+        owned[edge] = _mm_castsi128_ps(_mm_set1_epi32(triangle.owned[edge] ? -1 : 0));
+    }
+#endif
+
+    for (auto y = minY; y <= maxY; ++y)
+    {
+        for (auto x = minX; x <= maxX; x += 4)
+        {
+            auto coverage = std::array<uint32_t, 4>{};
+
+            for (auto sample = 0u; sample < numSamples; ++sample)
+            {
+                const auto & position = m_samplePositions[sample];
+                const auto sampleY = static_cast<float>(y) + position.y;
+
+#ifdef REFERENCE_RASTERIZER_SSE2
+                const auto sampleX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x) + position.x), laneOffsets);
+
+                auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+                for (auto edge = 0u; edge < 3u; ++edge)
+                {
+                    const auto offset = _mm_set1_ps(triangle.b[edge] * sampleY + triangle.c[edge]);
+                    const auto value = _mm_add_ps(_mm_mul_ps(a[edge], sampleX), offset);
+
+                    const auto positive = _mm_cmpgt_ps(value, zero);
+                    const auto onEdge = _mm_and_ps(_mm_cmpeq_ps(value, zero), owned[edge]);
+
+                    inside = _mm_and_ps(inside, _mm_or_ps(positive, onEdge));
+                }
+
+                const auto lanes = static_cast<unsigned int>(_mm_movemask_ps(inside));
+
+                for (auto lane = 0u; lane < 4u; ++lane)
+                    coverage[lane] |= ((lanes >> lane) & 1u) << sample;
+#else
+                for (auto lane = 0u; lane < 4u; ++lane)
+                {
+                    const auto sampleX = (static_cast<float>(x) + position.x) + static_cast<float>(lane);
+
+                    auto inside = true;
+
+                    for (auto edge = 0u; edge < 3u; ++edge)
+                    {
+                        const auto value = triangle.a[edge] * sampleX + (triangle.b[edge] * sampleY + triangle.c[edge]);
+                        inside &= value > 0.0f || (value == 0.0f && triangle.owned[edge]);
+                    }
+
+                    coverage[lane] |= static_cast<uint32_t>(inside) << sample;
+                }
+#endif
+            }
+
+            for (auto lane = 0; lane < 4 && x + lane <= maxX; ++lane)
+            {
+                if (coverage[lane] == 0u)
+                    continue;
+
+                const auto pixel = static_cast<unsigned int>((y - tileMinY) * static_cast<int>(s_tileSize) + (x + lane - tileMinX));
+                fragments.push_back(Fragment{pixel, index, coverage[lane]});
+            }
+        }
+    }
+}
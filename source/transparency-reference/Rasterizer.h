@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+struct Mesh;
+class TaskScheduler;
+
+/** Tile-binned triangle rasterizer with up to 32 samples per pixel */
+class Rasterizer
+{
+public:
+    static const auto s_tileSize = 32u;
+    static const auto s_maxNumSamples = 32u;
+
+    struct Triangle
+    {
+        // edge functions a * x + b * y + c, positive inside
+        std::array<float, 3> a;
+        std::array<float, 3> b;
+        std::array<float, 3> c;
+
+        // samples exactly on an edge belong to only one of the two triangles sharing it
+        std::array<bool, 3> owned;
+
+        // window space depth plane
+        float depthA;
+        float depthB;
+        float depthC;
+
+        // maps window coordinates (x, y, 1) to the unnormalized perspective correct barycentrics of the source
+        // triangle, independent of clipping
+        glm::mat3 barycentrics;
+
+        int minX, minY, maxX, maxY;
+
+        unsigned int source;
+    };
+
+    struct Fragment
+    {
+        unsigned int pixel;     ///< index within the tile, row major
+        unsigned int triangle;
+        uint32_t coverage;      ///< bit i is set if sample i is inside the triangle
+    };
+
+    // positions within the unit pixel, defaults to a low discrepancy pattern
+    static std::vector<glm::vec2> samplePositions(unsigned int numSamples);
+
+public:
+    Rasterizer(unsigned int width, unsigned int height, const std::vector<glm::vec2> & samplePositions);
+    ~Rasterizer();
+
+    unsigned int width() const;
+    unsigned int height() const;
+    unsigned int numTilesX() const;
+    unsigned int numTilesY() const;
+    unsigned int numTiles() const;
+
+    const std::vector<glm::vec2> & samplePositions() const;
+
+    // transforms, clips and bins all triangles; counter clockwise triangles are front facing
+    void setup(const Mesh & mesh, const glm::mat4 & transform, bool backFaceCulling, const TaskScheduler & scheduler);
+
+    const Triangle & triangle(unsigned int index) const;
+    float depth(const Triangle & triangle, float x, float y) const;
+    glm::vec3 barycentrics(const Triangle & triangle, float x, float y) const;
+
+    // all fragments of a tile, triangles in submission order
+    void rasterizeTile(unsigned int tile, std::vector<Fragment> & fragments) const;
+
+protected:
+    void setupTriangle(
+        const std::array<glm::vec4, 3> & clipVertices,
+        unsigned int source,
+        bool backFaceCulling,
+        std::vector<Triangle> & triangles) const;
+
+    void rasterizeTriangle(
+        unsigned int index,
+        int tileMinX,
+        int tileMinY,
+        int tileMaxX,
+        int tileMaxY,
+        std::vector<Fragment> & fragments) const;
+
+private:
+    const unsigned int m_width;
+    const unsigned int m_height;
+    const unsigned int m_numTilesX;
+    const unsigned int m_numTilesY;
+    const std::vector<glm::vec2> m_samplePositions;
+
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<unsigned int>> m_bins;
+};
@@ -0,0 +1,316 @@
+#include "ReferenceRenderer.h"
+
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stochastic/MasksTableGenerator.h>
+
+#include "Mesh.h"
+#include "TaskScheduler.h"
+
+
+namespace
+{
+
+// same as the shaders, accepts samples of the stochastic surface itself
+const auto kDepthEpsilon = 1.0f / 16777215.0f;
+
+uint32_t hash(uint32_t value)
+{
+    value ^= value >> 16u;
+    value *= 0x7feb352du;
+    value ^= value >> 15u;
+    value *= 0x846ca68bu;
+    value ^= value >> 16u;
+    return value;
+}
+
+}
+
+ReferenceSettings::ReferenceSettings()
+:   width(800u)
+,   height(600u)
+,   numSamples(8u)
+,   transparency(160u)
+,   seed(MasksTableGenerator::s_defaultSeed)
+,   backFaceCulling(false)
+,   eye(0.0f, 0.0f, 1.0f)
+,   center(0.0f, 0.0f, 0.0f)
+,   up(0.0f, 1.0f, 0.0f)
+,   fovy(50.0f)
+,   zNear(0.3f)
+,   zFar(30.0f)
+,   backgroundColor(0.85f, 0.87f, 0.91f)
+{
+}
+
+ReferenceRenderer::ReferenceRenderer(const ReferenceSettings & settings, const TaskScheduler & scheduler)
+:   m_settings(settings)
+,   m_scheduler(scheduler)
+,   m_alpha{settings.transparency / 255.0f}
+,   m_rasterizer{settings.width, settings.height, Rasterizer::samplePositions(settings.numSamples)}
+{
+    // only the row of the configured transparency is ever used
+    const auto distributions = MasksTableGenerator::generateDistributions(settings.numSamples, settings.seed);
+    const auto & row = distributions->at(settings.transparency);
+
+    m_masks.assign(row.begin(), row.end());
+}
+
+ReferenceRenderer::~ReferenceRenderer() = default;
+
+Image ReferenceRenderer::render(const Mesh & mesh, ReferenceMode mode)
+{
+    const auto aspect = static_cast<float>(m_settings.width) / m_settings.height;
+    const auto projection = glm::perspective(glm::radians(m_settings.fovy), aspect, m_settings.zNear, m_settings.zFar);
+    const auto view = glm::lookAt(m_settings.eye, m_settings.center, m_settings.up);
+
+    setupColors(mesh);
+    m_rasterizer.setup(mesh, projection * view, m_settings.backFaceCulling, m_scheduler);
+
+    auto image = Image{m_settings.width, m_settings.height, m_settings.backgroundColor};
+    auto buffers = std::vector<TileBuffers>(m_scheduler.numThreads());
+
+    m_scheduler.run(m_rasterizer.numTiles(), [&] (unsigned int tile, unsigned int worker)
+    {
+        renderTile(tile, mode, buffers[worker], image);
+    });
+
+    return image;
+}
+
+void ReferenceRenderer::setupColors(const Mesh & mesh)
+{
+    m_colors.resize(mesh.normals.size());
+
+    // the shaders map the interpolated normal linearly, so interpolating the corner colors is the same
+    for (auto i = size_t{0u}; i < mesh.normals.size(); ++i)
+        m_colors[i] = mesh.normals[i] * 0.5f + 0.5f;
+}
+
+void ReferenceRenderer::renderTile(unsigned int tile, ReferenceMode mode, TileBuffers & buffers, Image & image) const
+{
+    m_rasterizer.rasterizeTile(tile, buffers.fragments);
+
+    if (buffers.fragments.empty())
+        return;
+
+    if (mode == ReferenceMode::Sorted)
+        renderSortedTile(tile, buffers, image);
+    else
+        renderStochasticTile(tile, mode, buffers, image);
+}
+
+void ReferenceRenderer::renderStochasticTile(unsigned int tile, ReferenceMode mode, TileBuffers & buffers, Image & image) const
+{
+    const auto numSamples = m_settings.numSamples;
+    const auto numValues = Rasterizer::s_tileSize * Rasterizer::s_tileSize * numSamples;
+    const auto tileX = (tile % m_rasterizer.numTilesX()) * Rasterizer::s_tileSize;
+    const auto tileY = (tile / m_rasterizer.numTilesX()) * Rasterizer::s_tileSize;
+
+    buffers.depths.assign(numValues, 1.0f);
+    buffers.colors.assign(numValues, glm::vec3{0.0f});
+    buffers.covered.assign(numValues, 0u);
+    buffers.transmittances.assign(numValues, 1.0f);
+    buffers.accumulations.assign(numValues, glm::vec4{0.0f});
+
+    // alpha to coverage pass, keeps the nearest stochastically selected surface per sample
+    for (const auto & fragment : buffers.fragments)
+    {
+        const auto x = tileX + fragment.pixel % Rasterizer::s_tileSize;
+        const auto y = tileY + fragment.pixel / Rasterizer::s_tileSize;
+        const auto source = m_rasterizer.triangle(fragment.triangle).source;
+        const auto coverage = fragment.coverage & coverageMask(x, y, source);
+
+        for (auto sample = 0u; sample < numSamples; ++sample)
+        {
+            if ((coverage & (1u << sample)) == 0u)
+                continue;
+
+            const auto index = fragment.pixel * numSamples + sample;
+            const auto depth = sampleDepth(fragment, tile, sample);
+
+            if (depth >= buffers.depths[index])
+                continue;
+
+            buffers.depths[index] = depth;
+            buffers.colors[index] = sampleColor(fragment, tile, sample);
+            buffers.covered[index] = 1u;
+        }
+    }
+
+    // total alpha and depth based accumulation see every fragment
+    if (mode != ReferenceMode::NoOptimization)
+    {
+        for (const auto & fragment : buffers.fragments)
+        {
+            for (auto sample = 0u; sample < numSamples; ++sample)
+            {
+                if ((fragment.coverage & (1u << sample)) == 0u)
+                    continue;
+
+                const auto index = fragment.pixel * numSamples + sample;
+
+                buffers.transmittances[index] *= 1.0f - m_alpha;
+
+                if (mode == ReferenceMode::AlphaCorrectionAndDepthBased
+                    && sampleDepth(fragment, tile, sample) <= buffers.depths[index] + kDepthEpsilon)
+                {
+                    buffers.accumulations[index] += glm::vec4{sampleColor(fragment, tile, sample) * m_alpha, m_alpha};
+                }
+            }
+        }
+    }
+
+    const auto maxX = std::min(tileX + Rasterizer::s_tileSize, m_settings.width);
+    const auto maxY = std::min(tileY + Rasterizer::s_tileSize, m_settings.height);
+
+    for (auto y = tileY; y < maxY; ++y)
+    {
+        for (auto x = tileX; x < maxX; ++x)
+        {
+            const auto pixel = (y - tileY) * Rasterizer::s_tileSize + (x - tileX);
+            const auto & background = m_settings.backgroundColor;
+
+            auto stochasticColor = glm::vec3{0.0f};
+            auto coveredSamples = 0u;
+            auto transmittance = 0.0f;
+            auto accumulation = glm::vec4{0.0f};
+
+            for (auto sample = 0u; sample < numSamples; ++sample)
+            {
+                const auto index = pixel * numSamples + sample;
+
+                stochasticColor += buffers.covered[index] ? buffers.colors[index] : glm::vec3{0.0f};
+                coveredSamples += buffers.covered[index];
+                transmittance += buffers.transmittances[index];
+                accumulation += buffers.accumulations[index];
+            }
+
+            const auto samples = static_cast<float>(numSamples);
+            auto & color = image.at(x, y);
+
+            if (mode == ReferenceMode::NoOptimization)
+            {
+                color = (stochasticColor + background * static_cast<float>(numSamples - coveredSamples)) / samples;
+                continue;
+            }
+
+            // same resolve as the compositing shader
+            const auto transparentColor = mode == ReferenceMode::AlphaCorrection
+                ? glm::vec4{stochasticColor, static_cast<float>(coveredSamples)} / samples
+                : accumulation / samples;
+
+            const auto complTotalAlpha = transmittance / samples;
+
+            if (transparentColor.a != 0.0f)
+                color = background * complTotalAlpha + glm::vec3{transparentColor} * ((1.0f - complTotalAlpha) / transparentColor.a);
+            else
+                color = background;
+        }
+    }
+}
+
+void ReferenceRenderer::renderSortedTile(unsigned int tile, TileBuffers & buffers, Image & image) const
+{
+    const auto numSamples = m_settings.numSamples;
+    const auto numPixels = Rasterizer::s_tileSize * Rasterizer::s_tileSize;
+    const auto tileX = (tile % m_rasterizer.numTilesX()) * Rasterizer::s_tileSize;
+    const auto tileY = (tile / m_rasterizer.numTilesX()) * Rasterizer::s_tileSize;
+
+    // bucket the fragments by pixel, keeping the submission order within a pixel
+    buffers.offsets.assign(numPixels + 1u, 0u);
+
+    for (const auto & fragment : buffers.fragments)
+        ++buffers.offsets[fragment.pixel + 1u];
+
+    std::partial_sum(buffers.offsets.begin(), buffers.offsets.end(), buffers.offsets.begin());
+
+    buffers.pixelFragments.resize(buffers.fragments.size());
+
+    auto next = std::vector<unsigned int>(buffers.offsets.begin(), buffers.offsets.end() - 1);
+
+    for (auto i = 0u; i < buffers.fragments.size(); ++i)
+        buffers.pixelFragments[next[buffers.fragments[i].pixel]++] = i;
+
+    const auto maxX = std::min(tileX + Rasterizer::s_tileSize, m_settings.width);
+    const auto maxY = std::min(tileY + Rasterizer::s_tileSize, m_settings.height);
+
+    for (auto y = tileY; y < maxY; ++y)
+    {
+        for (auto x = tileX; x < maxX; ++x)
+        {
+            const auto pixel = (y - tileY) * Rasterizer::s_tileSize + (x - tileX);
+            const auto begin = buffers.offsets[pixel];
+            const auto end = buffers.offsets[pixel + 1u];
+
+            if (begin == end)
+                continue;
+
+            auto pixelColor = glm::vec3{0.0f};
+
+            for (auto sample = 0u; sample < numSamples; ++sample)
+            {
+                buffers.layers.clear();
+
+                for (auto i = begin; i < end; ++i)
+                {
+                    const auto & fragment = buffers.fragments[buffers.pixelFragments[i]];
+
+                    if ((fragment.coverage & (1u << sample)) != 0u)
+                        buffers.layers.emplace_back(sampleDepth(fragment, tile, sample), buffers.pixelFragments[i]);
+                }
+
+                // farthest first, fragments of equal depth are blended in submission order
+                std::sort(buffers.layers.begin(), buffers.layers.end(),
+                    [] (const std::pair<float, unsigned int> & lhs, const std::pair<float, unsigned int> & rhs)
+                {
+                    return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+                });
+
+                auto color = m_settings.backgroundColor;
+
+                for (const auto & layer : buffers.layers)
+                    color = sampleColor(buffers.fragments[layer.second], tile, sample) * m_alpha + color * (1.0f - m_alpha);
+
+                pixelColor += color;
+            }
+
+            image.at(x, y) = pixelColor / static_cast<float>(numSamples);
+        }
+    }
+}
+
+uint32_t ReferenceRenderer::coverageMask(unsigned int x, unsigned int y, unsigned int source) const
+{
+    // one mask per pixel and primitive, like the per pixel random of the shaders
+    const auto index = hash(x ^ hash(y ^ hash(source ^ hash(m_settings.seed))));
+    return m_masks[index % MasksTableGenerator::s_numMasks];
+}
+
+float ReferenceRenderer::sampleDepth(const Rasterizer::Fragment & fragment, unsigned int tile, unsigned int sample) const
+{
+    const auto & position = m_rasterizer.samplePositions()[sample];
+
+    const auto x = (tile % m_rasterizer.numTilesX()) * Rasterizer::s_tileSize + fragment.pixel % Rasterizer::s_tileSize;
+    const auto y = (tile / m_rasterizer.numTilesX()) * Rasterizer::s_tileSize + fragment.pixel / Rasterizer::s_tileSize;
+
+    return m_rasterizer.depth(m_rasterizer.triangle(fragment.triangle), static_cast<float>(x) + position.x, static_cast<float>(y) + position.y);
+}
+
+glm::vec3 ReferenceRenderer::sampleColor(const Rasterizer::Fragment & fragment, unsigned int tile, unsigned int sample) const
+{
+    const auto & position = m_rasterizer.samplePositions()[sample];
+    const auto & triangle = m_rasterizer.triangle(fragment.triangle);
+
+    const auto x = (tile % m_rasterizer.numTilesX()) * Rasterizer::s_tileSize + fragment.pixel % Rasterizer::s_tileSize;
+    const auto y = (tile / m_rasterizer.numTilesX()) * Rasterizer::s_tileSize + fragment.pixel / Rasterizer::s_tileSize;
+
+    const auto weights = m_rasterizer.barycentrics(triangle, static_cast<float>(x) + position.x, static_cast<float>(y) + position.y);
+    const auto corner = triangle.source * 3u;
+
+    return m_colors[corner] * weights.x + m_colors[corner + 1u] * weights.y + m_colors[corner + 2u] * weights.z;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Image.h"
+#include "Rasterizer.h"
+
+
+struct Mesh;
+class TaskScheduler;
+
+/** Mirrors the optimizations of the stochastic transparency painter, Sorted is the exact solution */
+enum class ReferenceMode { Sorted, NoOptimization, AlphaCorrection, AlphaCorrectionAndDepthBased };
+
+struct ReferenceSettings
+{
+    ReferenceSettings();
+
+    unsigned int width;
+    unsigned int height;
+    unsigned int numSamples;
+    unsigned char transparency;
+    uint32_t seed;
+    bool backFaceCulling;
+
+    glm::vec3 eye;
+    glm::vec3 center;
+    glm::vec3 up;
+    float fovy;
+    float zNear;
+    float zFar;
+
+    glm::vec3 backgroundColor;
+};
+
+class ReferenceRenderer
+{
+public:
+    ReferenceRenderer(const ReferenceSettings & settings, const TaskScheduler & scheduler);
+    ~ReferenceRenderer();
+
+    Image render(const Mesh & mesh, ReferenceMode mode);
+
+protected:
+    struct TileBuffers
+    {
+        std::vector<Rasterizer::Fragment> fragments;
+        std::vector<float> depths;
+        std::vector<glm::vec3> colors;
+        std::vector<unsigned char> covered;
+        std::vector<float> transmittances;
+        std::vector<glm::vec4> accumulations;
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> pixelFragments;
+        std::vector<std::pair<float, unsigned int>> layers;
+    };
+
+    void setupColors(const Mesh & mesh);
+
+    void renderTile(unsigned int tile, ReferenceMode mode, TileBuffers & buffers, Image & image) const;
+    void renderStochasticTile(unsigned int tile, ReferenceMode mode, TileBuffers & buffers, Image & image) const;
+    void renderSortedTile(unsigned int tile, TileBuffers & buffers, Image & image) const;
+
+    uint32_t coverageMask(unsigned int x, unsigned int y, unsigned int source) const;
+    float sampleDepth(const Rasterizer::Fragment & fragment, unsigned int tile, unsigned int sample) const;
+    glm::vec3 sampleColor(const Rasterizer::Fragment & fragment, unsigned int tile, unsigned int sample) const;
+
+private:
+    const ReferenceSettings m_settings;
+    const TaskScheduler & m_scheduler;
+    const float m_alpha;
+
+    Rasterizer m_rasterizer;
+    std::vector<uint32_t> m_masks;
+    std::vector<glm::vec3> m_colors;    ///< one per mesh index
+};
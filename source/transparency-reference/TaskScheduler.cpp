@@ -0,0 +1,117 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+class WorkQueue
+{
+public:
+    void push(unsigned int task)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push_back(task);
+    }
+
+    // the owner works from the back, so neighbouring tasks stay on one core
+    bool pop(unsigned int & task)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if (m_tasks.empty())
+            return false;
+
+        task = m_tasks.back();
+        m_tasks.pop_back();
+        return true;
+    }
+
+    // thieves take from the front, farthest away from what the owner is working on
+    bool steal(unsigned int & task)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if (m_tasks.empty())
+            return false;
+
+        task = m_tasks.front();
+        m_tasks.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::deque<unsigned int> m_tasks;
+};
+
+}
+
+TaskScheduler::TaskScheduler(unsigned int numThreads)
+:   m_numThreads{numThreads > 0u ? numThreads : std::max(std::thread::hardware_concurrency(), 1u)}
+{
+}
+
+TaskScheduler::~TaskScheduler() = default;
+
+unsigned int TaskScheduler::numThreads() const
+{
+    return m_numThreads;
+}
+
+void TaskScheduler::run(unsigned int numTasks, const std::function<void(unsigned int task, unsigned int worker)> & function) const
+{
+    const auto numWorkers = std::max(std::min(m_numThreads, numTasks), 1u);
+
+    auto queues = std::vector<std::unique_ptr<WorkQueue>>{};
+
+    for (auto worker = 0u; worker < numWorkers; ++worker)
+        queues.emplace_back(new WorkQueue{});
+
+    // contiguous blocks, pushed in reverse so each owner starts with the first task of its block
+    const auto tasksPerWorker = (numTasks + numWorkers - 1u) / numWorkers;
+
+    for (auto task = numTasks; task-- > 0u;)
+        queues[task / tasksPerWorker]->push(task);
+
+    // tasks do not spawn tasks, so a worker that finds every queue empty is done
+    const auto work = [&queues, &function, numWorkers] (unsigned int worker)
+    {
+        auto task = 0u;
+
+        while (true)
+        {
+            if (queues[worker]->pop(task))
+            {
+                function(task, worker);
+                continue;
+            }
+
+            auto stolen = false;
+
+            for (auto i = 1u; i < numWorkers && !stolen; ++i)
+                stolen = queues[(worker + i) % numWorkers]->steal(task);
+
+            if (!stolen)
+                return;
+
+            function(task, worker);
+        }
+    };
+
+    auto threads = std::vector<std::thread>{};
+
+    for (auto worker = 1u; worker < numWorkers; ++worker)
+        threads.emplace_back(work, worker);
+
+    work(0u);
+
+    for (auto & thread : threads)
+        thread.join();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+
+
+/** Runs independent tasks on all cores, idle workers steal tasks from the queues of busy ones */
+class TaskScheduler
+{
+public:
+    TaskScheduler(unsigned int numThreads = 0u);
+    ~TaskScheduler();
+
+    unsigned int numThreads() const;
+
+    // blocks until function was called for every index in [0, numTasks), calls for one index are never repeated
+    void run(unsigned int numTasks, const std::function<void(unsigned int task, unsigned int worker)> & function) const;
+
+private:
+    const unsigned int m_numThreads;
+};
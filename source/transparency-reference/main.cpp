@@ -0,0 +1,216 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "Image.h"
+#include "Mesh.h"
+#include "ReferenceRenderer.h"
+#include "TaskScheduler.h"
+
+
+namespace
+{
+
+void printUsage()
+{
+    std::cout
+        << "Usage: transparency-reference [options]\n"
+        << "\n"
+        << "  --scene <file.obj>        scene to render (data/transparency/transparency_scene.obj)\n"
+        << "  --output <file>           image to write, .pfm or .ppm (reference.pfm)\n"
+        << "  --mode <mode>             sorted, no-optimization, alpha-correction or depth-based (sorted)\n"
+        << "  --size <width>x<height>   image size (800x600)\n"
+        << "  --samples <n>             samples per pixel, 1 to 32 (8)\n"
+        << "  --transparency <0-255>    alpha of all surfaces (160)\n"
+        << "  --seed <n>                seed of the masks table and the mask selection\n"
+        << "  --eye <x,y,z>             camera position (0,0,1)\n"
+        << "  --center <x,y,z>          camera target (0,0,0)\n"
+        << "  --up <x,y,z>              camera up vector (0,1,0)\n"
+        << "  --back-face-culling       cull clockwise triangles\n"
+        << "  --threads <n>             worker threads, 0 uses all cores (0)\n"
+        << "  --compare <file>          print error metrics against a reference image\n"
+        << "  --max-rmse <value>        exit with failure if the rmse exceeds value, requires --compare\n"
+        << std::flush;
+}
+
+bool parseVector(const std::string & text, glm::vec3 & vector)
+{
+    std::istringstream stream(text);
+    auto separator = ',';
+
+    stream >> vector.x >> separator >> vector.y >> separator >> vector.z;
+    return !stream.fail();
+}
+
+template <typename Number>
+bool parseNumber(const std::string & text, Number & number)
+{
+    std::istringstream stream(text);
+
+    stream >> number;
+
+    // extraction into unsigned types silently wraps negative input
+    return !stream.fail() && stream.eof() && (std::is_signed<Number>::value || text.find('-') == std::string::npos);
+}
+
+}
+
+int main(int argc, char * argv[])
+{
+    static const auto modes = std::map<std::string, ReferenceMode>{
+        { "sorted", ReferenceMode::Sorted },
+        { "no-optimization", ReferenceMode::NoOptimization },
+        { "alpha-correction", ReferenceMode::AlphaCorrection },
+        { "depth-based", ReferenceMode::AlphaCorrectionAndDepthBased }};
+
+    auto settings = ReferenceSettings{};
+    auto scene = std::string{"data/transparency/transparency_scene.obj"};
+    auto output = std::string{"reference.pfm"};
+    auto mode = ReferenceMode::Sorted;
+    auto numThreads = 0u;
+    auto compare = std::string{};
+    auto maxRmse = -1.0;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        const auto option = std::string{argv[i]};
+
+        if (option == "--help" || option == "-h")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+
+        if (option == "--back-face-culling")
+        {
+            settings.backFaceCulling = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const auto value = std::string{argv[++i]};
+        auto valid = true;
+
+        if (option == "--scene")
+            scene = value;
+        else if (option == "--output")
+            output = value;
+        else if (option == "--mode")
+        {
+            valid = modes.count(value) > 0u;
+
+            if (valid)
+                mode = modes.at(value);
+        }
+        else if (option == "--size")
+        {
+            auto separator = 'x';
+            std::istringstream stream(value);
+            stream >> settings.width >> separator >> settings.height;
+            valid = !stream.fail() && separator == 'x' && settings.width > 0u && settings.height > 0u;
+        }
+        else if (option == "--samples")
+        {
+            valid = parseNumber(value, settings.numSamples) &&
+                settings.numSamples >= 1u && settings.numSamples <= Rasterizer::s_maxNumSamples;
+        }
+        else if (option == "--transparency")
+        {
+            auto transparency = 0u;
+            valid = parseNumber(value, transparency) && transparency <= 255u;
+            settings.transparency = static_cast<unsigned char>(transparency);
+        }
+        else if (option == "--seed")
+            valid = parseNumber(value, settings.seed);
+        else if (option == "--eye")
+            valid = parseVector(value, settings.eye);
+        else if (option == "--center")
+            valid = parseVector(value, settings.center);
+        else if (option == "--up")
+            valid = parseVector(value, settings.up);
+        else if (option == "--threads")
+            valid = parseNumber(value, numThreads);
+        else if (option == "--compare")
+            compare = value;
+        else if (option == "--max-rmse")
+            valid = parseNumber(value, maxRmse) && maxRmse >= 0.0;
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Invalid value " << value << " for " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto mesh = Mesh{};
+
+    if (!mesh.loadObj(scene))
+    {
+        std::cerr << "Could not load " << scene << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const TaskScheduler scheduler(numThreads);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    ReferenceRenderer renderer(settings, scheduler);
+    const auto image = renderer.render(mesh, mode);
+
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << mesh.numTriangles() << " triangles, " << settings.width << "x" << settings.height << " with "
+        << settings.numSamples << " samples on " << scheduler.numThreads() << " threads in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+    if (!image.save(output))
+    {
+        std::cerr << "Could not write " << output << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (compare.empty())
+        return EXIT_SUCCESS;
+
+    auto reference = Image{};
+
+    if (!reference.load(compare))
+    {
+        std::cerr << "Could not load " << compare << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (reference.width() != image.width() || reference.height() != image.height())
+    {
+        std::cerr << "Size of " << compare << " does not match" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto error = image.compare(reference);
+
+    std::cout << "mean " << error.meanError << ", max " << error.maxError
+        << ", rmse " << error.rmse << ", psnr " << error.psnr << " dB" << std::endl;
+
+    if (maxRmse >= 0.0 && error.rmse > maxRmse)
+    {
+        std::cerr << "rmse exceeds " << maxRmse << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
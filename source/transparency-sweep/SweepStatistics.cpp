@@ -0,0 +1,97 @@
+#include "SweepStatistics.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+
+std::vector<SweepCombination> SweepStatistics::combinations(const std::vector<SweepParameter> & parameters)
+{
+    auto result = std::vector<SweepCombination>{ SweepCombination{} };
+
+    for (const auto & parameter : parameters)
+    {
+        auto extended = std::vector<SweepCombination>{};
+
+        for (const auto & combination : result)
+        {
+            for (const auto & value : parameter.values)
+            {
+                extended.push_back(combination);
+                extended.back().push_back(value);
+            }
+        }
+
+        result = std::move(extended);
+    }
+
+    return result;
+}
+
+FrameTimeStatistics SweepStatistics::frameTimes(std::vector<double> milliseconds)
+{
+    if (milliseconds.empty())
+        return { 0.0, 0.0 };
+
+    std::sort(milliseconds.begin(), milliseconds.end());
+
+    const auto mean = std::accumulate(milliseconds.begin(), milliseconds.end(), 0.0) / milliseconds.size();
+
+    // nearest rank
+    const auto rank = static_cast<size_t>(std::ceil(0.99 * milliseconds.size()));
+    const auto percentile99 = milliseconds[std::max(rank, size_t{1u}) - 1u];
+
+    return { mean, percentile99 };
+}
+
+double SweepStatistics::meanSquaredError(const std::vector<unsigned char> & frame, const std::vector<unsigned char> & reference)
+{
+    assert(frame.size() == reference.size() && frame.size() % 4u == 0u);
+
+    if (frame.empty())
+        return 0.0;
+
+    auto sum = 0.0;
+
+    for (auto i = size_t{0u}; i < frame.size(); i += 4u)
+    {
+        for (auto channel = size_t{0u}; channel < 3u; ++channel)
+        {
+            const auto difference = (static_cast<double>(frame[i + channel]) - reference[i + channel]) / 255.0;
+            sum += difference * difference;
+        }
+    }
+
+    return sum / (frame.size() / 4u * 3u);
+}
+
+ImageErrorStatistics SweepStatistics::imageError(const std::vector<double> & meanSquaredErrors)
+{
+    if (meanSquaredErrors.empty())
+        return { 0.0, std::numeric_limits<double>::infinity() };
+
+    const auto meanSquaredError = std::accumulate(meanSquaredErrors.begin(), meanSquaredErrors.end(), 0.0) / meanSquaredErrors.size();
+    const auto rmse = std::sqrt(meanSquaredError);
+
+    return { rmse, rmse > 0.0 ? 20.0 * std::log10(1.0 / rmse) : std::numeric_limits<double>::infinity() };
+}
+
+std::string SweepStatistics::csvField(const std::string & value)
+{
+    if (value.find_first_of(",\"\n") == std::string::npos)
+        return value;
+
+    auto quoted = std::string{"\""};
+
+    for (const auto character : value)
+    {
+        if (character == '"')
+            quoted += '"';
+
+        quoted += character;
+    }
+
+    return quoted + "\"";
+}
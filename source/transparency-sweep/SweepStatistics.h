@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+struct SweepParameter
+{
+    std::string name;
+    std::vector<std::string> values;
+};
+
+using SweepCombination = std::vector<std::string>;
+
+struct FrameTimeStatistics
+{
+    double mean;
+    double percentile99;
+};
+
+struct ImageErrorStatistics
+{
+    double rmse;
+    double psnr;
+};
+
+class SweepStatistics
+{
+public:
+    // cartesian product, the last parameter varies fastest
+    static std::vector<SweepCombination> combinations(const std::vector<SweepParameter> & parameters);
+
+    static FrameTimeStatistics frameTimes(std::vector<double> milliseconds);
+
+    // frames are RGBA8, alpha is ignored
+    static double meanSquaredError(const std::vector<unsigned char> & frame, const std::vector<unsigned char> & reference);
+    static ImageErrorStatistics imageError(const std::vector<double> & meanSquaredErrors);
+
+    static std::string csvField(const std::string & value);
+};
@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <glbinding/Binding.h>
+#include <glbinding/gl/gl.h>
+
+#include <globjects/base/ref_ptr.h>
+#include <globjects/Framebuffer.h>
+#include <globjects/Texture.h>
+
+#include <gloperate/painter/Painter.h>
+#include <gloperate/painter/AbstractCameraCapability.h>
+#include <gloperate/painter/AbstractTargetFramebufferCapability.h>
+#include <gloperate/painter/AbstractViewportCapability.h>
+#include <gloperate/plugin/PainterPlugin.h>
+#include <gloperate/plugin/PluginManager.h>
+#include <gloperate/resources/ResourceManager.h>
+
+#include <gloperate-assimp/AssimpSceneLoader.h>
+
+#include <reflectionzeug/property/AbstractEnumInterface.h>
+#include <reflectionzeug/property/Property.h>
+
+#include "SweepStatistics.h"
+
+
+using namespace gl;
+
+namespace
+{
+
+struct Options
+{
+    std::string painter = "StochasticTransparency";
+    std::string output;
+    unsigned int width = 640u;
+    unsigned int height = 360u;
+    unsigned int numFrames = 60u;
+    unsigned int warmupMilliseconds = 500u;
+    std::vector<std::string> sweeps;
+    std::vector<std::string> references;
+    std::vector<std::string> metrics;
+};
+
+void printUsage()
+{
+    std::cout
+        << "Usage: transparency-sweep [options]\n"
+        << "\n"
+        << "Renders every combination of the swept painter properties along an orbit around the scene and\n"
+        << "writes frame times, painter metrics and the image error against a reference configuration as csv.\n"
+        << "\n"
+        << "  --painter <name>          painter plugin (StochasticTransparency)\n"
+        << "  --output <file.csv>       csv file, written to stdout if omitted\n"
+        << "  --size <width>x<height>   framebuffer size (640x360)\n"
+        << "  --frames <n>              camera positions along the path (60)\n"
+        << "  --warmup <ms>             rendering time before measuring each combination (500)\n"
+        << "  --sweep <name>=<values>   comma separated values, * for all choices of an enum or bool property\n"
+        << "                            and all powers of two within the range of a numeric property\n"
+        << "  --reference <name>=<value> value of the reference configuration, defaults to the best quality\n"
+        << "  --metric <name>           painter property reported per combination (memory_footprint_mib)\n"
+        << "\n"
+        << "Without --sweep, num_samples, optimization and attachment_format are swept completely.\n"
+        << std::flush;
+}
+
+bool parseUnsigned(const std::string & text, unsigned int & number)
+{
+    std::istringstream stream(text);
+
+    stream >> number;
+
+    // extraction into unsigned types silently wraps negative input
+    return !stream.fail() && stream.eof() && text.find('-') == std::string::npos;
+}
+
+bool splitAssignment(const std::string & text, std::string & name, std::string & value)
+{
+    const auto separator = text.find('=');
+
+    if (separator == std::string::npos || separator == 0u)
+        return false;
+
+    name = text.substr(0u, separator);
+    value = text.substr(separator + 1u);
+    return true;
+}
+
+std::vector<std::string> splitList(const std::string & text)
+{
+    auto values = std::vector<std::string>{};
+    std::istringstream stream(text);
+    auto value = std::string{};
+
+    while (std::getline(stream, value, ','))
+    {
+        if (!value.empty())
+            values.push_back(value);
+    }
+
+    return values;
+}
+
+// all values a property can take, so new options are swept without changing this tool
+std::vector<std::string> allValues(reflectionzeug::AbstractProperty * property)
+{
+    if (auto enumInterface = dynamic_cast<reflectionzeug::AbstractEnumInterface *>(property))
+        return enumInterface->strings();
+
+    if (dynamic_cast<reflectionzeug::Property<bool> *>(property))
+        return { "false", "true" };
+
+    auto values = std::vector<std::string>{};
+
+    if (!property->hasOption("minimum") || !property->hasOption("maximum"))
+        return values;
+
+    const auto minimum = std::max(property->option("minimum").value<int>(), 1);
+    const auto maximum = property->option("maximum").value<int>();
+
+    for (auto value = 1; value <= maximum; value *= 2)
+    {
+        if (value >= minimum)
+            values.push_back(std::to_string(value));
+    }
+
+    return values;
+}
+
+bool setProperty(gloperate::Painter & painter, const std::string & name, const std::string & value)
+{
+    const auto property = painter.property(name);
+
+    if (!property || !property->isValue())
+    {
+        std::cerr << "Painter has no property " << name << std::endl;
+        return false;
+    }
+
+    if (!property->asValue()->fromString(value))
+    {
+        std::cerr << "Invalid value " << value << " for " << name << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::string propertyString(gloperate::Painter & painter, const std::string & name)
+{
+    const auto property = painter.property(name);
+
+    if (!property || !property->isValue())
+        return "";
+
+    return property->asValue()->toString();
+}
+
+class SweepRenderer
+{
+public:
+    SweepRenderer(gloperate::Painter & painter, const Options & options)
+    :   m_painter(painter)
+    ,   m_options(options)
+    ,   m_camera(painter.getCapability<gloperate::AbstractCameraCapability>())
+    {
+        const auto viewport = painter.getCapability<gloperate::AbstractViewportCapability>();
+        viewport->setViewport(0, 0, options.width, options.height);
+
+        painter.initialize();
+
+        m_colorAttachment = globjects::Texture::createDefault(GL_TEXTURE_2D);
+        m_colorAttachment->image2D(0, GL_RGBA8, options.width, options.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        m_depthAttachment = globjects::Texture::createDefault(GL_TEXTURE_2D);
+        m_depthAttachment->image2D(0, GL_DEPTH_COMPONENT, options.width, options.height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
+
+        m_fbo = new globjects::Framebuffer{};
+        m_fbo->attachTexture(GL_COLOR_ATTACHMENT0, m_colorAttachment);
+        m_fbo->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
+
+        painter.getCapability<gloperate::AbstractTargetFramebufferCapability>()->setFramebuffer(m_fbo);
+
+        glGenQueries(2, m_queries);
+    }
+
+    ~SweepRenderer()
+    {
+        glDeleteQueries(2, m_queries);
+    }
+
+    // renders until the warmup time passed, e.g., to let masks tables finish in the background
+    void warmup()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto duration = std::chrono::milliseconds{m_options.warmupMilliseconds};
+
+        do
+        {
+            renderFrame(0u);
+            glFinish();
+        }
+        while (std::chrono::steady_clock::now() - start < duration);
+    }
+
+    // returns the gpu time of the frame in milliseconds
+    double renderFrame(unsigned int frame, std::vector<unsigned char> * pixels = nullptr)
+    {
+        // orbit around the scene with a gentle vertical motion
+        const auto angle = 2.0f * glm::pi<float>() * frame / m_options.numFrames;
+
+        m_camera->setCenter(glm::vec3{0.0f, 0.25f, 0.0f});
+        m_camera->setEye(glm::vec3{1.4f * std::sin(angle), 0.6f + 0.2f * std::sin(2.0f * angle), 1.4f * std::cos(angle)});
+        m_camera->setUp(glm::vec3{0.0f, 1.0f, 0.0f});
+
+        glQueryCounter(m_queries[0], GL_TIMESTAMP);
+        m_painter.paint();
+        glQueryCounter(m_queries[1], GL_TIMESTAMP);
+
+        auto start = GLuint64{0u}, end = GLuint64{0u};
+        glGetQueryObjectui64v(m_queries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(m_queries[1], GL_QUERY_RESULT, &end);
+
+        if (pixels)
+        {
+            pixels->resize(m_options.width * m_options.height * 4u);
+
+            m_fbo->bind(GL_READ_FRAMEBUFFER);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            glReadPixels(0, 0, m_options.width, m_options.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels->data());
+            globjects::Framebuffer::unbind(GL_READ_FRAMEBUFFER);
+        }
+
+        return static_cast<double>(end - start) / 1.0e6;
+    }
+
+private:
+    gloperate::Painter & m_painter;
+    const Options & m_options;
+    gloperate::AbstractCameraCapability * m_camera;
+
+    globjects::ref_ptr<globjects::Framebuffer> m_fbo;
+    globjects::ref_ptr<globjects::Texture> m_colorAttachment;
+    globjects::ref_ptr<globjects::Texture> m_depthAttachment;
+
+    GLuint m_queries[2];
+};
+
+}
+
+int main(int argc, char * argv[])
+{
+    auto options = Options{};
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        const auto option = std::string{argv[i]};
+
+        if (option == "--help" || option == "-h")
+        {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const auto value = std::string{argv[++i]};
+
+        if (option == "--painter")
+            options.painter = value;
+        else if (option == "--output")
+            options.output = value;
+        else if (option == "--size")
+        {
+            auto separator = 'x';
+            std::istringstream stream(value);
+            stream >> options.width >> separator >> options.height;
+
+            if (stream.fail() || separator != 'x' || options.width == 0u || options.height == 0u)
+            {
+                std::cerr << "Invalid size " << value << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option == "--frames")
+        {
+            if (!parseUnsigned(value, options.numFrames) || options.numFrames == 0u)
+            {
+                std::cerr << "Invalid number of frames " << value << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option == "--warmup")
+        {
+            if (!parseUnsigned(value, options.warmupMilliseconds))
+            {
+                std::cerr << "Invalid warmup " << value << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option == "--sweep")
+            options.sweeps.push_back(value);
+        else if (option == "--reference")
+            options.references.push_back(value);
+        else if (option == "--metric")
+            options.metrics.push_back(value);
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.sweeps.empty())
+        options.sweeps = { "num_samples=*", "optimization=*", "attachment_format=*" };
+
+    if (options.metrics.empty())
+        options.metrics = { "memory_footprint_mib" };
+
+    QGuiApplication application(argc, argv);
+
+    auto format = QSurfaceFormat{};
+    format.setVersion(3, 2);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    QOpenGLContext context;
+    context.setFormat(format);
+
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    if (!context.create() || !context.makeCurrent(&surface))
+    {
+        std::cerr << "Could not create an OpenGL context" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    glbinding::Binding::initialize();
+
+    gloperate::ResourceManager resourceManager;
+    resourceManager.addLoader(new gloperate_assimp::AssimpSceneLoader());
+
+    gloperate::PluginManager::init(argv[0]);
+
+    gloperate::PluginManager pluginManager;
+    pluginManager.scan("painters");
+
+    auto plugin = dynamic_cast<gloperate::PainterPlugin *>(pluginManager.plugin(options.painter));
+
+    if (!plugin)
+    {
+        std::cerr << "Could not find painter plugin " << options.painter << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto painter = std::unique_ptr<gloperate::Painter>{plugin->createPainter(resourceManager)};
+
+    if (!painter)
+    {
+        std::cerr << "Could not create painter " << options.painter << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // initialization determines property limits like the maximum sample count
+    SweepRenderer renderer(*painter, options);
+
+    auto parameters = std::vector<SweepParameter>{};
+
+    for (const auto & sweep : options.sweeps)
+    {
+        auto parameter = SweepParameter{};
+        auto values = std::string{};
+
+        if (!splitAssignment(sweep, parameter.name, values))
+        {
+            std::cerr << "Invalid sweep " << sweep << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const auto property = painter->property(parameter.name);
+
+        if (!property)
+        {
+            std::cerr << "Painter has no property " << parameter.name << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        parameter.values = values == "*" ? allValues(property) : splitList(values);
+
+        if (parameter.values.empty())
+        {
+            std::cerr << "No values to sweep for " << parameter.name << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        parameters.push_back(parameter);
+    }
+
+    // highest sample count and exact alpha handling unless overridden
+    auto reference = std::vector<std::pair<std::string, std::string>>{};
+
+    for (const auto & parameter : parameters)
+    {
+        auto value = parameter.values.back();
+
+        if (parameter.name == "optimization")
+            value = "AlphaCorrectionAndDepthBased";
+        else if (parameter.name == "attachment_format")
+            value = "Float32";
+
+        reference.emplace_back(parameter.name, value);
+    }
+
+    for (const auto & assignment : options.references)
+    {
+        auto name = std::string{}, value = std::string{};
+
+        if (!splitAssignment(assignment, name, value))
+        {
+            std::cerr << "Invalid reference " << assignment << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        reference.emplace_back(name, value);
+    }
+
+    for (const auto & assignment : reference)
+    {
+        if (!setProperty(*painter, assignment.first, assignment.second))
+            return EXIT_FAILURE;
+    }
+
+    renderer.warmup();
+
+    auto referenceFrames = std::vector<std::vector<unsigned char>>(options.numFrames);
+
+    for (auto frame = 0u; frame < options.numFrames; ++frame)
+        renderer.renderFrame(frame, &referenceFrames[frame]);
+
+    std::ofstream file;
+
+    if (!options.output.empty())
+    {
+        file.open(options.output);
+
+        if (!file)
+        {
+            std::cerr << "Could not write " << options.output << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto & csv = options.output.empty() ? std::cout : file;
+
+    csv << "painter";
+
+    for (const auto & parameter : parameters)
+        csv << "," << SweepStatistics::csvField(parameter.name);
+
+    csv << ",mean_frame_ms,p99_frame_ms";
+
+    for (const auto & metric : options.metrics)
+        csv << "," << SweepStatistics::csvField(metric);
+
+    csv << ",rmse,psnr_db" << std::endl;
+
+    const auto combinations = SweepStatistics::combinations(parameters);
+
+    for (auto i = size_t{0u}; i < combinations.size(); ++i)
+    {
+        const auto & combination = combinations[i];
+
+        for (auto j = size_t{0u}; j < parameters.size(); ++j)
+        {
+            if (!setProperty(*painter, parameters[j].name, combination[j]))
+                return EXIT_FAILURE;
+        }
+
+        std::cerr << "[" << (i + 1u) << "/" << combinations.size() << "]";
+
+        for (auto j = size_t{0u}; j < parameters.size(); ++j)
+            std::cerr << " " << parameters[j].name << "=" << combination[j];
+
+        std::cerr << std::endl;
+
+        renderer.warmup();
+
+        auto frameTimes = std::vector<double>{};
+        auto squaredErrors = std::vector<double>{};
+        auto pixels = std::vector<unsigned char>{};
+
+        for (auto frame = 0u; frame < options.numFrames; ++frame)
+        {
+            frameTimes.push_back(renderer.renderFrame(frame, &pixels));
+            squaredErrors.push_back(SweepStatistics::meanSquaredError(pixels, referenceFrames[frame]));
+        }
+
+        const auto times = SweepStatistics::frameTimes(frameTimes);
+        const auto error = SweepStatistics::imageError(squaredErrors);
+
+        csv << SweepStatistics::csvField(options.painter);
+
+        for (const auto & value : combination)
+            csv << "," << SweepStatistics::csvField(value);
+
+        csv << std::fixed << std::setprecision(3) << "," << times.mean << "," << times.percentile99;
+
+        for (const auto & metric : options.metrics)
+            csv << "," << SweepStatistics::csvField(propertyString(*painter, metric));
+
+        csv << std::setprecision(6) << "," << error.rmse << "," << std::setprecision(2) << error.psnr << std::endl;
+    }
+
+    // the painter owns gl objects and has to go while the context is current
+    painter.reset();
+    context.doneCurrent();
+
+    return EXIT_SUCCESS;
+}
@@ -77,6 +77,7 @@ std::string AssimpLoader::allLoadingTypes() const
 
 aiScene * AssimpLoader::load(const std::string & filename, std::function<void(int, int)> /*progress*/) const
 {
+    // changing the post-processing requires incrementing MeshCache::s_loaderVersion
     auto scene = aiImportFile(
         filename.c_str(),
         aiProcess_Triangulate           |
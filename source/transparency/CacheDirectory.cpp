@@ -0,0 +1,97 @@
+#include "CacheDirectory.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+
+#ifdef _WIN32
+const auto kSeparator = '\\';
+#else
+const auto kSeparator = '/';
+#endif
+
+std::string environment(const char * name)
+{
+    const auto value = std::getenv(name);
+    return value ? std::string{value} : std::string{};
+}
+
+std::string baseDirectory()
+{
+#ifdef _WIN32
+    auto directory = environment("LOCALAPPDATA");
+
+    if (directory.empty())
+        directory = environment("TEMP");
+#else
+    auto directory = environment("XDG_CACHE_HOME");
+
+    if (directory.empty() && !environment("HOME").empty())
+        directory = environment("HOME") + "/.cache";
+
+    if (directory.empty())
+        directory = environment("TMPDIR");
+
+    if (directory.empty())
+        directory = "/tmp";
+#endif
+
+    return directory;
+}
+
+void makeDirectory(const std::string & path)
+{
+    // fails harmlessly if it exists already, a missing directory only shows as failing cache writes
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+int processId()
+{
+#ifdef _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+}
+
+std::string CacheDirectory::path()
+{
+    const auto base = baseDirectory();
+    const auto application = base + kSeparator + "glexamples";
+    const auto directory = application + kSeparator + "transparency";
+
+    // the base may be missing as well, e.g. a fresh ~/.cache
+    makeDirectory(base);
+    makeDirectory(application);
+    makeDirectory(directory);
+
+    return directory + kSeparator;
+}
+
+std::string CacheDirectory::temporaryFilePath(const std::string & filePath)
+{
+    std::stringstream stream;
+    stream << filePath << "." << processId() << "_" << std::this_thread::get_id() << ".tmp";
+
+    return stream.str();
+}
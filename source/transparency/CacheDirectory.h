@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+
+/**
+ * Location of the generated caches, kept per user outside the source tree. Uses the
+ * platform cache directory and falls back to the temporary directory if it is not set.
+ */
+class CacheDirectory
+{
+public:
+    /** Returns the directory ending with a separator, creates it on first use */
+    static std::string path();
+
+    /** Returns a temporary name next to the file, unique per process and thread so concurrent writers never share it */
+    static std::string temporaryFilePath(const std::string & filePath);
+};
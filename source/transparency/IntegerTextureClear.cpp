@@ -0,0 +1,45 @@
+#include "IntegerTextureClear.h"
+
+#include <glm/glm.hpp>
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/extension.h>
+#include <glbinding/gl/functions.h>
+
+#include <globjects/globjects.h>
+#include <globjects/Framebuffer.h>
+#include <globjects/Texture.h>
+
+
+using namespace gl;
+using namespace globjects;
+
+IntegerTextureClear::IntegerTextureClear()
+:   m_clearTexture(false)
+{
+}
+
+IntegerTextureClear::~IntegerTextureClear() = default;
+
+void IntegerTextureClear::initGL()
+{
+    m_clearTexture = hasExtension(GLextension::GL_ARB_clear_texture);
+    
+    if (m_clearTexture)
+        return;
+    
+    m_fbo = make_ref<Framebuffer>();
+    m_fbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+}
+
+void IntegerTextureClear::clear(Texture * texture, GLuint value)
+{
+    if (m_clearTexture)
+    {
+        glClearTexImage(texture->id(), 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &value);
+        return;
+    }
+    
+    m_fbo->attachTexture(GL_COLOR_ATTACHMENT0, texture);
+    m_fbo->clearBuffer(GL_COLOR, 0, glm::uvec4(value));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glbinding/gl/types.h>
+
+#include <globjects/base/ref_ptr.h>
+
+
+namespace globjects
+{
+    class Framebuffer;
+    class Texture;
+}
+
+/**
+ * Clears single channel integer textures to a constant value. Uses glClearTexImage where
+ * GL_ARB_clear_texture is available and a framebuffer clear otherwise, which changes the framebuffer binding.
+ */
+class IntegerTextureClear
+{
+public:
+    IntegerTextureClear();
+    ~IntegerTextureClear();
+    
+    void initGL();
+    
+    void clear(globjects::Texture * texture, gl::GLuint value = 0u);
+
+private:
+    bool m_clearTexture;
+    globjects::ref_ptr<globjects::Framebuffer> m_fbo;
+};
@@ -0,0 +1,472 @@
+#include "DualDepthPeeling.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <glbinding/gl/boolean.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/bitfield.h>
+
+#include <globjects/globjects.h>
+#include <globjects/logging.h>
+#include <globjects/Framebuffer.h>
+#include <globjects/DebugMessage.h>
+#include <globjects/Program.h>
+#include <globjects/Query.h>
+#include <globjects/Shader.h>
+#include <globjects/Texture.h>
+
+#include <gloperate/base/RenderTargetType.h>
+#include <gloperate/base/make_unique.hpp>
+#include <gloperate/resources/ResourceManager.h>
+#include <gloperate/painter/TargetFramebufferCapability.h>
+#include <gloperate/painter/ViewportCapability.h>
+#include <gloperate/painter/PerspectiveProjectionCapability.h>
+#include <gloperate/painter/CameraCapability.h>
+#include <gloperate/primitives/AdaptiveGrid.h>
+#include <gloperate/primitives/ScreenAlignedQuad.h>
+#include <gloperate/primitives/PolygonalGeometry.h>
+
+#include <reflectionzeug/PropertyGroup.h>
+
+#include "CacheDirectory.h"
+#include "diagnostics/DepthComplexityDiagnostics.h"
+#include "scene/LodSelector.h"
+#include "scene/MeshCache.h"
+#include "scene/MeshDrawable.h"
+
+
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+DualDepthPeeling::DualDepthPeeling(gloperate::ResourceManager & resourceManager)
+:   Painter(resourceManager)
+,   m_targetFramebufferCapability(addCapability(new gloperate::TargetFramebufferCapability()))
+,   m_viewportCapability(addCapability(new gloperate::ViewportCapability()))
+,   m_projectionCapability(addCapability(new gloperate::PerspectiveProjectionCapability(m_viewportCapability)))
+,   m_cameraCapability(addCapability(new gloperate::CameraCapability()))
+,   m_transparency(160u)
+,   m_backFaceCulling(false)
+,   m_maxNumPeels(32u)
+,   m_numPeels(0u)
+,   m_lodSelector(new LodSelector(*this, m_viewportCapability, m_projectionCapability, m_cameraCapability))
+,   m_diagnostics(new DepthComplexityDiagnostics(*this, m_viewportCapability, m_targetFramebufferCapability))
+{
+    setupPropertyGroup();
+}
+
+DualDepthPeeling::~DualDepthPeeling() = default;
+
+void DualDepthPeeling::setupPropertyGroup()
+{
+    addProperty<unsigned char>("transparency", this,
+        &DualDepthPeeling::transparency, &DualDepthPeeling::setTransparency)->setOptions({
+        { "minimum", 0 },
+        { "maximum", 255 },
+        { "step", 1 }});
+    
+    addProperty<bool>("back_face_culling", this,
+        &DualDepthPeeling::backFaceCulling, &DualDepthPeeling::setBackFaceCulling);
+    
+    addProperty<uint16_t>("max_num_peels", this,
+        &DualDepthPeeling::maxNumPeels, &DualDepthPeeling::setMaxNumPeels)->setOptions({
+        { "minimum", 1u },
+        { "maximum", static_cast<unsigned int>(kMaxNumPeels) }});
+    
+    addProperty<const uint16_t>("num_peels", this,
+        &DualDepthPeeling::numPeels);
+    
+    addProperty<const std::string>("peel_times_ms", this,
+        &DualDepthPeeling::peelTimes);
+}
+
+unsigned char DualDepthPeeling::transparency() const
+{
+    return m_transparency;
+}
+
+void DualDepthPeeling::setTransparency(unsigned char transparency)
+{
+    m_transparency = transparency;
+}
+
+bool DualDepthPeeling::backFaceCulling() const
+{
+    return m_backFaceCulling;
+}
+
+void DualDepthPeeling::setBackFaceCulling(bool b)
+{
+    m_backFaceCulling = b;
+}
+
+uint16_t DualDepthPeeling::maxNumPeels() const
+{
+    return m_maxNumPeels;
+}
+
+void DualDepthPeeling::setMaxNumPeels(uint16_t numPeels)
+{
+    m_maxNumPeels = numPeels;
+}
+
+uint16_t DualDepthPeeling::numPeels() const
+{
+    return m_numPeels;
+}
+
+void DualDepthPeeling::setNumPeels(uint16_t numPeels)
+{
+    m_numPeels = numPeels;
+}
+
+const std::string & DualDepthPeeling::peelTimes() const
+{
+    return m_peelTimes;
+}
+
+void DualDepthPeeling::setPeelTimes(const std::string & times)
+{
+    m_peelTimes = times;
+}
+
+void DualDepthPeeling::onInitialize()
+{
+    globjects::init();
+    globjects::DebugMessage::enable();
+
+#ifdef __APPLE__
+    Shader::clearGlobalReplacements();
+    Shader::globalReplace("#version 140", "#version 150");
+
+    debug() << "Using global OS X shader replacement '#version 140' -> '#version 150'" << std::endl;
+#endif
+
+    m_grid = make_ref<gloperate::AdaptiveGrid>();
+    m_grid->setColor({0.6f, 0.6f, 0.6f});
+    
+    m_occlusionQuery = make_ref<Query>();
+    
+    for (auto i = 0u; i < kMaxNumPeels; ++i)
+        m_timerQueries.push_back(make_ref<Query>());
+    
+    setupPrograms();
+    setupProjection();
+    setupFramebuffer();
+    setupDrawable();
+    
+    m_diagnostics->initGL();
+}
+
+void DualDepthPeeling::onPaint()
+{
+    if (m_viewportCapability->hasChanged())
+    {
+        glViewport(
+            m_viewportCapability->x(),
+            m_viewportCapability->y(),
+            m_viewportCapability->width(),
+            m_viewportCapability->height());
+
+        m_viewportCapability->setChanged(false);
+        
+        updateFramebuffer();
+    }
+    
+    const auto transform = m_projectionCapability->projection() * m_cameraCapability->view();
+    
+    m_grid->update(m_cameraCapability->eye(), transform);
+    
+    m_initProgram->setUniform("transform", transform);
+    m_peelProgram->setUniform("transform", transform);
+    m_peelProgram->setUniform("transparency", static_cast<unsigned int>(m_transparency));
+    
+    m_lodSelector->setNumTriangles(m_lodSelector->select(m_drawables));
+    
+    m_diagnostics->begin();
+    
+    clearBuffers();
+    renderOpaqueGeometry();
+    initializeDepth();
+    
+    // a peel without back layer samples has consumed the last remaining layer of every pixel
+    auto numPeels = 0u;
+    auto samplesPassed = true;
+    
+    while (samplesPassed && numPeels < m_maxNumPeels)
+        samplesPassed = peel(numPeels++);
+    
+    composite(numPeels);
+    updatePeelTimes(numPeels);
+    
+    m_diagnostics->end();
+    m_diagnostics->render(transform, [this] () { m_grid->draw(); }, [this] () { for (auto & drawable : m_drawables) drawable->draw(); });
+    
+    Framebuffer::unbind(GL_FRAMEBUFFER);
+}
+
+void DualDepthPeeling::setupFramebuffer()
+{
+    m_opaqueColorAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    m_depthAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    m_backColorAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    
+    m_opaqueFbo = make_ref<Framebuffer>();
+    
+    m_opaqueFbo->attachTexture(GL_COLOR_ATTACHMENT0, m_opaqueColorAttachment);
+    m_opaqueFbo->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
+    
+    for (auto i = 0u; i < 2u; ++i)
+    {
+        m_minMaxDepthAttachments[i] = Texture::createDefault(GL_TEXTURE_2D);
+        m_minMaxDepthAttachments[i]->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        m_minMaxDepthAttachments[i]->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        
+        m_frontColorAttachments[i] = Texture::createDefault(GL_TEXTURE_2D);
+        
+        // transparent fragments are still tested against the opaque depth
+        m_peelFbos[i] = make_ref<Framebuffer>();
+        m_peelFbos[i]->attachTexture(kMinMaxDepthAttachment, m_minMaxDepthAttachments[i]);
+        m_peelFbos[i]->attachTexture(kFrontColorAttachment, m_frontColorAttachments[i]);
+        m_peelFbos[i]->attachTexture(kBackColorAttachment, m_backColorAttachment);
+        m_peelFbos[i]->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
+    }
+    
+    updateFramebuffer();
+    
+    m_opaqueFbo->printStatus(true);
+    m_peelFbos[0]->printStatus(true);
+    m_peelFbos[1]->printStatus(true);
+}
+
+void DualDepthPeeling::setupProjection()
+{
+    static const auto zNear = 0.3f, zFar = 30.f, fovy = 50.f;
+
+    m_projectionCapability->setZNear(zNear);
+    m_projectionCapability->setZFar(zFar);
+    m_projectionCapability->setFovy(radians(fovy));
+
+    m_grid->setNearFar(zNear, zFar);
+}
+
+void DualDepthPeeling::setupPrograms()
+{
+    static const auto shaderPath = std::string{"data/transparency/"};
+    
+    const auto transparentVertexShader = Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "transparent_colors.vert");
+    const auto compositingVertexShader = Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "compositing.vert");
+    
+    m_initProgram = make_ref<Program>();
+    m_initProgram->attach(
+        transparentVertexShader,
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "dual_depth_peeling_init.frag"));
+    
+    m_peelProgram = make_ref<Program>();
+    m_peelProgram->attach(
+        transparentVertexShader,
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "dual_depth_peeling_peel.frag"));
+    
+    m_backBlendProgram = make_ref<Program>();
+    m_backBlendProgram->attach(
+        compositingVertexShader,
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "dual_depth_peeling_back_blend.frag"));
+    
+    m_compositingProgram = make_ref<Program>();
+    m_compositingProgram->attach(
+        compositingVertexShader,
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "dual_depth_peeling_compositing.frag"));
+    
+    m_peelProgram->setUniform("minMaxDepthTexture", 0);
+    m_peelProgram->setUniform("frontColorTexture", 1);
+    m_backBlendProgram->setUniform("backColorTexture", 2);
+    m_compositingProgram->setUniform("opaqueColorTexture", 0);
+    m_compositingProgram->setUniform("frontColorTexture", 1);
+    
+    m_backBlendQuad = make_ref<gloperate::ScreenAlignedQuad>(m_backBlendProgram);
+    m_compositingQuad = make_ref<gloperate::ScreenAlignedQuad>(m_compositingProgram);
+}
+
+void DualDepthPeeling::setupDrawable()
+{
+    // Load scene, the cache imports the file only once and maps the stored arrays afterwards
+    const auto scene = MeshCache{CacheDirectory::path()}.load("data/transparency/transparency_scene.obj", m_resourceManager);
+    if (!scene)
+    {
+        std::cout << "Could not load file" << std::endl;
+        return;
+    }
+
+    // Create a renderable for each mesh
+    for (const auto & mesh : scene->meshes()) {
+        m_drawables.push_back(gloperate::make_unique<MeshDrawable>(mesh));
+    }
+}
+
+void DualDepthPeeling::updateFramebuffer()
+{
+    const auto width = m_viewportCapability->width(), height = m_viewportCapability->height();
+    
+    // the opaque color doubles as back blender, back layers are blended onto it directly
+    m_opaqueColorAttachment->image2D(0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    m_depthAttachment->image2D(0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
+    m_backColorAttachment->image2D(0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    
+    for (auto i = 0u; i < 2u; ++i)
+    {
+        m_minMaxDepthAttachments[i]->image2D(0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
+        m_frontColorAttachments[i]->image2D(0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+}
+
+void DualDepthPeeling::clearBuffers()
+{
+    m_opaqueFbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+    
+    m_opaqueFbo->clearBuffer(GL_COLOR, 0, glm::vec4(0.85f, 0.87f, 0.91f, 1.0f));
+    m_opaqueFbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+}
+
+void DualDepthPeeling::renderOpaqueGeometry()
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+
+    m_opaqueFbo->bind(GL_FRAMEBUFFER);
+    m_opaqueFbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    m_grid->draw();
+}
+
+void DualDepthPeeling::initializeDepth()
+{
+    const auto & fbo = m_peelFbos[0];
+    
+    fbo->setDrawBuffers({ kMinMaxDepthAttachment, kFrontColorAttachment });
+    fbo->clearBuffer(GL_COLOR, 0, glm::vec4(-1.0f));
+    fbo->clearBuffer(GL_COLOR, 1, glm::vec4(0.0f));
+    
+    fbo->bind(GL_FRAMEBUFFER);
+    fbo->setDrawBuffer(kMinMaxDepthAttachment);
+    
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_MAX);
+    
+    m_initProgram->use();
+    drawTransparentGeometry();
+    m_initProgram->release();
+    
+    glDisable(GL_BLEND);
+}
+
+bool DualDepthPeeling::peel(unsigned int index)
+{
+    const auto & timerQuery = m_timerQueries.at(index);
+    timerQuery->begin(GL_TIME_ELAPSED);
+    
+    const auto previous = index % 2u, current = 1u - previous;
+    const auto & fbo = m_peelFbos[current];
+    
+    // max blending lets each pixel keep the nearest and farthest layer of this peel
+    fbo->setDrawBuffers({ kMinMaxDepthAttachment, kFrontColorAttachment, kBackColorAttachment });
+    fbo->clearBuffer(GL_COLOR, 0, glm::vec4(-1.0f));
+    fbo->clearBuffer(GL_COLOR, 1, glm::vec4(0.0f));
+    fbo->clearBuffer(GL_COLOR, 2, glm::vec4(0.0f));
+    
+    fbo->bind(GL_FRAMEBUFFER);
+    
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_MAX);
+    
+    m_minMaxDepthAttachments[previous]->bindActive(GL_TEXTURE0);
+    m_frontColorAttachments[previous]->bindActive(GL_TEXTURE1);
+    
+    m_peelProgram->use();
+    drawTransparentGeometry();
+    m_peelProgram->release();
+    
+    glDisable(GL_DEPTH_TEST);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    m_opaqueFbo->bind(GL_FRAMEBUFFER);
+    m_opaqueFbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+    
+    m_backColorAttachment->bindActive(GL_TEXTURE2);
+    
+    m_occlusionQuery->begin(GL_ANY_SAMPLES_PASSED);
+    m_backBlendQuad->draw();
+    m_occlusionQuery->end(GL_ANY_SAMPLES_PASSED);
+    
+    glDisable(GL_BLEND);
+    
+    timerQuery->end(GL_TIME_ELAPSED);
+    
+    return m_occlusionQuery->waitAndGet(GL_QUERY_RESULT) != 0u;
+}
+
+void DualDepthPeeling::composite(unsigned int numPeels)
+{
+    auto targetfbo = m_targetFramebufferCapability->framebuffer();
+    auto drawBuffer = GL_COLOR_ATTACHMENT0;
+    
+    if (!targetfbo)
+    {
+        targetfbo = Framebuffer::defaultFBO();
+        drawBuffer = GL_BACK_LEFT;
+    }
+    
+    glDisable(GL_DEPTH_TEST);
+    
+    targetfbo->bind(GL_FRAMEBUFFER);
+    
+    m_opaqueColorAttachment->bindActive(GL_TEXTURE0);
+    m_frontColorAttachments[numPeels % 2u]->bindActive(GL_TEXTURE1);
+    
+    m_compositingQuad->draw();
+    
+    const auto rect = std::array<GLint, 4>{{
+        m_viewportCapability->x(),
+        m_viewportCapability->y(),
+        m_viewportCapability->width(),
+        m_viewportCapability->height()
+    }};
+    
+    m_opaqueFbo->blit(GL_COLOR_ATTACHMENT0, rect, targetfbo, drawBuffer, rect, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+void DualDepthPeeling::updatePeelTimes(unsigned int numPeels)
+{
+    std::stringstream times;
+    times << std::fixed << std::setprecision(3);
+    
+    for (auto i = 0u; i < numPeels; ++i)
+    {
+        const auto nanoseconds = m_timerQueries[i]->waitAndGet64(GL_QUERY_RESULT);
+        times << (i > 0u ? " " : "") << static_cast<double>(nanoseconds) / 1.0e6;
+    }
+    
+    setNumPeels(static_cast<uint16_t>(numPeels));
+    setPeelTimes(times.str());
+}
+
+void DualDepthPeeling::drawTransparentGeometry()
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    
+    if (m_backFaceCulling)
+        glEnable(GL_CULL_FACE);
+    
+    for (auto & drawable : m_drawables)
+        drawable->draw();
+    
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+}
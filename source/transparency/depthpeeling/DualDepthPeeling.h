@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/types.h>
+#include <glbinding/gl/enum.h>
+
+#include <globjects/base/ref_ptr.h>
+
+#include <gloperate/painter/Painter.h>
+
+
+namespace globjects
+{
+    class Framebuffer;
+    class Program;
+    class Query;
+    class Texture;
+}
+
+namespace gloperate
+{
+    class AdaptiveGrid;
+    class ResourceManager;
+    class AbstractTargetFramebufferCapability;
+    class AbstractViewportCapability;
+    class AbstractPerspectiveProjectionCapability;
+    class AbstractCameraCapability;
+    class ScreenAlignedQuad;
+}
+
+class DepthComplexityDiagnostics;
+class LodSelector;
+class MeshDrawable;
+
+class DualDepthPeeling : public gloperate::Painter
+{
+public:
+    DualDepthPeeling(gloperate::ResourceManager & resourceManager);
+    virtual ~DualDepthPeeling() override;
+    
+public:
+    void setupPropertyGroup();
+    
+    unsigned char transparency() const;
+    void setTransparency(unsigned char transparency);
+    
+    bool backFaceCulling() const;
+    void setBackFaceCulling(bool b);
+    
+    uint16_t maxNumPeels() const;
+    void setMaxNumPeels(uint16_t numPeels);
+    
+    uint16_t numPeels() const;
+    void setNumPeels(uint16_t numPeels);
+    
+    const std::string & peelTimes() const;
+    void setPeelTimes(const std::string & times);
+    
+protected:
+    virtual void onInitialize() override;
+    virtual void onPaint() override;
+
+protected:
+    void setupFramebuffer();
+    void setupProjection();
+    void setupPrograms();
+    void setupDrawable();
+    void updateFramebuffer();
+    
+protected:
+    void clearBuffers();
+    void renderOpaqueGeometry();
+    void initializeDepth();
+    bool peel(unsigned int index);
+    void composite(unsigned int numPeels);
+    void updatePeelTimes(unsigned int numPeels);
+    
+    void drawTransparentGeometry();
+
+private:
+    /** \name Capabilities */
+    /** \{ */
+    
+    gloperate::AbstractTargetFramebufferCapability * m_targetFramebufferCapability;
+    gloperate::AbstractViewportCapability * m_viewportCapability;
+    gloperate::AbstractPerspectiveProjectionCapability * m_projectionCapability;
+    gloperate::AbstractCameraCapability * m_cameraCapability;
+    
+    /** \} */
+
+    /** \name Framebuffers and Textures */
+    /** \{ */
+    
+    static const auto kMinMaxDepthAttachment = gl::GL_COLOR_ATTACHMENT0;
+    static const auto kFrontColorAttachment = gl::GL_COLOR_ATTACHMENT1;
+    static const auto kBackColorAttachment = gl::GL_COLOR_ATTACHMENT2;
+    static const auto kMaxNumPeels = 64u;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_opaqueFbo;
+    globjects::ref_ptr<globjects::Texture> m_opaqueColorAttachment;
+    globjects::ref_ptr<globjects::Texture> m_depthAttachment;
+    
+    std::array<globjects::ref_ptr<globjects::Framebuffer>, 2> m_peelFbos;
+    std::array<globjects::ref_ptr<globjects::Texture>, 2> m_minMaxDepthAttachments;
+    std::array<globjects::ref_ptr<globjects::Texture>, 2> m_frontColorAttachments;
+    globjects::ref_ptr<globjects::Texture> m_backColorAttachment;
+    
+    /** \} */
+    
+    /** \name Queries */
+    /** \{ */
+    
+    globjects::ref_ptr<globjects::Query> m_occlusionQuery;
+    std::vector<globjects::ref_ptr<globjects::Query>> m_timerQueries;
+    
+    /** \} */
+    
+    /** \name Programs */
+    /** \{ */
+    
+    globjects::ref_ptr<globjects::Program> m_initProgram;
+    globjects::ref_ptr<globjects::Program> m_peelProgram;
+    globjects::ref_ptr<globjects::Program> m_backBlendProgram;
+    globjects::ref_ptr<globjects::Program> m_compositingProgram;
+    
+    /** \} */
+    
+    /** \name Geometry */
+    /** \{ */
+    
+    globjects::ref_ptr<gloperate::AdaptiveGrid> m_grid;
+    std::vector<std::unique_ptr<MeshDrawable>> m_drawables;
+    globjects::ref_ptr<gloperate::ScreenAlignedQuad> m_backBlendQuad;
+    globjects::ref_ptr<gloperate::ScreenAlignedQuad> m_compositingQuad;
+    
+    /** \} */
+
+    /** \name Properties */
+    /** \{ */
+    
+    unsigned char m_transparency;
+    bool m_backFaceCulling;
+    uint16_t m_maxNumPeels;
+    uint16_t m_numPeels;
+    std::string m_peelTimes;
+    std::unique_ptr<LodSelector> m_lodSelector;
+    std::unique_ptr<DepthComplexityDiagnostics> m_diagnostics;
+    
+    /** \} */
+};
@@ -0,0 +1,419 @@
+#include "DepthComplexityDiagnostics.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <glm/glm.hpp>
+
+#include <glbinding/gl/boolean.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/bitfield.h>
+#include <glbinding/gl/extension.h>
+#include <glbinding/gl/functions.h>
+
+#include <globjects/globjects.h>
+#include <globjects/Buffer.h>
+#include <globjects/Framebuffer.h>
+#include <globjects/Program.h>
+#include <globjects/Query.h>
+#include <globjects/Shader.h>
+#include <globjects/Texture.h>
+
+#include <gloperate/painter/Painter.h>
+#include <gloperate/painter/AbstractTargetFramebufferCapability.h>
+#include <gloperate/painter/AbstractViewportCapability.h>
+#include <gloperate/primitives/ScreenAlignedQuad.h>
+
+
+using namespace gl;
+using namespace globjects;
+
+namespace
+{
+
+// the histogram buckets are followed by the sum, the maximum and the number of covered pixels
+const auto kNumStatistics = DepthComplexityDiagnostics::s_numBuckets + 3u;
+
+}
+
+DepthComplexityDiagnostics::DepthComplexityDiagnostics(
+    gloperate::Painter & painter,
+    gloperate::AbstractViewportCapability * viewportCapability,
+    gloperate::AbstractTargetFramebufferCapability * targetFramebufferCapability)
+:   m_viewportCapability(viewportCapability)
+,   m_targetFramebufferCapability(targetFramebufferCapability)
+,   m_width(0)
+,   m_height(0)
+,   m_pendingStatistics{{ false, false }}
+,   m_pendingInvocations{{ false, false }}
+,   m_invocationQueryActive(false)
+,   m_frame(0u)
+,   m_pipelineStatistics(false)
+,   m_mode(DepthComplexityDiagnosticsMode::Off)
+,   m_heatmapMaxLayers(16u)
+,   m_statisticsInterval(30u)
+,   m_meanDepthComplexity(0.0f)
+,   m_maxDepthComplexity(0u)
+,   m_shadedFragments(0u)
+,   m_shaderInvocations(0u)
+{
+    // Both modes count in an extra pass that redraws the opaque and transparent geometry with one atomic per
+    // transparent fragment. The heatmap counts every frame, the statistics only every statistics_interval frames,
+    // which keeps them cheap enough for a monitoring viewport at the price of less current values.
+    painter.addProperty<DepthComplexityDiagnosticsMode>("diagnostics", this,
+        &DepthComplexityDiagnostics::mode,
+        &DepthComplexityDiagnostics::setMode)->setStrings({
+        { DepthComplexityDiagnosticsMode::Off, "Off" },
+        { DepthComplexityDiagnosticsMode::Statistics, "Statistics" },
+        { DepthComplexityDiagnosticsMode::Heatmap, "Heatmap" }});
+    
+    painter.addProperty<uint16_t>("heatmap_max_layers", this,
+        &DepthComplexityDiagnostics::heatmapMaxLayers,
+        &DepthComplexityDiagnostics::setHeatmapMaxLayers)->setOptions({
+        { "minimum", 1u },
+        { "maximum", 256u }});
+    
+    painter.addProperty<uint16_t>("statistics_interval", this,
+        &DepthComplexityDiagnostics::statisticsInterval,
+        &DepthComplexityDiagnostics::setStatisticsInterval)->setOptions({
+        { "minimum", 1u }});
+    
+    painter.addProperty<const float>("mean_depth_complexity", this,
+        &DepthComplexityDiagnostics::meanDepthComplexity)->setOptions({
+        { "precision", 2u }});
+    
+    painter.addProperty<const uint32_t>("max_depth_complexity", this,
+        &DepthComplexityDiagnostics::maxDepthComplexity);
+    
+    // pixels per layer count, the last bucket holds all deeper pixels
+    painter.addProperty<const std::string>("depth_complexity_histogram", this,
+        &DepthComplexityDiagnostics::depthComplexityHistogram);
+    
+    painter.addProperty<const uint32_t>("shaded_fragments", this,
+        &DepthComplexityDiagnostics::shadedFragments);
+    
+    painter.addProperty<const uint32_t>("shader_invocations", this,
+        &DepthComplexityDiagnostics::shaderInvocations);
+}
+
+DepthComplexityDiagnostics::~DepthComplexityDiagnostics() = default;
+
+void DepthComplexityDiagnostics::initGL()
+{
+    static const auto shaderPath = std::string{"data/transparency/"};
+    
+    m_countProgram = make_ref<Program>();
+    m_countProgram->attach(
+        Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "transparent_colors.vert"),
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "depth_complexity_count.frag"));
+    
+    m_statisticsProgram = make_ref<Program>();
+    m_statisticsProgram->attach(
+        Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "compositing.vert"),
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "depth_complexity_statistics.frag"));
+    
+    m_heatmapProgram = make_ref<Program>();
+    m_heatmapProgram->attach(
+        Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "compositing.vert"),
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "depth_complexity_heatmap.frag"));
+    
+    m_countProgram->setUniform("depthComplexityImage", 0);
+    m_statisticsProgram->setUniform("depthComplexityImage", 0);
+    m_statisticsProgram->setUniform("statisticsImage", 1);
+    m_heatmapProgram->setUniform("depthComplexityTexture", 0);
+    
+    m_statisticsQuad = make_ref<gloperate::ScreenAlignedQuad>(m_statisticsProgram);
+    m_heatmapQuad = make_ref<gloperate::ScreenAlignedQuad>(m_heatmapProgram);
+    
+    m_depthAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    
+    m_depthComplexityTexture = make_ref<Texture>(GL_TEXTURE_2D);
+    m_depthComplexityTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_depthComplexityTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    m_statisticsTexture = make_ref<Texture>(GL_TEXTURE_1D);
+    m_statisticsTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_statisticsTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    m_statisticsTexture->image1D(0, GL_R32UI, kNumStatistics, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    
+    m_fbo = make_ref<Framebuffer>();
+    m_fbo->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
+    m_fbo->setDrawBuffer(GL_NONE);
+    
+    m_textureClear.initGL();
+    
+    for (auto i = 0u; i < 2u; ++i)
+    {
+        m_statisticsBuffers[i] = make_ref<Buffer>();
+        m_statisticsBuffers[i]->setData(kNumStatistics * sizeof(GLuint), nullptr, GL_STREAM_READ);
+        m_invocationQueries[i] = make_ref<Query>();
+    }
+    
+    // without pipeline statistics, only the fragments of the counting pass are reported
+    m_pipelineStatistics = hasExtension(GLextension::GL_ARB_pipeline_statistics_query);
+}
+
+DepthComplexityDiagnosticsMode DepthComplexityDiagnostics::mode() const
+{
+    return m_mode;
+}
+
+void DepthComplexityDiagnostics::setMode(DepthComplexityDiagnosticsMode mode)
+{
+    m_mode = mode;
+    m_pendingStatistics.fill(false);
+    m_pendingInvocations.fill(false);
+}
+
+uint16_t DepthComplexityDiagnostics::heatmapMaxLayers() const
+{
+    return m_heatmapMaxLayers;
+}
+
+void DepthComplexityDiagnostics::setHeatmapMaxLayers(uint16_t maxLayers)
+{
+    m_heatmapMaxLayers = maxLayers;
+}
+
+uint16_t DepthComplexityDiagnostics::statisticsInterval() const
+{
+    return m_statisticsInterval;
+}
+
+void DepthComplexityDiagnostics::setStatisticsInterval(uint16_t numFrames)
+{
+    m_statisticsInterval = numFrames;
+}
+
+float DepthComplexityDiagnostics::meanDepthComplexity() const
+{
+    return m_meanDepthComplexity;
+}
+
+void DepthComplexityDiagnostics::setMeanDepthComplexity(float mean)
+{
+    m_meanDepthComplexity = mean;
+}
+
+uint32_t DepthComplexityDiagnostics::maxDepthComplexity() const
+{
+    return m_maxDepthComplexity;
+}
+
+void DepthComplexityDiagnostics::setMaxDepthComplexity(uint32_t max)
+{
+    m_maxDepthComplexity = max;
+}
+
+const std::string & DepthComplexityDiagnostics::depthComplexityHistogram() const
+{
+    return m_depthComplexityHistogram;
+}
+
+void DepthComplexityDiagnostics::setDepthComplexityHistogram(const std::string & histogram)
+{
+    m_depthComplexityHistogram = histogram;
+}
+
+uint32_t DepthComplexityDiagnostics::shadedFragments() const
+{
+    return m_shadedFragments;
+}
+
+void DepthComplexityDiagnostics::setShadedFragments(uint32_t numFragments)
+{
+    m_shadedFragments = numFragments;
+}
+
+uint32_t DepthComplexityDiagnostics::shaderInvocations() const
+{
+    return m_shaderInvocations;
+}
+
+void DepthComplexityDiagnostics::setShaderInvocations(uint32_t numInvocations)
+{
+    m_shaderInvocations = numInvocations;
+}
+
+void DepthComplexityDiagnostics::begin()
+{
+    if (m_mode == DepthComplexityDiagnosticsMode::Off || !m_pipelineStatistics)
+        return;
+    
+    m_invocationQueries[m_frame % 2u]->begin(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+    m_invocationQueryActive = true;
+}
+
+void DepthComplexityDiagnostics::end()
+{
+    if (!m_invocationQueryActive)
+        return;
+    
+    m_invocationQueries[m_frame % 2u]->end(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+    m_invocationQueryActive = false;
+    m_pendingInvocations[m_frame % 2u] = true;
+}
+
+void DepthComplexityDiagnostics::render(
+    const glm::mat4 & transform,
+    const std::function<void()> & drawOpaque,
+    const std::function<void()> & drawTransparent)
+{
+    if (m_mode == DepthComplexityDiagnosticsMode::Off)
+        return;
+    
+    const auto count = m_mode == DepthComplexityDiagnosticsMode::Heatmap ||
+        m_frame % std::max(m_statisticsInterval, uint16_t{1u}) == 0u;
+    
+    if (count)
+    {
+        updateTextures();
+        countFragments(transform, drawOpaque, drawTransparent);
+        reduceStatistics();
+    }
+    
+    glViewport(
+        m_viewportCapability->x(),
+        m_viewportCapability->y(),
+        m_viewportCapability->width(),
+        m_viewportCapability->height());
+    
+    if (m_mode == DepthComplexityDiagnosticsMode::Heatmap)
+        drawHeatmap();
+    
+    readStatistics();
+    ++m_frame;
+    
+    Framebuffer::unbind(GL_FRAMEBUFFER);
+}
+
+void DepthComplexityDiagnostics::updateTextures()
+{
+    const auto width = m_viewportCapability->width(), height = m_viewportCapability->height();
+    
+    if (width == m_width && height == m_height)
+        return;
+    
+    m_width = width;
+    m_height = height;
+    
+    m_depthAttachment->image2D(0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
+    m_depthComplexityTexture->image2D(0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void DepthComplexityDiagnostics::countFragments(
+    const glm::mat4 & transform,
+    const std::function<void()> & drawOpaque,
+    const std::function<void()> & drawTransparent)
+{
+    glViewport(0, 0, m_width, m_height);
+    
+    m_textureClear.clear(m_depthComplexityTexture);
+    
+    m_fbo->bind(GL_FRAMEBUFFER);
+    m_fbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+    
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    
+    // only the depth of the opaque geometry is needed to reject hidden transparent fragments
+    drawOpaque();
+    
+    m_fbo->bind(GL_FRAMEBUFFER);
+    glDepthMask(GL_FALSE);
+    
+    glBindImageTexture(0, m_depthComplexityTexture->id(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    
+    m_countProgram->setUniform("transform", transform);
+    m_countProgram->use();
+    
+    drawTransparent();
+    
+    m_countProgram->release();
+    
+    glDepthMask(GL_TRUE);
+    glDisable(GL_DEPTH_TEST);
+    
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void DepthComplexityDiagnostics::reduceStatistics()
+{
+    const auto numTiles = glm::ivec2{
+        (m_width + s_tileSize - 1) / s_tileSize,
+        (m_height + s_tileSize - 1) / s_tileSize };
+    
+    m_textureClear.clear(m_statisticsTexture);
+    
+    // one fragment per tile, the framebuffer only provides the rasterization area
+    m_fbo->bind(GL_FRAMEBUFFER);
+    glViewport(0, 0, numTiles.x, numTiles.y);
+    
+    glBindImageTexture(0, m_depthComplexityTexture->id(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+    glBindImageTexture(1, m_statisticsTexture->id(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    
+    m_statisticsProgram->setUniform("size", glm::ivec2{m_width, m_height});
+    m_statisticsQuad->draw();
+    
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+    
+    const auto index = m_frame % 2u;
+    
+    m_statisticsBuffers[index]->bind(GL_PIXEL_PACK_BUFFER);
+    m_statisticsTexture->bind();
+    glGetTexImage(GL_TEXTURE_1D, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    m_statisticsTexture->unbind();
+    Buffer::unbind(GL_PIXEL_PACK_BUFFER);
+    
+    m_pendingStatistics[index] = true;
+}
+
+void DepthComplexityDiagnostics::drawHeatmap()
+{
+    auto targetfbo = m_targetFramebufferCapability->framebuffer();
+    
+    if (!targetfbo)
+        targetfbo = Framebuffer::defaultFBO();
+    
+    targetfbo->bind(GL_FRAMEBUFFER);
+    
+    m_depthComplexityTexture->bindActive(GL_TEXTURE0);
+    
+    m_heatmapProgram->setUniform("maxLayers", static_cast<GLuint>(m_heatmapMaxLayers));
+    m_heatmapQuad->draw();
+}
+
+void DepthComplexityDiagnostics::readStatistics()
+{
+    const auto index = (m_frame + 1u) % 2u;
+    
+    if (m_pendingStatistics[index])
+    {
+        m_pendingStatistics[index] = false;
+        
+        const auto values = static_cast<const GLuint *>(m_statisticsBuffers[index]->map(GL_READ_ONLY));
+        
+        const auto sum = values[s_numBuckets];
+        const auto max = values[s_numBuckets + 1u];
+        const auto covered = values[s_numBuckets + 2u];
+        
+        std::ostringstream histogram;
+        
+        for (auto i = 0u; i < s_numBuckets; ++i)
+            histogram << (i > 0u ? " " : "") << values[i];
+        
+        m_statisticsBuffers[index]->unmap();
+        
+        // the mean only considers pixels covered by transparent geometry
+        setMeanDepthComplexity(covered > 0u ? static_cast<float>(sum) / covered : 0.0f);
+        setMaxDepthComplexity(max);
+        setDepthComplexityHistogram(histogram.str());
+        setShadedFragments(sum);
+    }
+    
+    if (m_pendingInvocations[index])
+    {
+        m_pendingInvocations[index] = false;
+        setShaderInvocations(static_cast<uint32_t>(m_invocationQueries[index]->get64(GL_QUERY_RESULT)));
+    }
+}
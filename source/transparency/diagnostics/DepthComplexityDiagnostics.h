@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <glm/fwd.hpp>
+
+#include <globjects/base/ref_ptr.h>
+
+#include <reflectionzeug/PropertyGroup.h>
+
+#include "IntegerTextureClear.h"
+
+
+namespace globjects
+{
+    class Buffer;
+    class Framebuffer;
+    class Program;
+    class Query;
+    class Texture;
+}
+
+namespace gloperate
+{
+    class Painter;
+    class AbstractTargetFramebufferCapability;
+    class AbstractViewportCapability;
+    class ScreenAlignedQuad;
+}
+
+enum class DepthComplexityDiagnosticsMode { Off, Statistics, Heatmap };
+
+class DepthComplexityDiagnostics
+{
+public:
+    static const auto s_numBuckets = 16u;
+    static const auto s_tileSize = 8;
+
+public:
+    DepthComplexityDiagnostics(
+        gloperate::Painter & painter,
+        gloperate::AbstractViewportCapability * viewportCapability,
+        gloperate::AbstractTargetFramebufferCapability * targetFramebufferCapability);
+    ~DepthComplexityDiagnostics();
+    
+    void initGL();
+    
+    DepthComplexityDiagnosticsMode mode() const;
+    void setMode(DepthComplexityDiagnosticsMode mode);
+    
+    uint16_t heatmapMaxLayers() const;
+    void setHeatmapMaxLayers(uint16_t maxLayers);
+    
+    uint16_t statisticsInterval() const;
+    void setStatisticsInterval(uint16_t numFrames);
+    
+    float meanDepthComplexity() const;
+    void setMeanDepthComplexity(float mean);
+    
+    uint32_t maxDepthComplexity() const;
+    void setMaxDepthComplexity(uint32_t max);
+    
+    const std::string & depthComplexityHistogram() const;
+    void setDepthComplexityHistogram(const std::string & histogram);
+    
+    uint32_t shadedFragments() const;
+    void setShadedFragments(uint32_t numFragments);
+    
+    uint32_t shaderInvocations() const;
+    void setShaderInvocations(uint32_t numInvocations);
+    
+    /** Counts the fragment shader invocations of everything the painter renders until end() */
+    void begin();
+    void end();
+    
+    /**
+     * Counts the fragments of drawTransparent per pixel after drawOpaque filled the depth buffer. This is an
+     * additional geometry pass, in statistics mode it only runs every statisticsInterval() frames.
+     */
+    void render(
+        const glm::mat4 & transform,
+        const std::function<void()> & drawOpaque,
+        const std::function<void()> & drawTransparent);
+
+protected:
+    void updateTextures();
+    void countFragments(
+        const glm::mat4 & transform,
+        const std::function<void()> & drawOpaque,
+        const std::function<void()> & drawTransparent);
+    void reduceStatistics();
+    void drawHeatmap();
+    void readStatistics();
+
+private:
+    gloperate::AbstractViewportCapability * m_viewportCapability;
+    gloperate::AbstractTargetFramebufferCapability * m_targetFramebufferCapability;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_fbo;
+    globjects::ref_ptr<globjects::Texture> m_depthAttachment;
+    globjects::ref_ptr<globjects::Texture> m_depthComplexityTexture;
+    globjects::ref_ptr<globjects::Texture> m_statisticsTexture;
+    IntegerTextureClear m_textureClear;
+    int m_width;
+    int m_height;
+    
+    globjects::ref_ptr<globjects::Program> m_countProgram;
+    globjects::ref_ptr<globjects::Program> m_statisticsProgram;
+    globjects::ref_ptr<globjects::Program> m_heatmapProgram;
+    globjects::ref_ptr<gloperate::ScreenAlignedQuad> m_statisticsQuad;
+    globjects::ref_ptr<gloperate::ScreenAlignedQuad> m_heatmapQuad;
+    
+    // results are read one frame late, so the readback does not stall the pipeline
+    std::array<globjects::ref_ptr<globjects::Buffer>, 2> m_statisticsBuffers;
+    std::array<globjects::ref_ptr<globjects::Query>, 2> m_invocationQueries;
+    std::array<bool, 2> m_pendingStatistics;
+    std::array<bool, 2> m_pendingInvocations;
+    bool m_invocationQueryActive;
+    unsigned int m_frame;
+    bool m_pipelineStatistics;
+    
+    DepthComplexityDiagnosticsMode m_mode;
+    uint16_t m_heatmapMaxLayers;
+    uint16_t m_statisticsInterval;
+    float m_meanDepthComplexity;
+    uint32_t m_maxDepthComplexity;
+    std::string m_depthComplexityHistogram;
+    uint32_t m_shadedFragments;
+    uint32_t m_shaderInvocations;
+};
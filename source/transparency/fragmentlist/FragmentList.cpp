@@ -0,0 +1,498 @@
+#include "FragmentList.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <glbinding/gl/boolean.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/bitfield.h>
+
+#include <globjects/globjects.h>
+#include <globjects/logging.h>
+#include <globjects/Buffer.h>
+#include <globjects/Framebuffer.h>
+#include <globjects/DebugMessage.h>
+#include <globjects/Program.h>
+#include <globjects/Shader.h>
+#include <globjects/Texture.h>
+
+#include <gloperate/base/RenderTargetType.h>
+#include <gloperate/base/make_unique.hpp>
+#include <gloperate/resources/ResourceManager.h>
+#include <gloperate/painter/TargetFramebufferCapability.h>
+#include <gloperate/painter/ViewportCapability.h>
+#include <gloperate/painter/PerspectiveProjectionCapability.h>
+#include <gloperate/painter/CameraCapability.h>
+#include <gloperate/primitives/AdaptiveGrid.h>
+#include <gloperate/primitives/ScreenAlignedQuad.h>
+#include <gloperate/primitives/PolygonalGeometry.h>
+
+#include <reflectionzeug/PropertyGroup.h>
+
+#include "CacheDirectory.h"
+#include "diagnostics/DepthComplexityDiagnostics.h"
+#include "scene/LodSelector.h"
+#include "scene/MeshCache.h"
+#include "scene/MeshDrawable.h"
+
+
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+namespace
+{
+
+const auto kEndOfList = 0xffffffffu;
+
+}
+
+FragmentList::FragmentList(gloperate::ResourceManager & resourceManager)
+:   Painter(resourceManager)
+,   m_targetFramebufferCapability(addCapability(new gloperate::TargetFramebufferCapability()))
+,   m_viewportCapability(addCapability(new gloperate::ViewportCapability()))
+,   m_projectionCapability(addCapability(new gloperate::PerspectiveProjectionCapability(m_viewportCapability)))
+,   m_cameraCapability(addCapability(new gloperate::CameraCapability()))
+,   m_nodeCapacity(0u)
+,   m_pendingCounters{{ false, false }}
+,   m_frame(0u)
+,   m_transparency(160u)
+,   m_backFaceCulling(false)
+,   m_kBuffer(false)
+,   m_k(8u)
+,   m_nodeBufferSize(64u)
+,   m_nodeBufferSizeChanged(true)
+,   m_fragmentCount(0u)
+,   m_peakFragmentCount(0u)
+,   m_nodeBufferOverflow(false)
+,   m_peakMemory(0.0f)
+,   m_truncatedPixels(0u)
+,   m_lodSelector(new LodSelector(*this, m_viewportCapability, m_projectionCapability, m_cameraCapability))
+,   m_diagnostics(new DepthComplexityDiagnostics(*this, m_viewportCapability, m_targetFramebufferCapability))
+{
+    setupPropertyGroup();
+}
+
+FragmentList::~FragmentList() = default;
+
+void FragmentList::setupPropertyGroup()
+{
+    addProperty<unsigned char>("transparency", this,
+        &FragmentList::transparency, &FragmentList::setTransparency)->setOptions({
+        { "minimum", 0 },
+        { "maximum", 255 },
+        { "step", 1 }});
+    
+    addProperty<bool>("back_face_culling", this,
+        &FragmentList::backFaceCulling, &FragmentList::setBackFaceCulling);
+    
+    addProperty<bool>("k_buffer", this,
+        &FragmentList::kBuffer, &FragmentList::setKBuffer);
+    
+    addProperty<uint16_t>("k", this,
+        &FragmentList::k, &FragmentList::setK)->setOptions({
+        { "minimum", 1u },
+        { "maximum", static_cast<unsigned int>(kMaxK) }});
+    
+    addProperty<uint16_t>("node_buffer_mib", this,
+        &FragmentList::nodeBufferSize, &FragmentList::setNodeBufferSize)->setOptions({
+        { "minimum", 1u },
+        { "maximum", 4096u }});
+    
+    addProperty<const unsigned int>("fragment_count", this,
+        &FragmentList::fragmentCount);
+    
+    addProperty<const bool>("node_buffer_overflow", this,
+        &FragmentList::nodeBufferOverflow);
+    
+    addProperty<const float>("peak_memory_mib", this,
+        &FragmentList::peakMemory)->setOptions({
+        { "precision", 1u }});
+    
+    // pixels with more fragments than the resolve pass sorts, their farthest fragments are blended unordered
+    addProperty<const unsigned int>("truncated_pixels", this,
+        &FragmentList::truncatedPixels);
+}
+
+unsigned char FragmentList::transparency() const
+{
+    return m_transparency;
+}
+
+void FragmentList::setTransparency(unsigned char transparency)
+{
+    m_transparency = transparency;
+}
+
+bool FragmentList::backFaceCulling() const
+{
+    return m_backFaceCulling;
+}
+
+void FragmentList::setBackFaceCulling(bool b)
+{
+    m_backFaceCulling = b;
+}
+
+bool FragmentList::kBuffer() const
+{
+    return m_kBuffer;
+}
+
+void FragmentList::setKBuffer(bool b)
+{
+    m_kBuffer = b;
+}
+
+uint16_t FragmentList::k() const
+{
+    return m_k;
+}
+
+void FragmentList::setK(uint16_t k)
+{
+    m_k = k;
+}
+
+uint16_t FragmentList::nodeBufferSize() const
+{
+    return m_nodeBufferSize;
+}
+
+void FragmentList::setNodeBufferSize(uint16_t mebibytes)
+{
+    m_nodeBufferSize = mebibytes;
+    m_nodeBufferSizeChanged = true;
+    m_peakFragmentCount = 0u;
+}
+
+unsigned int FragmentList::fragmentCount() const
+{
+    return m_fragmentCount;
+}
+
+void FragmentList::setFragmentCount(unsigned int count)
+{
+    m_fragmentCount = count;
+}
+
+bool FragmentList::nodeBufferOverflow() const
+{
+    return m_nodeBufferOverflow;
+}
+
+void FragmentList::setNodeBufferOverflow(bool b)
+{
+    m_nodeBufferOverflow = b;
+}
+
+float FragmentList::peakMemory() const
+{
+    return m_peakMemory;
+}
+
+void FragmentList::setPeakMemory(float mebibytes)
+{
+    m_peakMemory = mebibytes;
+}
+
+unsigned int FragmentList::truncatedPixels() const
+{
+    return m_truncatedPixels;
+}
+
+void FragmentList::setTruncatedPixels(unsigned int numPixels)
+{
+    m_truncatedPixels = numPixels;
+}
+
+void FragmentList::onInitialize()
+{
+    globjects::init();
+    globjects::DebugMessage::enable();
+
+#ifdef __APPLE__
+    Shader::clearGlobalReplacements();
+    Shader::globalReplace("#version 140", "#version 150");
+
+    debug() << "Using global OS X shader replacement '#version 140' -> '#version 150'" << std::endl;
+#endif
+
+    m_grid = make_ref<gloperate::AdaptiveGrid>();
+    m_grid->setColor({0.6f, 0.6f, 0.6f});
+    
+    m_textureClear.initGL();
+    
+    m_nodeBuffer = make_ref<Buffer>();
+    m_nodeCounterBuffer = make_ref<Buffer>();
+    m_nodeCounterBuffer->setData(kNumCounters * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    
+    for (auto & buffer : m_counterReadbackBuffers)
+    {
+        buffer = make_ref<Buffer>();
+        buffer->setData(kNumCounters * sizeof(GLuint), nullptr, GL_STREAM_READ);
+    }
+    
+    setupPrograms();
+    setupProjection();
+    setupFramebuffer();
+    setupDrawable();
+    
+    m_diagnostics->initGL();
+}
+
+void FragmentList::onPaint()
+{
+    if (m_viewportCapability->hasChanged())
+    {
+        glViewport(
+            m_viewportCapability->x(),
+            m_viewportCapability->y(),
+            m_viewportCapability->width(),
+            m_viewportCapability->height());
+
+        m_viewportCapability->setChanged(false);
+        
+        updateFramebuffer();
+        m_peakFragmentCount = 0u;
+    }
+    
+    if (m_nodeBufferSizeChanged)
+    {
+        m_nodeBufferSizeChanged = false;
+        updateNodeBuffer();
+    }
+    
+    const auto transform = m_projectionCapability->projection() * m_cameraCapability->view();
+    
+    m_grid->update(m_cameraCapability->eye(), transform);
+    
+    m_buildProgram->setUniform("transform", transform);
+    m_buildProgram->setUniform("transparency", static_cast<unsigned int>(m_transparency));
+    m_resolveProgram->setUniform("kBuffer", m_kBuffer);
+    m_resolveProgram->setUniform("k", static_cast<int>(m_k));
+    
+    m_lodSelector->setNumTriangles(m_lodSelector->select(m_drawables));
+    
+    m_diagnostics->begin();
+    
+    clearBuffers();
+    renderOpaqueGeometry();
+    buildFragmentLists();
+    resolve();
+    updateStatistics();
+    
+    m_diagnostics->end();
+    m_diagnostics->render(transform, [this] () { m_grid->draw(); }, [this] () { for (auto & drawable : m_drawables) drawable->draw(); });
+    
+    Framebuffer::unbind(GL_FRAMEBUFFER);
+}
+
+void FragmentList::setupFramebuffer()
+{
+    m_colorAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    m_depthAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    
+    m_headPointerTexture = make_ref<Texture>(GL_TEXTURE_2D);
+    m_headPointerTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_headPointerTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    m_fbo = make_ref<Framebuffer>();
+    
+    m_fbo->attachTexture(GL_COLOR_ATTACHMENT0, m_colorAttachment);
+    m_fbo->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
+    
+    updateFramebuffer();
+    
+    m_fbo->printStatus(true);
+}
+
+void FragmentList::setupProjection()
+{
+    static const auto zNear = 0.3f, zFar = 30.f, fovy = 50.f;
+
+    m_projectionCapability->setZNear(zNear);
+    m_projectionCapability->setZFar(zFar);
+    m_projectionCapability->setFovy(radians(fovy));
+
+    m_grid->setNearFar(zNear, zFar);
+}
+
+void FragmentList::setupPrograms()
+{
+    static const auto shaderPath = std::string{"data/transparency/"};
+    
+    m_buildProgram = make_ref<Program>();
+    m_buildProgram->attach(
+        Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "transparent_colors.vert"),
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "fragment_list_build.frag"));
+    
+    m_resolveProgram = make_ref<Program>();
+    m_resolveProgram->attach(
+        Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "compositing.vert"),
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "fragment_list_resolve.frag"));
+    
+    m_buildProgram->setUniform("headPointerImage", 0);
+    m_resolveProgram->setUniform("headPointerImage", 0);
+    m_resolveProgram->setUniform("opaqueColorTexture", 0);
+    
+    m_resolveQuad = make_ref<gloperate::ScreenAlignedQuad>(m_resolveProgram);
+}
+
+void FragmentList::setupDrawable()
+{
+    // Load scene, the cache imports the file only once and maps the stored arrays afterwards
+    const auto scene = MeshCache{CacheDirectory::path()}.load("data/transparency/transparency_scene.obj", m_resourceManager);
+    if (!scene)
+    {
+        std::cout << "Could not load file" << std::endl;
+        return;
+    }
+
+    // Create a renderable for each mesh
+    for (const auto & mesh : scene->meshes()) {
+        m_drawables.push_back(gloperate::make_unique<MeshDrawable>(mesh));
+    }
+}
+
+void FragmentList::updateFramebuffer()
+{
+    const auto width = m_viewportCapability->width(), height = m_viewportCapability->height();
+    
+    m_colorAttachment->image2D(0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    m_depthAttachment->image2D(0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
+    m_headPointerTexture->image2D(0, GL_R32UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void FragmentList::updateNodeBuffer()
+{
+    // computed in 64 bit, 4 GiB do not fit into an unsigned int
+    m_nodeCapacity = static_cast<unsigned int>(static_cast<uint64_t>(m_nodeBufferSize) * 1024u * 1024u / kNodeSize);
+    
+    m_nodeBuffer->setData(static_cast<GLsizeiptr>(m_nodeCapacity) * kNodeSize, nullptr, GL_DYNAMIC_COPY);
+    
+    m_buildProgram->setUniform("nodeCapacity", m_nodeCapacity);
+    m_resolveProgram->setUniform("nodeCapacity", m_nodeCapacity);
+}
+
+void FragmentList::clearBuffers()
+{
+    m_textureClear.clear(m_headPointerTexture, kEndOfList);
+    
+    m_fbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+    
+    m_fbo->clearBuffer(GL_COLOR, 0, glm::vec4(0.85f, 0.87f, 0.91f, 1.0f));
+    m_fbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+    
+    const auto zero = std::array<GLuint, kNumCounters>{};
+    m_nodeCounterBuffer->setSubData(0, sizeof(zero), zero.data());
+}
+
+void FragmentList::renderOpaqueGeometry()
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+
+    m_fbo->bind(GL_FRAMEBUFFER);
+    m_fbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    m_grid->draw();
+}
+
+void FragmentList::buildFragmentLists()
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    
+    if (m_backFaceCulling)
+        glEnable(GL_CULL_FACE);
+    
+    m_fbo->bind(GL_FRAMEBUFFER);
+    m_fbo->setDrawBuffer(GL_NONE);
+    
+    glBindImageTexture(0, m_headPointerTexture->id(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    m_nodeBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+    m_nodeCounterBuffer->bindBase(GL_ATOMIC_COUNTER_BUFFER, 0);
+    
+    m_buildProgram->use();
+    
+    for (auto & drawable : m_drawables)
+        drawable->draw();
+    
+    m_buildProgram->release();
+    
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+}
+
+void FragmentList::resolve()
+{
+    auto targetfbo = m_targetFramebufferCapability->framebuffer();
+    auto drawBuffer = GL_COLOR_ATTACHMENT0;
+    
+    if (!targetfbo)
+    {
+        targetfbo = Framebuffer::defaultFBO();
+        drawBuffer = GL_BACK_LEFT;
+    }
+    
+    glDisable(GL_DEPTH_TEST);
+    
+    targetfbo->bind(GL_FRAMEBUFFER);
+    
+    m_colorAttachment->bindActive(GL_TEXTURE0);
+    
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    
+    m_nodeCounterBuffer->bindBase(GL_ATOMIC_COUNTER_BUFFER, 0);
+    
+    m_resolveQuad->draw();
+    
+    const auto rect = std::array<GLint, 4>{{
+        m_viewportCapability->x(),
+        m_viewportCapability->y(),
+        m_viewportCapability->width(),
+        m_viewportCapability->height()
+    }};
+    
+    m_fbo->blit(GL_COLOR_ATTACHMENT0, rect, targetfbo, drawBuffer, rect, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+void FragmentList::updateStatistics()
+{
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    
+    m_nodeCounterBuffer->copySubData(m_counterReadbackBuffers[m_frame % 2u].get(), 0, 0, kNumCounters * sizeof(GLuint));
+    m_pendingCounters[m_frame % 2u] = true;
+    
+    ++m_frame;
+    
+    const auto index = m_frame % 2u;
+    
+    if (!m_pendingCounters[index])
+        return;
+    
+    m_pendingCounters[index] = false;
+    
+    const auto counters = static_cast<const GLuint *>(m_counterReadbackBuffers[index]->map(GL_READ_ONLY));
+    
+    // the node counter keeps counting past the capacity, so it tells how large the node buffer would have to be
+    const auto count = counters[0];
+    const auto truncated = counters[1];
+    
+    m_counterReadbackBuffers[index]->unmap();
+    
+    m_peakFragmentCount = std::max(m_peakFragmentCount, count);
+    
+    const auto headPointerBytes = static_cast<float>(m_viewportCapability->width()) * m_viewportCapability->height() * 4u;
+    const auto peakNodeBytes = static_cast<float>(m_peakFragmentCount) * kNodeSize;
+    
+    setFragmentCount(count);
+    setNodeBufferOverflow(count > m_nodeCapacity);
+    setPeakMemory((headPointerBytes + peakNodeBytes) / (1024.0f * 1024.0f));
+    setTruncatedPixels(truncated);
+}
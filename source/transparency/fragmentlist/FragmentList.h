@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glbinding/gl/types.h>
+#include <glbinding/gl/enum.h>
+
+#include <globjects/base/ref_ptr.h>
+
+#include <gloperate/painter/Painter.h>
+
+#include "IntegerTextureClear.h"
+
+
+namespace globjects
+{
+    class Buffer;
+    class Framebuffer;
+    class Program;
+    class Texture;
+}
+
+namespace gloperate
+{
+    class AdaptiveGrid;
+    class ResourceManager;
+    class AbstractTargetFramebufferCapability;
+    class AbstractViewportCapability;
+    class AbstractPerspectiveProjectionCapability;
+    class AbstractCameraCapability;
+    class ScreenAlignedQuad;
+}
+
+class DepthComplexityDiagnostics;
+class LodSelector;
+class MeshDrawable;
+
+class FragmentList : public gloperate::Painter
+{
+public:
+    FragmentList(gloperate::ResourceManager & resourceManager);
+    virtual ~FragmentList() override;
+    
+public:
+    void setupPropertyGroup();
+    
+    unsigned char transparency() const;
+    void setTransparency(unsigned char transparency);
+    
+    bool backFaceCulling() const;
+    void setBackFaceCulling(bool b);
+    
+    bool kBuffer() const;
+    void setKBuffer(bool b);
+    
+    uint16_t k() const;
+    void setK(uint16_t k);
+    
+    uint16_t nodeBufferSize() const;
+    void setNodeBufferSize(uint16_t mebibytes);
+    
+    unsigned int fragmentCount() const;
+    void setFragmentCount(unsigned int count);
+    
+    bool nodeBufferOverflow() const;
+    void setNodeBufferOverflow(bool b);
+    
+    float peakMemory() const;
+    void setPeakMemory(float mebibytes);
+    
+    unsigned int truncatedPixels() const;
+    void setTruncatedPixels(unsigned int numPixels);
+    
+protected:
+    virtual void onInitialize() override;
+    virtual void onPaint() override;
+
+protected:
+    void setupFramebuffer();
+    void setupProjection();
+    void setupPrograms();
+    void setupDrawable();
+    void updateFramebuffer();
+    void updateNodeBuffer();
+    
+protected:
+    void clearBuffers();
+    void renderOpaqueGeometry();
+    void buildFragmentLists();
+    void resolve();
+    void updateStatistics();
+
+private:
+    /** \name Capabilities */
+    /** \{ */
+    
+    gloperate::AbstractTargetFramebufferCapability * m_targetFramebufferCapability;
+    gloperate::AbstractViewportCapability * m_viewportCapability;
+    gloperate::AbstractPerspectiveProjectionCapability * m_projectionCapability;
+    gloperate::AbstractCameraCapability * m_cameraCapability;
+    
+    /** \} */
+
+    /** \name Framebuffers, Textures and Buffers */
+    /** \{ */
+    
+    static const auto kNodeSize = 32u;
+    static const auto kMaxK = 64u;
+    static const auto kNumCounters = 2u;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_fbo;
+    globjects::ref_ptr<globjects::Texture> m_colorAttachment;
+    globjects::ref_ptr<globjects::Texture> m_depthAttachment;
+    
+    globjects::ref_ptr<globjects::Texture> m_headPointerTexture;
+    IntegerTextureClear m_textureClear;
+    globjects::ref_ptr<globjects::Buffer> m_nodeBuffer;
+    globjects::ref_ptr<globjects::Buffer> m_nodeCounterBuffer;
+    unsigned int m_nodeCapacity;
+    
+    // counters are read one frame late, so the readback does not stall the pipeline
+    std::array<globjects::ref_ptr<globjects::Buffer>, 2> m_counterReadbackBuffers;
+    std::array<bool, 2> m_pendingCounters;
+    unsigned int m_frame;
+    
+    /** \} */
+    
+    /** \name Programs */
+    /** \{ */
+    
+    globjects::ref_ptr<globjects::Program> m_buildProgram;
+    globjects::ref_ptr<globjects::Program> m_resolveProgram;
+    
+    /** \} */
+    
+    /** \name Geometry */
+    /** \{ */
+    
+    globjects::ref_ptr<gloperate::AdaptiveGrid> m_grid;
+    std::vector<std::unique_ptr<MeshDrawable>> m_drawables;
+    globjects::ref_ptr<gloperate::ScreenAlignedQuad> m_resolveQuad;
+    
+    /** \} */
+
+    /** \name Properties */
+    /** \{ */
+    
+    unsigned char m_transparency;
+    bool m_backFaceCulling;
+    bool m_kBuffer;
+    uint16_t m_k;
+    uint16_t m_nodeBufferSize;
+    bool m_nodeBufferSizeChanged;
+    unsigned int m_fragmentCount;
+    unsigned int m_peakFragmentCount;
+    bool m_nodeBufferOverflow;
+    float m_peakMemory;
+    unsigned int m_truncatedPixels;
+    std::unique_ptr<LodSelector> m_lodSelector;
+    std::unique_ptr<DepthComplexityDiagnostics> m_diagnostics;
+    
+    /** \} */
+};
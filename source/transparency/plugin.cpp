@@ -2,6 +2,10 @@
 
 #include "screendoor/ScreenDoor.h"
 #include "stochastic/StochasticTransparency.h"
+#include "weightedblended/WeightedBlended.h"
+#include "fragmentlist/FragmentList.h"
+#include "depthpeeling/DualDepthPeeling.h"
+#include "sorted/SortedTransparency.h"
 
 #include <glexamples-version.h>
 
@@ -19,4 +23,28 @@ GLOPERATE_PLUGIN_LIBRARY
     , GLEXAMPLES_AUTHOR_ORGANIZATION
     , "v1.0.0" )
 
+    GLOPERATE_PLUGIN(WeightedBlended
+    , "WeightedBlended"
+    , "Weighted Blended Order-Independent Transparency"
+    , GLEXAMPLES_AUTHOR_ORGANIZATION
+    , "v1.0.0" )
+
+    GLOPERATE_PLUGIN(FragmentList
+    , "FragmentList"
+    , "Fragment List Transparency"
+    , GLEXAMPLES_AUTHOR_ORGANIZATION
+    , "v1.0.0" )
+
+    GLOPERATE_PLUGIN(DualDepthPeeling
+    , "DualDepthPeeling"
+    , "Dual Depth Peeling"
+    , GLEXAMPLES_AUTHOR_ORGANIZATION
+    , "v1.0.0" )
+
+    GLOPERATE_PLUGIN(SortedTransparency
+    , "SortedTransparency"
+    , "CPU-Sorted Transparency"
+    , GLEXAMPLES_AUTHOR_ORGANIZATION
+    , "v1.0.0" )
+
 GLOPERATE_PLUGIN_LIBRARY_END
@@ -0,0 +1,91 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include <gloperate/painter/Painter.h>
+#include <gloperate/painter/AbstractViewportCapability.h>
+#include <gloperate/painter/AbstractPerspectiveProjectionCapability.h>
+#include <gloperate/painter/AbstractCameraCapability.h>
+
+#include "MeshDrawable.h"
+
+
+LodSelector::LodSelector(
+    gloperate::Painter & painter,
+    gloperate::AbstractViewportCapability * viewportCapability,
+    gloperate::AbstractPerspectiveProjectionCapability * projectionCapability,
+    gloperate::AbstractCameraCapability * cameraCapability)
+:   m_viewportCapability(viewportCapability)
+,   m_projectionCapability(projectionCapability)
+,   m_cameraCapability(cameraCapability)
+,   m_errorThreshold(1.0f)
+,   m_numTriangles(0u)
+,   m_selectionChanged(false)
+{
+    painter.addProperty<float>("lod_error_threshold", this,
+        &LodSelector::errorThreshold,
+        &LodSelector::setErrorThreshold)->setOptions({
+        { "minimum", 0.0f },
+        { "maximum", 32.0f },
+        { "step", 0.5f },
+        { "precision", 1u }});
+    
+    painter.addProperty<const uint32_t>("lod_triangles", this,
+        &LodSelector::numTriangles);
+}
+
+LodSelector::~LodSelector() = default;
+
+float LodSelector::errorThreshold() const
+{
+    return m_errorThreshold;
+}
+
+void LodSelector::setErrorThreshold(float pixels)
+{
+    m_errorThreshold = pixels;
+}
+
+uint32_t LodSelector::numTriangles() const
+{
+    return m_numTriangles;
+}
+
+void LodSelector::setNumTriangles(uint32_t numTriangles)
+{
+    m_numTriangles = numTriangles;
+}
+
+uint32_t LodSelector::select(const std::vector<std::unique_ptr<MeshDrawable>> & drawables)
+{
+    const auto eye = m_cameraCapability->eye();
+    const auto zNear = m_projectionCapability->zNear();
+    const auto height = static_cast<float>(std::max(m_viewportCapability->height(), 1));
+    
+    // model units covered by one pixel at unit distance
+    const auto unitsPerPixel = 2.0f * std::tan(m_projectionCapability->fovy() * 0.5f) / height;
+    
+    auto numTriangles = 0u;
+    
+    for (const auto & drawable : drawables)
+    {
+        // the closest point of the bounding sphere bounds the projected error of the whole mesh
+        const auto distance = std::max(glm::length(eye - drawable->center()) - drawable->radius(), zNear);
+        const auto previousLod = drawable->lod();
+        
+        numTriangles += drawable->selectLod(m_errorThreshold * unitsPerPixel * distance);
+        m_selectionChanged = m_selectionChanged || drawable->lod() != previousLod;
+    }
+    
+    return numTriangles;
+}
+
+bool LodSelector::selectionChanged() const
+{
+    const auto changed = m_selectionChanged;
+    m_selectionChanged = false;
+    return changed;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <reflectionzeug/PropertyGroup.h>
+
+
+namespace gloperate
+{
+    class Painter;
+    class AbstractViewportCapability;
+    class AbstractPerspectiveProjectionCapability;
+    class AbstractCameraCapability;
+}
+
+class MeshDrawable;
+
+class LodSelector
+{
+public:
+    LodSelector(
+        gloperate::Painter & painter,
+        gloperate::AbstractViewportCapability * viewportCapability,
+        gloperate::AbstractPerspectiveProjectionCapability * projectionCapability,
+        gloperate::AbstractCameraCapability * cameraCapability);
+    ~LodSelector();
+    
+    float errorThreshold() const;
+    void setErrorThreshold(float pixels);
+    
+    uint32_t numTriangles() const;
+    void setNumTriangles(uint32_t numTriangles);
+    
+    /** Selects the coarsest level of detail of each drawable whose error projects to at most errorThreshold pixels */
+    uint32_t select(const std::vector<std::unique_ptr<MeshDrawable>> & drawables);
+    
+    bool selectionChanged() const;
+
+private:
+    gloperate::AbstractViewportCapability * m_viewportCapability;
+    gloperate::AbstractPerspectiveProjectionCapability * m_projectionCapability;
+    gloperate::AbstractCameraCapability * m_cameraCapability;
+    
+    float m_errorThreshold;
+    uint32_t m_numTriangles;
+    mutable bool m_selectionChanged;
+};
@@ -0,0 +1,496 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <glbinding/gl/enum.h>
+
+#include <globjects/logging.h>
+
+#include <gloperate/resources/ResourceManager.h>
+#include <gloperate/primitives/Scene.h>
+#include <gloperate/primitives/PolygonalGeometry.h>
+
+#include "CacheDirectory.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexFormat.h"
+
+
+namespace
+{
+
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t pathHash;
+    int64_t sourceTime;
+    uint64_t sourceSize;
+    uint32_t numMeshes;
+    uint32_t loaderVersion;
+};
+
+struct MeshCacheEntry
+{
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint32_t numLodIndices;
+    uint32_t numLods;
+    uint64_t verticesOffset;
+    uint64_t normalsOffset;
+    uint64_t indicesOffset;
+    uint64_t lodsOffset;
+    uint64_t packedVerticesOffset;
+    uint64_t packedIndicesOffset;
+    uint32_t packedIndexSize;
+    glm::vec3 scale;
+    glm::vec3 offset;
+    glm::vec3 center;
+    float radius;
+    uint32_t padding;
+};
+
+const char kMagic[4] = { 'M', 'S', 'H', 'C' };
+
+// arrays start at multiples of this, so they can be handed to the driver without realignment
+const auto kAlignment = std::size_t{16u};
+
+uint64_t hashPath(const std::string & path)
+{
+    // FNV-1a
+    auto hash = uint64_t{14695981039346656037ull};
+
+    for (const auto c : path)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool makeHeader(const std::string & path, MeshCacheHeader & header)
+{
+    struct stat status;
+
+    if (stat(path.c_str(), &status) != 0)
+        return false;
+
+    header = MeshCacheHeader{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = MeshCache::s_version;
+    header.loaderVersion = MeshCache::s_loaderVersion;
+    header.pathHash = hashPath(path);
+    header.sourceTime = static_cast<int64_t>(status.st_mtime);
+    header.sourceSize = static_cast<uint64_t>(status.st_size);
+    return true;
+}
+
+bool matches(const MeshCacheHeader & lhs, const MeshCacheHeader & rhs)
+{
+    return std::memcmp(lhs.magic, rhs.magic, sizeof(kMagic)) == 0
+        && lhs.version == rhs.version
+        && lhs.loaderVersion == rhs.loaderVersion
+        && lhs.pathHash == rhs.pathHash
+        && lhs.sourceTime == rhs.sourceTime
+        && lhs.sourceSize == rhs.sourceSize;
+}
+
+std::size_t align(std::size_t offset)
+{
+    return (offset + kAlignment - 1u) / kAlignment * kAlignment;
+}
+
+// runs function(i) for every index in order on the calling thread and as many workers as there are cores
+void parallelFor(const std::vector<std::size_t> & order, const std::function<void(std::size_t)> & function)
+{
+    std::atomic<std::size_t> next{0u};
+
+    const auto work = [&]()
+    {
+        for (auto i = next++; i < order.size(); i = next++)
+            function(order[i]);
+    };
+
+    const auto numThreads = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), order.size());
+
+    auto workers = std::vector<std::thread>{};
+
+    for (auto i = std::size_t{1u}; i < numThreads; ++i)
+        workers.emplace_back(work);
+
+    work();
+
+    for (auto & worker : workers)
+        worker.join();
+}
+
+template <typename T>
+void append(std::vector<char> & bytes, std::size_t offset, const T * data, std::size_t count)
+{
+    if (count > 0u)
+        std::memcpy(bytes.data() + offset, data, count * sizeof(T));
+}
+
+}
+
+CachedScene::CachedScene()
+:   m_mapping(nullptr)
+,   m_mappingSize(0u)
+{
+}
+
+CachedScene::~CachedScene()
+{
+#ifndef _WIN32
+    if (m_mapping)
+        munmap(m_mapping, m_mappingSize);
+#endif
+}
+
+std::unique_ptr<CachedScene> CachedScene::fromBytes(std::vector<char> && bytes)
+{
+    auto scene = std::unique_ptr<CachedScene>{new CachedScene()};
+    scene->m_bytes = std::move(bytes);
+
+    if (!scene->parse(scene->m_bytes.data(), scene->m_bytes.size()))
+        return nullptr;
+
+    return scene;
+}
+
+std::unique_ptr<CachedScene> CachedScene::fromMapping(void * mapping, std::size_t size)
+{
+    auto scene = std::unique_ptr<CachedScene>{new CachedScene()};
+    scene->m_mapping = mapping;
+    scene->m_mappingSize = size;
+
+    if (!scene->parse(static_cast<const char *>(mapping), size))
+        return nullptr;
+
+    return scene;
+}
+
+const std::vector<MeshData> & CachedScene::meshes() const
+{
+    return m_meshes;
+}
+
+bool CachedScene::parse(const char * bytes, std::size_t size)
+{
+    if (size < sizeof(MeshCacheHeader))
+        return false;
+
+    const auto & header = *reinterpret_cast<const MeshCacheHeader *>(bytes);
+    const auto tableEnd = sizeof(MeshCacheHeader) + header.numMeshes * sizeof(MeshCacheEntry);
+
+    if (tableEnd > size)
+        return false;
+
+    const auto entries = reinterpret_cast<const MeshCacheEntry *>(bytes + sizeof(MeshCacheHeader));
+
+    const auto inBounds = [size] (uint64_t offset, uint64_t count, std::size_t elementSize)
+    {
+        return offset <= size && count * elementSize <= size - offset;
+    };
+
+    for (auto i = 0u; i < header.numMeshes; ++i)
+    {
+        const auto & entry = entries[i];
+
+        const auto numAllIndices = static_cast<uint64_t>(entry.numIndices) + entry.numLodIndices;
+        const auto packedVertexSize = static_cast<std::size_t>(VertexFormatEncoder::stride(VertexFormat::Quantized));
+
+        if (entry.packedIndexSize != sizeof(uint16_t) && entry.packedIndexSize != sizeof(uint32_t))
+            return false;
+
+        if (!inBounds(entry.verticesOffset, entry.numVertices, sizeof(glm::vec3)) ||
+            !inBounds(entry.normalsOffset, entry.numVertices, sizeof(glm::vec3)) ||
+            !inBounds(entry.indicesOffset, numAllIndices, sizeof(unsigned int)) ||
+            !inBounds(entry.lodsOffset, entry.numLods, sizeof(MeshLod)) ||
+            !inBounds(entry.packedVerticesOffset, entry.numVertices, packedVertexSize) ||
+            !inBounds(entry.packedIndicesOffset, numAllIndices, entry.packedIndexSize))
+            return false;
+
+        auto mesh = MeshData{};
+        mesh.vertices = reinterpret_cast<const glm::vec3 *>(bytes + entry.verticesOffset);
+        mesh.normals = reinterpret_cast<const glm::vec3 *>(bytes + entry.normalsOffset);
+        mesh.indices = reinterpret_cast<const unsigned int *>(bytes + entry.indicesOffset);
+        mesh.numVertices = entry.numVertices;
+        mesh.numIndices = entry.numIndices;
+        mesh.lods = reinterpret_cast<const MeshLod *>(bytes + entry.lodsOffset);
+        mesh.numLods = entry.numLods;
+        mesh.packedVertices = bytes + entry.packedVerticesOffset;
+        mesh.packedIndices = bytes + entry.packedIndicesOffset;
+        mesh.packedIndexSize = entry.packedIndexSize;
+        mesh.scale = entry.scale;
+        mesh.offset = entry.offset;
+        mesh.center = entry.center;
+        mesh.radius = entry.radius;
+
+        for (auto j = 0u; j < mesh.numLods; ++j)
+        {
+            if (static_cast<uint64_t>(mesh.lods[j].firstIndex) + mesh.lods[j].numIndices > numAllIndices)
+                return false;
+        }
+
+        m_meshes.push_back(mesh);
+    }
+
+    return true;
+}
+
+MeshCache::MeshCache(const std::string & directory)
+:   m_directory{directory}
+{
+}
+
+MeshCache::~MeshCache() = default;
+
+std::unique_ptr<CachedScene> MeshCache::load(const std::string & path, gloperate::ResourceManager & resourceManager) const
+{
+    auto scene = loadFile(path);
+
+    if (scene)
+        return scene;
+
+    return import(path, resourceManager);
+}
+
+std::unique_ptr<CachedScene> MeshCache::loadFile(const std::string & path) const
+{
+    auto expectedHeader = MeshCacheHeader{};
+
+    if (!makeHeader(path, expectedHeader))
+        return nullptr;
+
+    const auto cachePath = filePath(path);
+
+#ifdef _WIN32
+    std::ifstream stream{cachePath, std::ios::binary | std::ios::ate};
+
+    if (!stream)
+        return nullptr;
+
+    auto bytes = std::vector<char>(static_cast<std::size_t>(stream.tellg()));
+    stream.seekg(0);
+    stream.read(bytes.data(), bytes.size());
+
+    if (!stream || bytes.size() < sizeof(MeshCacheHeader) ||
+        !matches(*reinterpret_cast<const MeshCacheHeader *>(bytes.data()), expectedHeader))
+        return nullptr;
+
+    return CachedScene::fromBytes(std::move(bytes));
+#else
+    const auto file = open(cachePath.c_str(), O_RDONLY);
+
+    if (file < 0)
+        return nullptr;
+
+    struct stat status;
+
+    if (fstat(file, &status) != 0 || static_cast<std::size_t>(status.st_size) < sizeof(MeshCacheHeader))
+    {
+        close(file);
+        return nullptr;
+    }
+
+    const auto fileSize = static_cast<std::size_t>(status.st_size);
+    const auto mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (mapped == MAP_FAILED)
+        return nullptr;
+
+    if (!matches(*static_cast<const MeshCacheHeader *>(mapped), expectedHeader))
+    {
+        munmap(mapped, fileSize);
+        return nullptr;
+    }
+
+    // the scene owns the mapping from here on, pages are only read once the arrays are uploaded
+    return CachedScene::fromMapping(mapped, fileSize);
+#endif
+}
+
+std::unique_ptr<CachedScene> MeshCache::import(const std::string & path, gloperate::ResourceManager & resourceManager) const
+{
+    auto header = MeshCacheHeader{};
+
+    if (!makeHeader(path, header))
+        return nullptr;
+
+    const auto scene = std::unique_ptr<gloperate::Scene>{resourceManager.load<gloperate::Scene>(path)};
+
+    if (!scene)
+        return nullptr;
+
+    const auto & geometries = scene->meshes();
+    header.numMeshes = static_cast<uint32_t>(geometries.size());
+
+    auto reports = std::vector<MeshOptimizationReport>(geometries.size());
+    auto lodIndices = std::vector<std::vector<unsigned int>>(geometries.size());
+    auto lods = std::vector<std::vector<MeshLod>>(geometries.size());
+    auto defaultNormals = std::vector<std::vector<glm::vec3>>(geometries.size());
+    auto packed = std::vector<PackedMesh>(geometries.size());
+
+    // meshes are independent, the largest start first so a single big mesh does not finish last on its own
+    auto order = std::vector<std::size_t>(geometries.size());
+    std::iota(order.begin(), order.end(), std::size_t{0u});
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs)
+    {
+        return geometries[lhs]->indices().size() > geometries[rhs]->indices().size();
+    });
+
+    const auto normals = [&](std::size_t i)
+    {
+        return geometries[i]->hasNormals() ? geometries[i]->normals().data() : defaultNormals[i].data();
+    };
+
+    // optimized, simplified and packed once here, the cache stores the reordered arrays, all levels of detail
+    // and the interleaved arrays the drawables upload
+    parallelFor(order, [&](std::size_t i)
+    {
+        reports[i] = MeshOptimizer::optimize(*geometries[i]);
+
+        lodIndices[i] = geometries[i]->indices();
+        lods[i] = MeshSimplifier::generateLods(lodIndices[i], geometries[i]->vertices());
+
+        const auto & geometry = *geometries[i];
+
+        if (!geometry.hasNormals())
+            defaultNormals[i].assign(geometry.vertices().size(), glm::vec3{0.0f, 0.0f, 1.0f});
+
+        auto mesh = MeshData{};
+        mesh.vertices = geometry.vertices().data();
+        mesh.normals = normals(i);
+        mesh.indices = lodIndices[i].data();
+        mesh.numVertices = static_cast<uint32_t>(geometry.vertices().size());
+        mesh.numIndices = static_cast<uint32_t>(geometry.indices().size());
+        mesh.lods = lods[i].data();
+        mesh.numLods = static_cast<uint32_t>(lods[i].size());
+
+        packed[i] = VertexFormatEncoder::pack(mesh, VertexFormat::Quantized);
+    });
+
+    // logged afterwards so the messages keep the mesh order
+    for (auto i = std::size_t{0u}; i < geometries.size(); ++i)
+    {
+        globjects::info() << "Mesh " << i << " of " << path << ": ACMR " << reports[i].before.acmr << " -> " << reports[i].after.acmr
+            << ", ATVR " << reports[i].before.atvr << " -> " << reports[i].after.atvr;
+        globjects::info() << "Mesh " << i << " of " << path << ": " << lods[i].size() << " levels of detail";
+    }
+
+    auto entries = std::vector<MeshCacheEntry>(geometries.size());
+    auto offset = align(sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheEntry));
+
+    for (auto i = std::size_t{0u}; i < geometries.size(); ++i)
+    {
+        const auto & geometry = *geometries[i];
+        auto & entry = entries[i];
+
+        entry.numVertices = static_cast<uint32_t>(geometry.vertices().size());
+        entry.numIndices = static_cast<uint32_t>(geometry.indices().size());
+        entry.numLodIndices = static_cast<uint32_t>(lodIndices[i].size() - geometry.indices().size());
+        entry.numLods = static_cast<uint32_t>(lods[i].size());
+
+        entry.verticesOffset = offset;
+        offset = align(offset + entry.numVertices * sizeof(glm::vec3));
+        entry.normalsOffset = offset;
+        offset = align(offset + entry.numVertices * sizeof(glm::vec3));
+        entry.indicesOffset = offset;
+        offset = align(offset + lodIndices[i].size() * sizeof(unsigned int));
+        entry.lodsOffset = offset;
+        offset = align(offset + entry.numLods * sizeof(MeshLod));
+        entry.packedVerticesOffset = offset;
+        offset = align(offset + packed[i].vertices.size());
+        entry.packedIndicesOffset = offset;
+        offset = align(offset + packed[i].indices.size());
+
+        entry.packedIndexSize = packed[i].indexType == gl::GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        entry.scale = packed[i].scale;
+        entry.offset = packed[i].offset;
+        entry.center = packed[i].center;
+        entry.radius = packed[i].radius;
+    }
+
+    auto bytes = std::vector<char>(offset, 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    append(bytes, sizeof(header), entries.data(), entries.size());
+
+    // every mesh writes its own ranges, so the copies need no synchronization
+    parallelFor(order, [&](std::size_t i)
+    {
+        const auto & geometry = *geometries[i];
+        const auto & entry = entries[i];
+
+        append(bytes, entry.verticesOffset, geometry.vertices().data(), entry.numVertices);
+        append(bytes, entry.normalsOffset, normals(i), entry.numVertices);
+        append(bytes, entry.indicesOffset, lodIndices[i].data(), lodIndices[i].size());
+        append(bytes, entry.lodsOffset, lods[i].data(), lods[i].size());
+        append(bytes, entry.packedVerticesOffset, packed[i].vertices.data(), packed[i].vertices.size());
+        append(bytes, entry.packedIndicesOffset, packed[i].indices.data(), packed[i].indices.size());
+    });
+
+    storeFile(path, bytes);
+
+    return CachedScene::fromBytes(std::move(bytes));
+}
+
+void MeshCache::storeFile(const std::string & path, const std::vector<char> & bytes) const
+{
+    const auto cachePath = filePath(path);
+    const auto temporaryPath = CacheDirectory::temporaryFilePath(cachePath);
+
+    // written to a temporary file first, so concurrent readers never see a partially written cache
+    {
+        std::ofstream stream{temporaryPath, std::ios::binary | std::ios::trunc};
+        stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+        if (!stream)
+        {
+            globjects::warning() << "Could not write mesh cache " << temporaryPath;
+            std::remove(temporaryPath.c_str());
+            return;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(cachePath.c_str());
+#endif
+
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+        std::remove(temporaryPath.c_str());
+}
+
+std::string MeshCache::filePath(const std::string & path) const
+{
+    const auto separator = path.find_last_of("/\\");
+    const auto name = separator == std::string::npos ? path : path.substr(separator + 1u);
+
+    std::stringstream stream;
+    stream << m_directory << name << "_" << std::hex << std::setw(16) << std::setfill('0') << hashPath(path)
+        << std::dec << "_v" << s_version << ".meshcache";
+
+    return stream.str();
+}
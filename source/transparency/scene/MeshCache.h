@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+
+namespace gloperate
+{
+    class ResourceManager;
+}
+
+/** A coarser level of detail, its indices follow those of the full detail mesh */
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t numIndices;
+    /** Geometric error of the simplification in model units */
+    float error;
+    uint32_t padding;
+};
+
+/** Arrays of a single mesh, ready to be uploaded as they are */
+struct MeshData
+{
+    const glm::vec3 * vertices;
+    const glm::vec3 * normals;
+    const unsigned int * indices;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    const MeshLod * lods;
+    uint32_t numLods;
+
+    /** Interleaved VertexFormat::Quantized vertices and the indices of all levels of detail, nullptr if not packed */
+    const char * packedVertices;
+    const char * packedIndices;
+    uint32_t packedIndexSize;
+    glm::vec3 scale;
+    glm::vec3 offset;
+
+    /** Bounding sphere in model space, only set along with the packed arrays */
+    glm::vec3 center;
+    float radius;
+};
+
+class CachedScene
+{
+public:
+    static std::unique_ptr<CachedScene> fromBytes(std::vector<char> && bytes);
+    static std::unique_ptr<CachedScene> fromMapping(void * mapping, std::size_t size);
+
+public:
+    ~CachedScene();
+
+    const std::vector<MeshData> & meshes() const;
+
+protected:
+    CachedScene();
+
+    bool parse(const char * bytes, std::size_t size);
+
+private:
+    std::vector<char> m_bytes;
+    void * m_mapping;
+    std::size_t m_mappingSize;
+    std::vector<MeshData> m_meshes;
+};
+
+class MeshCache
+{
+public:
+    // increment whenever the import or the file layout changes, invalidates cached meshes
+    static const auto s_version = 5u;
+    
+    // increment whenever the post-processing of the scene loader changes (aiProcess flags of AssimpLoader and
+    // gloperate-assimp's AssimpSceneLoader), the imported geometry differs then although the source file did not
+    static const auto s_loaderVersion = 1u;
+
+public:
+    MeshCache(const std::string & directory);
+    ~MeshCache();
+
+    /** Returns the cached meshes of the file if it did not change since, imports and caches them otherwise */
+    std::unique_ptr<CachedScene> load(const std::string & path, gloperate::ResourceManager & resourceManager) const;
+
+protected:
+    std::unique_ptr<CachedScene> loadFile(const std::string & path) const;
+    std::unique_ptr<CachedScene> import(const std::string & path, gloperate::ResourceManager & resourceManager) const;
+    void storeFile(const std::string & path, const std::vector<char> & bytes) const;
+
+    std::string filePath(const std::string & path) const;
+
+private:
+    const std::string m_directory;
+};
@@ -0,0 +1,142 @@
+#include "MeshDrawable.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <glbinding/gl/enum.h>
+
+#include <globjects/Buffer.h>
+#include <globjects/VertexArray.h>
+
+#include <gloperate/primitives/PolygonalGeometry.h>
+
+
+using namespace gl;
+
+MeshDrawable::MeshDrawable(const MeshData & mesh, VertexFormat format)
+{
+    if (format != VertexFormat::Quantized || !mesh.packedVertices)
+    {
+        setup(mesh, format);
+        return;
+    }
+
+    m_indexType = mesh.packedIndexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    m_scale = mesh.scale;
+    m_offset = mesh.offset;
+    m_center = mesh.center;
+    m_radius = mesh.radius;
+
+    setupLods(mesh);
+
+    upload(format,
+        mesh.packedVertices, mesh.numVertices * VertexFormatEncoder::stride(format),
+        mesh.packedIndices, VertexFormatEncoder::numAllIndices(mesh) * mesh.packedIndexSize);
+}
+
+MeshDrawable::MeshDrawable(const gloperate::PolygonalGeometry & geometry, VertexFormat format)
+{
+    const auto numVertices = geometry.vertices().size();
+    const auto defaultNormals = std::vector<glm::vec3>(geometry.hasNormals() ? 0u : numVertices, glm::vec3{0.0f, 0.0f, 1.0f});
+
+    auto mesh = MeshData{};
+    mesh.vertices = geometry.vertices().data();
+    mesh.normals = geometry.hasNormals() ? geometry.normals().data() : defaultNormals.data();
+    mesh.indices = geometry.indices().data();
+    mesh.numVertices = static_cast<uint32_t>(numVertices);
+    mesh.numIndices = static_cast<uint32_t>(geometry.indices().size());
+    mesh.lods = nullptr;
+    mesh.numLods = 0u;
+    mesh.packedVertices = nullptr;
+    mesh.packedIndices = nullptr;
+
+    setup(mesh, format);
+}
+
+const glm::vec3 & MeshDrawable::center() const
+{
+    return m_center;
+}
+
+float MeshDrawable::radius() const
+{
+    return m_radius;
+}
+
+unsigned int MeshDrawable::selectLod(float maxError)
+{
+    m_lod = 0u;
+
+    // errors grow with every level, so the last one within the bound is the coarsest
+    for (auto i = 1u; i < m_lods.size() && m_lods[i].error <= maxError; ++i)
+        m_lod = i;
+
+    return m_lods[m_lod].numIndices / 3u;
+}
+
+unsigned int MeshDrawable::lod() const
+{
+    return m_lod;
+}
+
+void MeshDrawable::setup(const MeshData & mesh, VertexFormat format)
+{
+    const auto packed = VertexFormatEncoder::pack(mesh, format);
+
+    m_indexType = packed.indexType;
+    m_scale = packed.scale;
+    m_offset = packed.offset;
+    m_center = packed.center;
+    m_radius = packed.radius;
+
+    setupLods(mesh);
+
+    upload(format,
+        packed.vertices.data(), packed.vertices.size(),
+        packed.indices.data(), packed.indices.size());
+}
+
+void MeshDrawable::setupLods(const MeshData & mesh)
+{
+    auto fullDetail = MeshLod{};
+    fullDetail.numIndices = mesh.numIndices;
+
+    m_lods.assign(1u, fullDetail);
+    m_lods.insert(m_lods.end(), mesh.lods, mesh.lods + mesh.numLods);
+    m_lod = 0u;
+}
+
+void MeshDrawable::upload(
+    VertexFormat format,
+    const char * vertices, std::size_t verticesSize,
+    const char * indices, std::size_t indicesSize)
+{
+    m_indices = new globjects::Buffer{};
+    m_indices->setData(static_cast<GLsizeiptr>(indicesSize), indices, GL_STATIC_DRAW);
+
+    m_vertices = new globjects::Buffer{};
+    m_vertices->setData(static_cast<GLsizeiptr>(verticesSize), vertices, GL_STATIC_DRAW);
+
+    m_vao = new globjects::VertexArray{};
+    m_vao->bind();
+
+    m_indices->bind(GL_ELEMENT_ARRAY_BUFFER);
+
+    VertexFormatEncoder::setupAttributes(m_vao, m_vertices, format);
+
+    m_vao->unbind();
+}
+
+void MeshDrawable::draw()
+{
+    const auto & lod = m_lods[m_lod];
+    const auto indexSize = m_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    VertexFormatEncoder::setDequantization(m_scale, m_offset);
+
+    m_vao->bind();
+    m_vao->drawElements(GL_TRIANGLES, static_cast<GLsizei>(lod.numIndices), m_indexType,
+        reinterpret_cast<const void *>(lod.firstIndex * indexSize));
+    m_vao->unbind();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <glbinding/gl/types.h>
+
+#include <globjects/base/ref_ptr.h>
+
+#include "MeshCache.h"
+#include "VertexFormat.h"
+
+
+namespace globjects
+{
+    class Buffer;
+    class VertexArray;
+}
+
+namespace gloperate
+{
+    class PolygonalGeometry;
+}
+
+class MeshDrawable
+{
+public:
+    /** Uploads the packed arrays of the mesh as they are, e.g., straight from a mapped mesh cache, packs the others */
+    MeshDrawable(const MeshData & mesh, VertexFormat format = VertexFormat::Quantized);
+    MeshDrawable(const gloperate::PolygonalGeometry & geometry, VertexFormat format = VertexFormat::Quantized);
+
+    /** Bounding sphere in model space */
+    const glm::vec3 & center() const;
+    float radius() const;
+
+    /** Picks the coarsest level of detail whose error stays within maxError model units, returns its number of triangles */
+    unsigned int selectLod(float maxError);
+    unsigned int lod() const;
+
+    void draw();
+
+protected:
+    void setup(const MeshData & mesh, VertexFormat format);
+    void setupLods(const MeshData & mesh);
+    void upload(
+        VertexFormat format,
+        const char * vertices, std::size_t verticesSize,
+        const char * indices, std::size_t indicesSize);
+
+private:
+    globjects::ref_ptr<globjects::VertexArray> m_vao;
+    globjects::ref_ptr<globjects::Buffer> m_indices;
+    globjects::ref_ptr<globjects::Buffer> m_vertices;
+    gl::GLenum m_indexType;
+    glm::vec3 m_scale;
+    glm::vec3 m_offset;
+
+    glm::vec3 m_center;
+    float m_radius;
+
+    /** All levels of detail, the first one is the full mesh */
+    std::vector<MeshLod> m_lods;
+    unsigned int m_lod;
+};
@@ -0,0 +1,431 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <glm/glm.hpp>
+
+#include <gloperate/primitives/PolygonalGeometry.h>
+
+
+namespace
+{
+
+// scoring cache of the vertex cache optimization, larger than the simulated FIFO so scores fall off gradually
+const auto kScoringCacheSize = 32u;
+const auto kCacheDecayPower = 1.5f;
+const auto kLastTriangleScore = 0.75f;
+const auto kValenceBoostScale = 2.0f;
+const auto kValenceBoostPower = 0.5f;
+
+const auto kOverdrawThreshold = 1.05f;
+
+const auto kNoTriangle = std::numeric_limits<unsigned int>::max();
+
+float vertexScore(int cachePosition, unsigned int remainingValence)
+{
+    if (remainingValence == 0u)
+        return -1.0f;
+
+    auto score = 0.0f;
+
+    if (cachePosition >= 0)
+    {
+        // the vertices of the last triangle get a fixed score, so the next triangle does not just reuse its edge
+        if (cachePosition < 3)
+            score = kLastTriangleScore;
+        else
+            score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (kScoringCacheSize - 3u), kCacheDecayPower);
+    }
+
+    // prefers vertices with few remaining triangles, so they leave the mesh early
+    return score + kValenceBoostScale * std::pow(static_cast<float>(remainingValence), -kValenceBoostPower);
+}
+
+class FifoCache
+{
+public:
+    FifoCache(unsigned int numVertices, unsigned int cacheSize)
+    :   m_timestamps(numVertices, 0u)
+    ,   m_cacheSize(cacheSize)
+    ,   m_time(cacheSize + 1u)
+    {
+    }
+
+    void reset()
+    {
+        m_time += m_cacheSize + 1u;
+    }
+
+    /** Returns the number of vertices of the triangle that had to be transformed */
+    unsigned int access(const unsigned int * triangle)
+    {
+        auto misses = 0u;
+
+        for (auto i = 0u; i < 3u; ++i)
+        {
+            if (m_time - m_timestamps[triangle[i]] > m_cacheSize)
+            {
+                m_timestamps[triangle[i]] = m_time++;
+                ++misses;
+            }
+        }
+
+        return misses;
+    }
+
+private:
+    std::vector<unsigned int> m_timestamps;
+    unsigned int m_cacheSize;
+    unsigned int m_time;
+};
+
+}
+
+MeshOptimizationReport MeshOptimizer::optimize(gloperate::PolygonalGeometry & geometry)
+{
+    auto indices = geometry.indices();
+    auto vertices = geometry.vertices();
+    auto normals = geometry.hasNormals() ? geometry.normals() : std::vector<glm::vec3>{};
+
+    const auto report = optimize(indices, vertices, normals);
+
+    geometry.setIndices(std::move(indices));
+    geometry.setVertices(std::move(vertices));
+
+    if (!normals.empty())
+        geometry.setNormals(std::move(normals));
+
+    return report;
+}
+
+MeshOptimizationReport MeshOptimizer::optimize(
+    std::vector<unsigned int> & indices,
+    std::vector<glm::vec3> & vertices,
+    std::vector<glm::vec3> & normals)
+{
+    auto report = MeshOptimizationReport{};
+    report.before = analyze(indices, static_cast<unsigned int>(vertices.size()));
+
+    indices = optimizeVertexCache(indices, static_cast<unsigned int>(vertices.size()));
+    indices = optimizeOverdraw(indices, vertices, kOverdrawThreshold);
+    optimizeVertexFetch(indices, vertices, normals);
+
+    report.after = analyze(indices, static_cast<unsigned int>(vertices.size()));
+    return report;
+}
+
+std::vector<unsigned int> MeshOptimizer::optimizeVertexCache(const std::vector<unsigned int> & indices, unsigned int numVertices)
+{
+    const auto numTriangles = static_cast<unsigned int>(indices.size() / 3u);
+
+    // triangles adjacent to each vertex, the first remainingValence entries are the ones not emitted yet
+    auto remainingValence = std::vector<unsigned int>(numVertices, 0u);
+
+    for (auto i = 0u; i < numTriangles * 3u; ++i)
+        ++remainingValence[indices[i]];
+
+    auto adjacencyOffsets = std::vector<unsigned int>(numVertices + 1u, 0u);
+    std::partial_sum(remainingValence.begin(), remainingValence.end(), adjacencyOffsets.begin() + 1);
+
+    auto adjacency = std::vector<unsigned int>(numTriangles * 3u);
+    auto adjacencyCounts = std::vector<unsigned int>(numVertices, 0u);
+
+    for (auto i = 0u; i < numTriangles * 3u; ++i)
+    {
+        const auto vertex = indices[i];
+        adjacency[adjacencyOffsets[vertex] + adjacencyCounts[vertex]++] = i / 3u;
+    }
+
+    auto vertexScores = std::vector<float>(numVertices);
+
+    for (auto i = 0u; i < numVertices; ++i)
+        vertexScores[i] = vertexScore(-1, remainingValence[i]);
+
+    auto triangleScores = std::vector<float>(numTriangles);
+    auto emitted = std::vector<bool>(numTriangles, false);
+
+    for (auto i = 0u; i < numTriangles; ++i)
+        triangleScores[i] = vertexScores[indices[i * 3u]] + vertexScores[indices[i * 3u + 1u]] + vertexScores[indices[i * 3u + 2u]];
+
+    auto result = std::vector<unsigned int>{};
+    result.reserve(numTriangles * 3u);
+
+    auto cache = std::vector<unsigned int>{};
+    auto newCache = std::vector<unsigned int>{};
+    cache.reserve(kScoringCacheSize + 3u);
+    newCache.reserve(kScoringCacheSize + 3u);
+
+    auto bestTriangle = numTriangles > 0u ? 0u : kNoTriangle;
+    auto inputCursor = 0u;
+
+    while (bestTriangle != kNoTriangle)
+    {
+        const auto triangle = &indices[bestTriangle * 3u];
+        result.insert(result.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        // remove the triangle from the remaining adjacency of its vertices
+        for (auto i = 0u; i < 3u; ++i)
+        {
+            const auto vertex = triangle[i];
+            const auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+            const auto end = begin + remainingValence[vertex];
+
+            std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+            --remainingValence[vertex];
+        }
+
+        newCache.assign(triangle, triangle + 3);
+
+        for (const auto vertex : cache)
+        {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                newCache.push_back(vertex);
+        }
+
+        std::swap(cache, newCache);
+
+        // update the scores of all vertices whose cache position changed, including those that fell out
+        for (auto i = 0u; i < cache.size(); ++i)
+        {
+            const auto vertex = cache[i];
+            const auto position = i < kScoringCacheSize ? static_cast<int>(i) : -1;
+
+            const auto score = vertexScore(position, remainingValence[vertex]);
+            const auto delta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            const auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+
+            for (auto it = begin; it != begin + remainingValence[vertex]; ++it)
+                triangleScores[*it] += delta;
+        }
+
+        if (cache.size() > kScoringCacheSize)
+            cache.resize(kScoringCacheSize);
+
+        // the next triangle is the best one touching the cache, other triangles did not change their score
+        bestTriangle = kNoTriangle;
+        auto bestScore = -std::numeric_limits<float>::max();
+
+        for (const auto vertex : cache)
+        {
+            const auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+
+            for (auto it = begin; it != begin + remainingValence[vertex]; ++it)
+            {
+                if (triangleScores[*it] > bestScore)
+                {
+                    bestScore = triangleScores[*it];
+                    bestTriangle = *it;
+                }
+            }
+        }
+
+        if (bestTriangle != kNoTriangle)
+            continue;
+
+        // dead end, continue with the next triangle in input order
+        while (inputCursor < numTriangles && emitted[inputCursor])
+            ++inputCursor;
+
+        if (inputCursor < numTriangles)
+            bestTriangle = inputCursor;
+    }
+
+    return result;
+}
+
+std::vector<unsigned int> MeshOptimizer::optimizeOverdraw(
+    const std::vector<unsigned int> & indices,
+    const std::vector<glm::vec3> & vertices,
+    float threshold)
+{
+    const auto numTriangles = static_cast<unsigned int>(indices.size() / 3u);
+
+    if (numTriangles == 0u)
+        return indices;
+
+    auto cache = FifoCache{static_cast<unsigned int>(vertices.size()), s_fifoCacheSize};
+
+    // hard boundaries, triangles that miss with all three vertices start over anyway
+    auto hardBoundaries = std::vector<unsigned int>{};
+
+    for (auto i = 0u; i < numTriangles; ++i)
+    {
+        if (cache.access(&indices[i * 3u]) == 3u)
+            hardBoundaries.push_back(i);
+    }
+
+    hardBoundaries.push_back(numTriangles);
+
+    // soft boundaries, split hard clusters further wherever the ACMR so far stays within the threshold
+    auto clusters = std::vector<unsigned int>{};
+
+    for (auto i = 0u; i + 1u < hardBoundaries.size(); ++i)
+    {
+        const auto start = hardBoundaries[i], end = hardBoundaries[i + 1u];
+
+        cache.reset();
+
+        auto clusterMisses = 0u;
+        for (auto j = start; j < end; ++j)
+            clusterMisses += cache.access(&indices[j * 3u]);
+
+        const auto clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+        cache.reset();
+        clusters.push_back(start);
+
+        auto clusterStart = start;
+        auto misses = 0u;
+
+        for (auto j = start; j < end; ++j)
+        {
+            misses += cache.access(&indices[j * 3u]);
+
+            const auto acmr = static_cast<float>(misses) / static_cast<float>(j + 1u - clusterStart);
+
+            if (j + 1u < end && acmr <= clusterThreshold)
+            {
+                clusterStart = j + 1u;
+                clusters.push_back(clusterStart);
+                misses = 0u;
+                cache.reset();
+            }
+        }
+    }
+
+    clusters.push_back(numTriangles);
+
+    auto meshCentroid = glm::vec3{0.0f};
+    auto meshArea = 0.0f;
+
+    auto clusterCentroids = std::vector<glm::vec3>(clusters.size() - 1u, glm::vec3{0.0f});
+    auto clusterNormals = std::vector<glm::vec3>(clusters.size() - 1u, glm::vec3{0.0f});
+
+    for (auto i = 0u; i + 1u < clusters.size(); ++i)
+    {
+        auto clusterArea = 0.0f;
+
+        for (auto j = clusters[i]; j < clusters[i + 1u]; ++j)
+        {
+            const auto & a = vertices[indices[j * 3u]];
+            const auto & b = vertices[indices[j * 3u + 1u]];
+            const auto & c = vertices[indices[j * 3u + 2u]];
+
+            // the length of the cross product is twice the area, which weights both sums alike
+            const auto normal = glm::cross(b - a, c - a);
+            const auto area = glm::length(normal);
+            const auto centroid = (a + b + c) / 3.0f;
+
+            clusterCentroids[i] += centroid * area;
+            clusterNormals[i] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroids[i];
+        meshArea += clusterArea;
+
+        if (clusterArea > 0.0f)
+            clusterCentroids[i] /= clusterArea;
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // clusters far out and facing away from the center are likely to occlude the others, so they are drawn first
+    auto sortKeys = std::vector<float>(clusters.size() - 1u);
+
+    for (auto i = 0u; i < sortKeys.size(); ++i)
+    {
+        const auto length = glm::length(clusterNormals[i]);
+        sortKeys[i] = length > 0.0f ? glm::dot(clusterCentroids[i] - meshCentroid, clusterNormals[i] / length) : 0.0f;
+    }
+
+    auto order = std::vector<unsigned int>(sortKeys.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys] (unsigned int lhs, unsigned int rhs)
+    {
+        return sortKeys[lhs] > sortKeys[rhs];
+    });
+
+    auto result = std::vector<unsigned int>{};
+    result.reserve(numTriangles * 3u);
+
+    for (const auto cluster : order)
+        result.insert(result.end(), indices.begin() + clusters[cluster] * 3u, indices.begin() + clusters[cluster + 1u] * 3u);
+
+    return result;
+}
+
+void MeshOptimizer::optimizeVertexFetch(
+    std::vector<unsigned int> & indices,
+    std::vector<glm::vec3> & vertices,
+    std::vector<glm::vec3> & normals)
+{
+    const auto noVertex = std::numeric_limits<unsigned int>::max();
+
+    auto remap = std::vector<unsigned int>(vertices.size(), noVertex);
+    auto numReferenced = 0u;
+
+    for (auto & index : indices)
+    {
+        if (remap[index] == noVertex)
+            remap[index] = numReferenced++;
+
+        index = remap[index];
+    }
+
+    auto remappedVertices = std::vector<glm::vec3>(numReferenced);
+    auto remappedNormals = std::vector<glm::vec3>(normals.empty() ? 0u : numReferenced);
+
+    for (auto i = std::size_t{0u}; i < vertices.size(); ++i)
+    {
+        if (remap[i] == noVertex)
+            continue;
+
+        remappedVertices[remap[i]] = vertices[i];
+
+        if (!normals.empty())
+            remappedNormals[remap[i]] = normals[i];
+    }
+
+    vertices = std::move(remappedVertices);
+    normals = std::move(remappedNormals);
+}
+
+VertexCacheStatistics MeshOptimizer::analyze(
+    const std::vector<unsigned int> & indices,
+    unsigned int numVertices,
+    unsigned int cacheSize)
+{
+    const auto numTriangles = static_cast<unsigned int>(indices.size() / 3u);
+
+    auto cache = FifoCache{numVertices, cacheSize};
+    auto referenced = std::vector<bool>(numVertices, false);
+    auto misses = 0u;
+    auto numReferenced = 0u;
+
+    for (auto i = 0u; i < numTriangles; ++i)
+    {
+        misses += cache.access(&indices[i * 3u]);
+
+        for (auto j = 0u; j < 3u; ++j)
+        {
+            if (!referenced[indices[i * 3u + j]])
+            {
+                referenced[indices[i * 3u + j]] = true;
+                ++numReferenced;
+            }
+        }
+    }
+
+    auto statistics = VertexCacheStatistics{};
+    statistics.acmr = numTriangles > 0u ? static_cast<float>(misses) / numTriangles : 0.0f;
+    statistics.atvr = numReferenced > 0u ? static_cast<float>(misses) / numReferenced : 0.0f;
+    return statistics;
+}
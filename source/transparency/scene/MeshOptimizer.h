@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/fwd.hpp>
+
+
+namespace gloperate
+{
+    class PolygonalGeometry;
+}
+
+/** Post-transform cache efficiency of an index buffer, measured with a simulated FIFO cache */
+struct VertexCacheStatistics
+{
+    /** Average cache miss ratio, transformed vertices per triangle */
+    float acmr;
+    /** Average transform to vertex ratio, transformed vertices per referenced vertex */
+    float atvr;
+};
+
+struct MeshOptimizationReport
+{
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+};
+
+class MeshOptimizer
+{
+public:
+    static const auto s_fifoCacheSize = 16u;
+
+public:
+    /** Reorders triangles for vertex cache reuse and overdraw, then vertices for fetch locality */
+    static MeshOptimizationReport optimize(gloperate::PolygonalGeometry & geometry);
+    static MeshOptimizationReport optimize(
+        std::vector<unsigned int> & indices,
+        std::vector<glm::vec3> & vertices,
+        std::vector<glm::vec3> & normals);
+
+    /** Triangle order after Forsyth's linear-speed vertex cache optimization */
+    static std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int> & indices, unsigned int numVertices);
+
+    /**
+     *  Splits the triangles into clusters at cache misses and draws outward facing clusters first, after Sander et al.
+     *  Clusters may raise the ACMR of their part of the mesh by the threshold factor.
+     */
+    static std::vector<unsigned int> optimizeOverdraw(
+        const std::vector<unsigned int> & indices,
+        const std::vector<glm::vec3> & vertices,
+        float threshold);
+
+    /** Renumbers vertices in order of first use and drops unreferenced ones */
+    static void optimizeVertexFetch(
+        std::vector<unsigned int> & indices,
+        std::vector<glm::vec3> & vertices,
+        std::vector<glm::vec3> & normals);
+
+    static VertexCacheStatistics analyze(
+        const std::vector<unsigned int> & indices,
+        unsigned int numVertices,
+        unsigned int cacheSize = s_fifoCacheSize);
+};
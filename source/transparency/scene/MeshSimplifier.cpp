@@ -0,0 +1,370 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "MeshOptimizer.h"
+
+
+namespace
+{
+
+// moving a border vertex off its border opens a hole, so those planes weigh more
+const auto kBorderWeight = 10.0;
+
+// coarser levels that keep more than this share of the triangles are not worth storing
+const auto kMinReduction = 0.85f;
+
+enum class VertexKind : uint8_t { Manifold, Border, Locked };
+
+/** Symmetric 4x4 matrix of the squared distance to a set of planes */
+struct Quadric
+{
+    std::array<double, 10> m;
+};
+
+Quadric planeQuadric(const glm::vec3 & normal, const glm::vec3 & point, double weight)
+{
+    const auto a = static_cast<double>(normal.x), b = static_cast<double>(normal.y), c = static_cast<double>(normal.z);
+    const auto d = -(a * point.x + b * point.y + c * point.z);
+
+    return Quadric{{{
+        weight * a * a, weight * a * b, weight * a * c, weight * a * d,
+        weight * b * b, weight * b * c, weight * b * d,
+        weight * c * c, weight * c * d,
+        weight * d * d }}};
+}
+
+void add(Quadric & quadric, const Quadric & other)
+{
+    for (auto i = 0u; i < quadric.m.size(); ++i)
+        quadric.m[i] += other.m[i];
+}
+
+double evaluate(const Quadric & q, const Quadric & r, const glm::vec3 & point)
+{
+    const auto x = static_cast<double>(point.x), y = static_cast<double>(point.y), z = static_cast<double>(point.z);
+    auto m = q.m;
+
+    for (auto i = 0u; i < m.size(); ++i)
+        m[i] += r.m[i];
+
+    const auto error =
+        m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x +
+        m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y +
+        m[7] * z * z + 2.0 * m[8] * z +
+        m[9];
+
+    // rounding may push exact fits slightly below zero
+    return std::max(error, 0.0);
+}
+
+uint64_t edgeKey(unsigned int a, unsigned int b)
+{
+    return (static_cast<uint64_t>(std::min(a, b)) << 32u) | std::max(a, b);
+}
+
+std::unordered_map<uint64_t, unsigned int> countEdges(const std::vector<unsigned int> & indices)
+{
+    auto edges = std::unordered_map<uint64_t, unsigned int>{};
+    edges.reserve(indices.size());
+
+    for (auto i = std::size_t{0u}; i < indices.size(); i += 3u)
+    {
+        for (auto j = 0u; j < 3u; ++j)
+            ++edges[edgeKey(indices[i + j], indices[i + (j + 1u) % 3u])];
+    }
+
+    return edges;
+}
+
+// vertices split at attribute seams share their position, moving only one of them would tear the surface
+std::vector<bool> findSeams(const std::vector<glm::vec3> & vertices)
+{
+    auto seams = std::vector<bool>(vertices.size(), false);
+
+    auto order = std::vector<unsigned int>(vertices.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&vertices] (unsigned int lhs, unsigned int rhs)
+    {
+        const auto & a = vertices[lhs];
+        const auto & b = vertices[rhs];
+        return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z);
+    });
+
+    for (auto i = std::size_t{1u}; i < order.size(); ++i)
+    {
+        const auto & a = vertices[order[i - 1u]];
+        const auto & b = vertices[order[i]];
+
+        if (a.x == b.x && a.y == b.y && a.z == b.z)
+            seams[order[i - 1u]] = seams[order[i]] = true;
+    }
+
+    return seams;
+}
+
+std::vector<VertexKind> classifyVertices(const std::vector<bool> & seams, const std::unordered_map<uint64_t, unsigned int> & edges)
+{
+    auto kinds = std::vector<VertexKind>(seams.size(), VertexKind::Manifold);
+
+    for (auto i = std::size_t{0u}; i < seams.size(); ++i)
+    {
+        if (seams[i])
+            kinds[i] = VertexKind::Locked;
+    }
+
+    for (const auto & edge : edges)
+    {
+        const auto a = static_cast<unsigned int>(edge.first >> 32u);
+        const auto b = static_cast<unsigned int>(edge.first & 0xffffffffu);
+
+        if (edge.second > 2u)
+        {
+            kinds[a] = kinds[b] = VertexKind::Locked;
+        }
+        else if (edge.second == 1u)
+        {
+            for (const auto vertex : { a, b })
+            {
+                if (kinds[vertex] == VertexKind::Manifold)
+                    kinds[vertex] = VertexKind::Border;
+            }
+        }
+    }
+
+    return kinds;
+}
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(
+    const std::vector<unsigned int> & indices,
+    const std::vector<glm::vec3> & vertices,
+    unsigned int targetNumIndices,
+    float & error)
+{
+    const auto numVertices = static_cast<unsigned int>(vertices.size());
+
+    auto result = std::vector<unsigned int>(indices.begin(), indices.begin() + indices.size() / 3u * 3u);
+    auto maxCost = 0.0;
+
+    auto quadrics = std::vector<Quadric>(numVertices, Quadric{});
+    const auto initialEdges = countEdges(result);
+    const auto seams = findSeams(vertices);
+
+    for (auto i = std::size_t{0u}; i < result.size(); i += 3u)
+    {
+        const auto & a = vertices[result[i]];
+        const auto & b = vertices[result[i + 1u]];
+        const auto & c = vertices[result[i + 2u]];
+
+        const auto normal = glm::cross(b - a, c - a);
+        const auto length = glm::length(normal);
+
+        if (length <= 0.0f)
+            continue;
+
+        const auto quadric = planeQuadric(normal / length, a, 1.0);
+
+        for (auto j = 0u; j < 3u; ++j)
+        {
+            add(quadrics[result[i + j]], quadric);
+
+            const auto from = result[i + j], to = result[i + (j + 1u) % 3u];
+
+            if (initialEdges.at(edgeKey(from, to)) != 1u)
+                continue;
+
+            // a plane through the border edge, perpendicular to the triangle
+            const auto edge = vertices[to] - vertices[from];
+            const auto borderNormal = glm::cross(edge, normal / length);
+            const auto borderLength = glm::length(borderNormal);
+
+            if (borderLength <= 0.0f)
+                continue;
+
+            const auto borderQuadric = planeQuadric(borderNormal / borderLength, vertices[from], kBorderWeight);
+            add(quadrics[from], borderQuadric);
+            add(quadrics[to], borderQuadric);
+        }
+    }
+
+    auto remap = std::vector<unsigned int>(numVertices);
+    auto passLocked = std::vector<bool>(numVertices);
+    auto adjacencyOffsets = std::vector<unsigned int>(numVertices + 1u);
+    auto adjacency = std::vector<unsigned int>{};
+    auto collapses = std::vector<Collapse>{};
+
+    // each pass collapses a set of independent edges, then rebuilds the triangles
+    while (result.size() > targetNumIndices)
+    {
+        const auto edges = countEdges(result);
+        const auto kinds = classifyVertices(seams, edges);
+
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u);
+
+        for (const auto index : result)
+            ++adjacencyOffsets[index + 1u];
+
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+        adjacency.resize(result.size());
+        auto fill = std::vector<unsigned int>(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+        for (auto i = 0u; i < result.size(); ++i)
+            adjacency[fill[result[i]]++] = i / 3u;
+
+        collapses.clear();
+
+        for (auto i = std::size_t{0u}; i < result.size(); i += 3u)
+        {
+            for (auto j = 0u; j < 3u; ++j)
+            {
+                const auto a = result[i + j], b = result[i + (j + 1u) % 3u];
+                const auto border = edges.at(edgeKey(a, b)) == 1u;
+
+                for (const auto & direction : { std::make_pair(a, b), std::make_pair(b, a) })
+                {
+                    const auto from = direction.first, to = direction.second;
+
+                    // border vertices may only slide along their border
+                    if (kinds[from] == VertexKind::Locked || (kinds[from] == VertexKind::Border && !border))
+                        continue;
+
+                    collapses.push_back({ from, to, evaluate(quadrics[from], quadrics[to], vertices[to]) });
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [] (const Collapse & lhs, const Collapse & rhs)
+        {
+            return lhs.cost < rhs.cost;
+        });
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(passLocked.begin(), passLocked.end(), false);
+
+        const auto trianglesToRemove = static_cast<unsigned int>((result.size() - targetNumIndices) / 3u);
+        auto removedTriangles = 0u;
+        auto numCollapses = 0u;
+
+        for (const auto & collapse : collapses)
+        {
+            if (removedTriangles >= std::max(trianglesToRemove, 1u))
+                break;
+
+            if (passLocked[collapse.from] || passLocked[collapse.to])
+                continue;
+
+            const auto begin = adjacency.begin() + adjacencyOffsets[collapse.from];
+            const auto end = adjacency.begin() + adjacencyOffsets[collapse.from + 1u];
+
+            auto flips = false;
+            auto collapsed = 0u;
+
+            for (auto it = begin; it != end && !flips; ++it)
+            {
+                const auto triangle = &result[*it * 3u];
+
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    ++collapsed;
+                    continue;
+                }
+
+                auto moved = std::array<glm::vec3, 3>{{ vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]] }};
+                const auto before = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+                for (auto k = 0u; k < 3u; ++k)
+                {
+                    if (triangle[k] == collapse.from)
+                        moved[k] = vertices[collapse.to];
+                }
+
+                const auto after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+
+            if (flips)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            add(quadrics[collapse.to], quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+            removedTriangles += collapsed;
+            ++numCollapses;
+
+            // the neighborhood stays fixed for the rest of the pass, so the flip tests above remain valid
+            for (auto it = begin; it != end; ++it)
+            {
+                for (auto k = 0u; k < 3u; ++k)
+                    passLocked[result[*it * 3u + k]] = true;
+            }
+        }
+
+        if (numCollapses == 0u)
+            break;
+
+        auto next = std::vector<unsigned int>{};
+        next.reserve(result.size());
+
+        for (auto i = std::size_t{0u}; i < result.size(); i += 3u)
+        {
+            const auto a = remap[result[i]], b = remap[result[i + 1u]], c = remap[result[i + 2u]];
+
+            if (a != b && b != c && c != a)
+                next.insert(next.end(), { a, b, c });
+        }
+
+        result = std::move(next);
+    }
+
+    error = static_cast<float>(std::sqrt(maxCost));
+    return result;
+}
+
+std::vector<MeshLod> MeshSimplifier::generateLods(std::vector<unsigned int> & indices, const std::vector<glm::vec3> & vertices)
+{
+    auto lods = std::vector<MeshLod>{};
+    auto current = indices;
+    auto error = 0.0f;
+
+    while (lods.size() + 1u < s_maxNumLods && current.size() / 6u >= s_minNumTriangles)
+    {
+        auto levelError = 0.0f;
+        auto next = simplify(current, vertices, static_cast<unsigned int>(current.size() / 6u * 3u), levelError);
+
+        if (next.size() > current.size() * kMinReduction)
+            break;
+
+        next = MeshOptimizer::optimizeVertexCache(next, static_cast<unsigned int>(vertices.size()));
+
+        // each level starts from the previous one, so the errors add up
+        error += levelError;
+
+        auto lod = MeshLod{};
+        lod.firstIndex = static_cast<uint32_t>(indices.size());
+        lod.numIndices = static_cast<uint32_t>(next.size());
+        lod.error = error;
+        lods.push_back(lod);
+
+        indices.insert(indices.end(), next.begin(), next.end());
+        current = std::move(next);
+    }
+
+    return lods;
+}
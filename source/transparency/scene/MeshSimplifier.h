@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/fwd.hpp>
+
+#include "MeshCache.h"
+
+
+class MeshSimplifier
+{
+public:
+    static const auto s_maxNumLods = 8u;
+    static const auto s_minNumTriangles = 64u;
+
+public:
+    /**
+     *  Collapses edges in order of their quadric error until about targetNumIndices remain.
+     *  Vertices are only ever merged into existing ones, so all levels share the vertex arrays.
+     *  Returns the geometric error in model units through error.
+     */
+    static std::vector<unsigned int> simplify(
+        const std::vector<unsigned int> & indices,
+        const std::vector<glm::vec3> & vertices,
+        unsigned int targetNumIndices,
+        float & error);
+
+    /** Halves the triangles per level, appends the indices of the coarser levels and returns their ranges */
+    static std::vector<MeshLod> generateLods(std::vector<unsigned int> & indices, const std::vector<glm::vec3> & vertices);
+};
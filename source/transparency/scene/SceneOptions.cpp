@@ -0,0 +1,123 @@
+#include "SceneOptions.h"
+
+#include <gloperate/painter/Painter.h>
+
+
+SceneOptions::SceneOptions(gloperate::Painter & painter)
+:   m_source(SceneSource::File)
+,   m_syntheticLayers(8u)
+,   m_syntheticInstances(16u)
+,   m_syntheticTessellation(8u)
+,   m_syntheticSize(1.0f)
+,   m_numTriangles(0u)
+,   m_sceneChanged(false)
+{
+    painter.addProperty<SceneSource>("scene", this,
+        &SceneOptions::source,
+        &SceneOptions::setSource)->setStrings({
+        { SceneSource::File, "File" },
+        { SceneSource::Synthetic, "Synthetic" }});
+    
+    painter.addProperty<uint16_t>("synthetic_layers", this,
+        &SceneOptions::syntheticLayers,
+        &SceneOptions::setSyntheticLayers)->setOptions({
+        { "minimum", 1u },
+        { "maximum", 128u }});
+    
+    painter.addProperty<uint16_t>("synthetic_instances", this,
+        &SceneOptions::syntheticInstances,
+        &SceneOptions::setSyntheticInstances)->setOptions({
+        { "minimum", 1u },
+        { "maximum", 1024u }});
+    
+    painter.addProperty<uint16_t>("synthetic_tessellation", this,
+        &SceneOptions::syntheticTessellation,
+        &SceneOptions::setSyntheticTessellation)->setOptions({
+        { "minimum", 1u },
+        { "maximum", 256u }});
+    
+    painter.addProperty<float>("synthetic_size", this,
+        &SceneOptions::syntheticSize,
+        &SceneOptions::setSyntheticSize)->setOptions({
+        { "minimum", 0.05f },
+        { "maximum", 4.0f },
+        { "step", 0.05f },
+        { "precision", 2u }});
+    
+    painter.addProperty<const uint32_t>("num_triangles", this,
+        &SceneOptions::numTriangles);
+}
+
+SceneOptions::~SceneOptions() = default;
+
+SceneSource SceneOptions::source() const
+{
+    return m_source;
+}
+
+void SceneOptions::setSource(SceneSource source)
+{
+    m_source = source;
+    m_sceneChanged = true;
+}
+
+uint16_t SceneOptions::syntheticLayers() const
+{
+    return m_syntheticLayers;
+}
+
+void SceneOptions::setSyntheticLayers(uint16_t numLayers)
+{
+    m_syntheticLayers = numLayers;
+    m_sceneChanged = m_sceneChanged || m_source == SceneSource::Synthetic;
+}
+
+uint16_t SceneOptions::syntheticInstances() const
+{
+    return m_syntheticInstances;
+}
+
+void SceneOptions::setSyntheticInstances(uint16_t numInstances)
+{
+    m_syntheticInstances = numInstances;
+    m_sceneChanged = m_sceneChanged || m_source == SceneSource::Synthetic;
+}
+
+uint16_t SceneOptions::syntheticTessellation() const
+{
+    return m_syntheticTessellation;
+}
+
+void SceneOptions::setSyntheticTessellation(uint16_t tessellation)
+{
+    m_syntheticTessellation = tessellation;
+    m_sceneChanged = m_sceneChanged || m_source == SceneSource::Synthetic;
+}
+
+float SceneOptions::syntheticSize() const
+{
+    return m_syntheticSize;
+}
+
+void SceneOptions::setSyntheticSize(float size)
+{
+    m_syntheticSize = size;
+    m_sceneChanged = m_sceneChanged || m_source == SceneSource::Synthetic;
+}
+
+uint32_t SceneOptions::numTriangles() const
+{
+    return m_numTriangles;
+}
+
+void SceneOptions::setNumTriangles(uint32_t numTriangles)
+{
+    m_numTriangles = numTriangles;
+}
+
+bool SceneOptions::sceneChanged() const
+{
+    const auto changed = m_sceneChanged;
+    m_sceneChanged = false;
+    return changed;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include <reflectionzeug/PropertyGroup.h>
+
+
+namespace gloperate
+{
+    class Painter;
+}
+
+enum class SceneSource { File, Synthetic };
+
+class SceneOptions
+{
+public:
+    SceneOptions(gloperate::Painter & painter);
+    ~SceneOptions();
+    
+    SceneSource source() const;
+    void setSource(SceneSource source);
+    
+    uint16_t syntheticLayers() const;
+    void setSyntheticLayers(uint16_t numLayers);
+    
+    uint16_t syntheticInstances() const;
+    void setSyntheticInstances(uint16_t numInstances);
+    
+    uint16_t syntheticTessellation() const;
+    void setSyntheticTessellation(uint16_t tessellation);
+    
+    float syntheticSize() const;
+    void setSyntheticSize(float size);
+    
+    uint32_t numTriangles() const;
+    void setNumTriangles(uint32_t numTriangles);
+    
+    bool sceneChanged() const;
+
+private:
+    SceneSource m_source;
+    uint16_t m_syntheticLayers;
+    uint16_t m_syntheticInstances;
+    uint16_t m_syntheticTessellation;
+    float m_syntheticSize;
+    uint32_t m_numTriangles;
+    mutable bool m_sceneChanged;
+};
@@ -0,0 +1,98 @@
+#include "SyntheticSceneGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <gloperate/primitives/PolygonalGeometry.h>
+
+
+namespace
+{
+
+// instances are placed within the bounds of the file scene, so the default camera sees all of them
+const auto kExtent = glm::vec3{1.5f, 1.0f, 1.5f};
+
+// the layers of an instance span half of its edge length
+const auto kStackDepth = 0.5f;
+
+}
+
+std::unique_ptr<gloperate::PolygonalGeometry> SyntheticSceneGenerator::generate(
+    uint16_t numLayers,
+    uint16_t numInstances,
+    uint16_t tessellation,
+    float size)
+{
+    numLayers = std::max<uint16_t>(numLayers, 1u);
+    tessellation = std::max<uint16_t>(tessellation, 1u);
+    
+    const auto trianglesPerInstance = 2u * tessellation * tessellation * numLayers;
+    const auto numEmitted = std::min<uint32_t>(numInstances, std::max<uint32_t>(s_maxNumTriangles / trianglesPerInstance, 1u));
+    const auto verticesPerLayer = (tessellation + 1u) * (tessellation + 1u);
+    
+    auto vertices = std::vector<glm::vec3>{};
+    auto normals = std::vector<glm::vec3>{};
+    auto indices = std::vector<unsigned int>{};
+    
+    vertices.reserve(numEmitted * numLayers * verticesPerLayer);
+    normals.reserve(vertices.capacity());
+    indices.reserve(numEmitted * trianglesPerInstance * 3u);
+    
+    // a fixed seed keeps the scene identical between runs, so measurements stay comparable
+    std::mt19937 random(s_seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    
+    for (auto instance = 0u; instance < numEmitted; ++instance)
+    {
+        const auto center = glm::vec3{unit(random), unit(random), unit(random)} * kExtent;
+        const auto yaw = unit(random) * glm::pi<float>();
+        const auto pitch = unit(random) * 0.5f;
+        
+        // the tilt gives each instance its own normal and thereby its own color
+        const auto normal = glm::vec3{std::sin(yaw) * std::cos(pitch), std::sin(pitch), std::cos(yaw) * std::cos(pitch)};
+        const auto tangent = glm::normalize(glm::cross(glm::vec3{0.0f, 1.0f, 0.0f}, normal));
+        const auto bitangent = glm::cross(normal, tangent);
+        
+        for (auto layer = 0u; layer < numLayers; ++layer)
+        {
+            const auto offset = numLayers > 1u ? (static_cast<float>(layer) / (numLayers - 1u) - 0.5f) * kStackDepth * size : 0.0f;
+            const auto origin = center + normal * offset - (tangent + bitangent) * (0.5f * size);
+            const auto firstVertex = static_cast<unsigned int>(vertices.size());
+            
+            for (auto y = 0u; y <= tessellation; ++y)
+            {
+                for (auto x = 0u; x <= tessellation; ++x)
+                {
+                    const auto u = static_cast<float>(x) / tessellation, v = static_cast<float>(y) / tessellation;
+                    vertices.push_back(origin + (tangent * u + bitangent * v) * size);
+                    normals.push_back(normal);
+                }
+            }
+            
+            const auto rowLength = tessellation + 1u;
+            
+            for (auto y = 0u; y < tessellation; ++y)
+            {
+                for (auto x = 0u; x < tessellation; ++x)
+                {
+                    const auto corner = firstVertex + y * rowLength + x;
+                    
+                    indices.insert(indices.end(), { corner, corner + 1u, corner + rowLength + 1u });
+                    indices.insert(indices.end(), { corner, corner + rowLength + 1u, corner + rowLength });
+                }
+            }
+        }
+    }
+    
+    auto geometry = std::unique_ptr<gloperate::PolygonalGeometry>{new gloperate::PolygonalGeometry()};
+    geometry->setVertices(std::move(vertices));
+    geometry->setNormals(std::move(normals));
+    geometry->setIndices(std::move(indices));
+    
+    return geometry;
+}
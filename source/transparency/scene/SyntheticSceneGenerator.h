@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+
+namespace gloperate
+{
+    class PolygonalGeometry;
+}
+
+class SyntheticSceneGenerator
+{
+public:
+    static const auto s_seed = 5489u;
+    static const auto s_maxNumTriangles = 1u << 24;
+
+public:
+    /** Merges numInstances randomly placed stacks of numLayers tessellated quads, drops instances beyond s_maxNumTriangles */
+    static std::unique_ptr<gloperate::PolygonalGeometry> generate(
+        uint16_t numLayers,
+        uint16_t numInstances,
+        uint16_t tessellation,
+        float size);
+};
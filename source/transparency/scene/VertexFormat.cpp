@@ -0,0 +1,198 @@
+#include "VertexFormat.h"
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include <glbinding/gl/boolean.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include <globjects/Buffer.h>
+#include <globjects/VertexArray.h>
+#include <globjects/VertexAttributeBinding.h>
+
+#include "MeshCache.h"
+
+
+using namespace gl;
+
+namespace
+{
+
+struct FloatVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+struct QuantizedVertex
+{
+    uint16_t position[4];
+    uint32_t normal;
+};
+
+static_assert(sizeof(FloatVertex) == 24u, "FloatVertex must not be padded");
+static_assert(sizeof(QuantizedVertex) == 12u, "QuantizedVertex must not be padded");
+
+template <typename Vertex, typename Function>
+std::vector<char> packVertices(const MeshData & mesh, Function convert)
+{
+    auto bytes = std::vector<char>(mesh.numVertices * sizeof(Vertex));
+    auto vertex = Vertex{};
+
+    for (auto i = 0u; i < mesh.numVertices; ++i)
+    {
+        convert(mesh.vertices[i], mesh.normals[i], vertex);
+        std::memcpy(bytes.data() + i * sizeof(Vertex), &vertex, sizeof(Vertex));
+    }
+
+    return bytes;
+}
+
+template <typename Index>
+std::vector<char> packIndices(const MeshData & mesh)
+{
+    const auto numIndices = VertexFormatEncoder::numAllIndices(mesh);
+
+    auto bytes = std::vector<char>(numIndices * sizeof(Index));
+    auto destination = reinterpret_cast<Index *>(bytes.data());
+
+    for (auto i = 0u; i < numIndices; ++i)
+        destination[i] = static_cast<Index>(mesh.indices[i]);
+
+    return bytes;
+}
+
+}
+
+PackedMesh VertexFormatEncoder::pack(const MeshData & mesh, VertexFormat format)
+{
+    auto packed = PackedMesh{};
+    packed.format = format;
+    packed.numIndices = static_cast<GLsizei>(mesh.numIndices);
+    packed.scale = glm::vec3{1.0f};
+    packed.offset = glm::vec3{0.0f};
+
+    auto minimum = glm::vec3{std::numeric_limits<float>::max()};
+    auto maximum = glm::vec3{std::numeric_limits<float>::lowest()};
+
+    for (auto i = 0u; i < mesh.numVertices; ++i)
+    {
+        minimum = glm::min(minimum, mesh.vertices[i]);
+        maximum = glm::max(maximum, mesh.vertices[i]);
+    }
+
+    if (mesh.numVertices == 0u)
+        minimum = maximum = glm::vec3{0.0f};
+
+    packed.center = (minimum + maximum) * 0.5f;
+    packed.radius = glm::length(maximum - minimum) * 0.5f;
+
+    if (format == VertexFormat::Float)
+    {
+        packed.vertices = packVertices<FloatVertex>(mesh, [] (const glm::vec3 & position, const glm::vec3 & normal, FloatVertex & vertex)
+        {
+            vertex.position = position;
+            vertex.normal = normal;
+        });
+    }
+    else
+    {
+        // flat meshes still need a non-zero extent to divide by
+        const auto extent = glm::max(maximum - minimum, glm::vec3{std::numeric_limits<float>::min()});
+
+        packed.scale = extent;
+        packed.offset = minimum;
+
+        packed.vertices = packVertices<QuantizedVertex>(mesh, [&] (const glm::vec3 & position, const glm::vec3 & normal, QuantizedVertex & vertex)
+        {
+            const auto quantized = glm::round(glm::clamp((position - minimum) / extent, 0.0f, 1.0f) * 65535.0f);
+
+            vertex.position[0] = static_cast<uint16_t>(quantized.x);
+            vertex.position[1] = static_cast<uint16_t>(quantized.y);
+            vertex.position[2] = static_cast<uint16_t>(quantized.z);
+            vertex.position[3] = 0u;
+            vertex.normal = packNormal(normal);
+        });
+    }
+
+    // the vertices of a mesh are referenced by index, so 16 bits suffice below 65536 of them
+    if (mesh.numVertices <= std::numeric_limits<uint16_t>::max() + 1u)
+    {
+        packed.indices = packIndices<uint16_t>(mesh);
+        packed.indexType = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        packed.indices = packIndices<uint32_t>(mesh);
+        packed.indexType = GL_UNSIGNED_INT;
+    }
+
+    return packed;
+}
+
+GLsizei VertexFormatEncoder::stride(VertexFormat format)
+{
+    return format == VertexFormat::Float ? sizeof(FloatVertex) : sizeof(QuantizedVertex);
+}
+
+uint32_t VertexFormatEncoder::numAllIndices(const MeshData & mesh)
+{
+    // the coarser levels of detail follow the full detail indices
+    if (mesh.numLods == 0u)
+        return mesh.numIndices;
+
+    const auto & lastLod = mesh.lods[mesh.numLods - 1u];
+    return lastLod.firstIndex + lastLod.numIndices;
+}
+
+void VertexFormatEncoder::setupAttributes(globjects::VertexArray * vao, globjects::Buffer * vertices, VertexFormat format)
+{
+    auto vertexBinding = vao->binding(s_vertexLocation);
+    vertexBinding->setAttribute(s_vertexLocation);
+    vertexBinding->setBuffer(vertices, 0, stride(format));
+
+    auto normalBinding = vao->binding(s_normalLocation);
+    normalBinding->setAttribute(s_normalLocation);
+    normalBinding->setBuffer(vertices, 0, stride(format));
+
+    if (format == VertexFormat::Float)
+    {
+        vertexBinding->setFormat(3, GL_FLOAT, GL_FALSE, offsetof(FloatVertex, position));
+        normalBinding->setFormat(3, GL_FLOAT, GL_TRUE, offsetof(FloatVertex, normal));
+    }
+    else
+    {
+        vertexBinding->setFormat(3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(QuantizedVertex, position));
+        normalBinding->setFormat(4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(QuantizedVertex, normal));
+    }
+
+    vao->enable(s_vertexLocation);
+    vao->enable(s_normalLocation);
+}
+
+void VertexFormatEncoder::setDequantization(const glm::vec3 & scale, const glm::vec3 & offset)
+{
+    glVertexAttrib3f(s_scaleLocation, scale.x, scale.y, scale.z);
+    glVertexAttrib3f(s_offsetLocation, offset.x, offset.y, offset.z);
+}
+
+void VertexFormatEncoder::resetDequantization()
+{
+    setDequantization(glm::vec3{1.0f}, glm::vec3{0.0f});
+}
+
+uint32_t VertexFormatEncoder::packNormal(const glm::vec3 & normal)
+{
+    // signed 10 bit components, x in the lowest bits, w stays 0
+    const auto quantized = glm::round(glm::clamp(normal, -1.0f, 1.0f) * 511.0f);
+
+    const auto x = static_cast<uint32_t>(static_cast<int32_t>(quantized.x)) & 0x3ffu;
+    const auto y = static_cast<uint32_t>(static_cast<int32_t>(quantized.y)) & 0x3ffu;
+    const auto z = static_cast<uint32_t>(static_cast<int32_t>(quantized.z)) & 0x3ffu;
+
+    return x | (y << 10u) | (z << 20u);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <glbinding/gl/types.h>
+
+
+namespace globjects
+{
+    class Buffer;
+    class VertexArray;
+}
+
+struct MeshData;
+
+enum class VertexFormat { Float, Quantized };
+
+/** Interleaved vertices and indices of a single mesh and its levels of detail, packed for upload */
+struct PackedMesh
+{
+    VertexFormat format;
+    std::vector<char> vertices;
+    std::vector<char> indices;
+    gl::GLenum indexType;
+    gl::GLsizei numIndices;
+
+    /** Maps the stored positions back into model space, a_vertex * scale + offset */
+    glm::vec3 scale;
+    glm::vec3 offset;
+
+    /** Bounding sphere in model space */
+    glm::vec3 center;
+    float radius;
+};
+
+class VertexFormatEncoder
+{
+public:
+    static const auto s_vertexLocation = 0u;
+    static const auto s_normalLocation = 1u;
+    static const auto s_scaleLocation = 2u;
+    static const auto s_offsetLocation = 3u;
+
+public:
+    /**
+     *  Float stores 24 byte vertices (position and normal as floats).
+     *  Quantized stores 12 byte vertices, 16 bit unorm positions within the mesh bounds
+     *  and 10:10:10:2 snorm normals. Indices are 16 bit if the mesh has less than 65536 vertices.
+     */
+    static PackedMesh pack(const MeshData & mesh, VertexFormat format);
+
+    static gl::GLsizei stride(VertexFormat format);
+
+    /** Number of indices of the mesh including those of its coarser levels of detail */
+    static uint32_t numAllIndices(const MeshData & mesh);
+
+    /** Binds the interleaved attributes of the format to the vertex array, the buffer holds PackedMesh::vertices */
+    static void setupAttributes(globjects::VertexArray * vao, globjects::Buffer * vertices, VertexFormat format);
+
+    /** Sets the constant dequantization attributes read by the mesh vertex shaders */
+    static void setDequantization(const glm::vec3 & scale, const glm::vec3 & offset);
+    static void resetDequantization();
+
+    static uint32_t packNormal(const glm::vec3 & normal);
+};
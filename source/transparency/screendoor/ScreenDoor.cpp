@@ -11,10 +11,13 @@
 #include <glbinding/gl/bitfield.h>
 
 #include <globjects/globjects.h>
+#include <globjects/base/File.h>
+#include <globjects/base/StringTemplate.h>
 #include <globjects/logging.h>
 #include <globjects/Framebuffer.h>
 #include <globjects/DebugMessage.h>
 #include <globjects/Program.h>
+#include <globjects/Shader.h>
 #include <globjects/Texture.h>
 
 #include <gloperate/base/RenderTargetType.h>
@@ -25,14 +28,20 @@
 #include <gloperate/painter/PerspectiveProjectionCapability.h>
 #include <gloperate/painter/CameraCapability.h>
 #include <gloperate/primitives/AdaptiveGrid.h>
-#include <gloperate/primitives/Scene.h>
-#include <gloperate/primitives/PolygonalDrawable.h>
 #include <gloperate/primitives/PolygonalGeometry.h>
 
 #include <reflectionzeug/PropertyGroup.h>
 
 #include <widgetzeug/make_unique.hpp>
 
+#include "CacheDirectory.h"
+#include "diagnostics/DepthComplexityDiagnostics.h"
+#include "scene/LodSelector.h"
+#include "scene/MeshCache.h"
+#include "scene/MeshDrawable.h"
+#include "scene/SceneOptions.h"
+#include "scene/SyntheticSceneGenerator.h"
+
 
 using namespace gl;
 using namespace glm;
@@ -46,8 +55,14 @@ ScreenDoor::ScreenDoor(gloperate::ResourceManager & resourceManager)
 ,   m_viewportCapability(addCapability(new gloperate::ViewportCapability()))
 ,   m_projectionCapability(addCapability(new gloperate::PerspectiveProjectionCapability(m_viewportCapability)))
 ,   m_cameraCapability(addCapability(new gloperate::CameraCapability()))
+,   m_opaqueLayerValid(false)
+,   m_sceneOptions(new SceneOptions(*this))
+,   m_lodSelector(new LodSelector(*this, m_viewportCapability, m_projectionCapability, m_cameraCapability))
+,   m_diagnostics(new DepthComplexityDiagnostics(*this, m_viewportCapability, m_targetFramebufferCapability))
 ,   m_multisampling(false)
 ,   m_multisamplingChanged(false)
+,   m_sampleMask(false)
+,   m_sampleMaskChanged(false)
 ,   m_transparency(0.5)
 {    
     setupPropertyGroup();
@@ -60,6 +75,9 @@ void ScreenDoor::setupPropertyGroup()
     addProperty<bool>("multisampling", this,
         &ScreenDoor::multisampling, &ScreenDoor::setMultisampling);
     
+    addProperty<bool>("sample_mask", this,
+        &ScreenDoor::sampleMask, &ScreenDoor::setSampleMask);
+    
     addProperty<float>("transparency", this,
         &ScreenDoor::transparency, &ScreenDoor::setTransparency)->setOptions({
         { "minimum", 0.0f },
@@ -77,6 +95,24 @@ void ScreenDoor::setMultisampling(bool b)
 {
     m_multisamplingChanged = m_multisampling != b;
     m_multisampling = b;
+    
+    // the sample mask only selects samples of a multisampled framebuffer
+    if (!b)
+        m_sampleMask = false;
+}
+
+bool ScreenDoor::sampleMask() const
+{
+    return m_sampleMask;
+}
+
+void ScreenDoor::setSampleMask(bool b)
+{
+    m_sampleMaskChanged |= m_sampleMask != b;
+    m_sampleMask = b;
+    
+    if (b && !m_multisampling)
+        setMultisampling(true);
 }
 
 float ScreenDoor::transparency() const
@@ -108,6 +144,8 @@ void ScreenDoor::onInitialize()
     setupProgram();
     setupProjection();
     setupFramebuffer();
+    
+    m_diagnostics->initGL();
 }
 
 void ScreenDoor::onPaint()
@@ -119,6 +157,12 @@ void ScreenDoor::onPaint()
         setupFramebuffer();
     }
     
+    if (m_sampleMaskChanged)
+    {
+        m_sampleMaskChanged = false;
+        setupProgram();
+    }
+    
     if (m_viewportCapability->hasChanged())
     {
         glViewport(
@@ -131,31 +175,47 @@ void ScreenDoor::onPaint()
         
         updateFramebuffer();
     }
-
-    m_fbo->bind(GL_FRAMEBUFFER);
-    m_fbo->clearBuffer(GL_COLOR, 0, glm::vec4{0.85f, 0.87f, 0.91f, 1.0f});
-    m_fbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0.0f);
     
-    glEnable(GL_DEPTH_TEST);
-
+    if (m_cameraCapability->hasChanged())
+    {
+        m_cameraCapability->setChanged(false);
+        m_opaqueLayerValid = false;
+    }
+    
+    if (m_sceneOptions->sceneChanged())
+    {
+        setupDrawable();
+        m_opaqueLayerValid = false;
+    }
+    
     const auto transform = m_projectionCapability->projection() * m_cameraCapability->view();
-    const auto eye = m_cameraCapability->eye();
-
-    m_grid->update(eye, transform);
-    m_grid->draw();
     
-    glEnable(GL_SAMPLE_SHADING);
-    glMinSampleShading(1.0);
+    m_lodSelector->setNumTriangles(m_lodSelector->select(m_transparentDrawables) + m_lodSelector->select(m_opaqueDrawables));
     
-    m_program->use();
-    m_program->setUniform(m_transformLocation, transform);
+    if (m_lodSelector->selectionChanged())
+        m_opaqueLayerValid = false;
+    
+    m_diagnostics->begin();
     
-    for (auto i = 0u; i < m_drawables.size(); ++i)
+    renderOpaqueLayer(transform);
+    
+    glEnable(GL_DEPTH_TEST);
+    
+    const auto sampleShading = !(m_multisampling && m_sampleMask);
+    
+    if (sampleShading)
     {
-        m_program->setUniform(m_transparencyLocation, i % 2 == 0 ? m_transparency : 1.0f);
-        m_drawables[i]->draw();
+        glEnable(GL_SAMPLE_SHADING);
+        glMinSampleShading(1.0);
     }
     
+    m_program->use();
+    m_program->setUniform(m_transformLocation, transform);
+    m_program->setUniform(m_transparencyLocation, m_transparency);
+    
+    for (auto & drawable : m_transparentDrawables)
+        drawable->draw();
+    
     m_program->release();
     
     glDisable(GL_SAMPLE_SHADING);
@@ -180,6 +240,62 @@ void ScreenDoor::onPaint()
     
     m_fbo->blit(GL_COLOR_ATTACHMENT0, rect, targetfbo, drawBuffer, rect,
         GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    
+    const auto drawOpaque = [this, &transform] ()
+    {
+        m_grid->draw();
+        
+        m_program->use();
+        m_program->setUniform(m_transformLocation, transform);
+        m_program->setUniform(m_transparencyLocation, 1.0f);
+        
+        for (auto & drawable : m_opaqueDrawables)
+            drawable->draw();
+        
+        m_program->release();
+    };
+    
+    m_diagnostics->end();
+    m_diagnostics->render(transform, drawOpaque, [this] () { for (auto & drawable : m_transparentDrawables) drawable->draw(); });
+}
+
+void ScreenDoor::renderOpaqueLayer(const glm::mat4 & transform)
+{
+    const auto rect = std::array<gl::GLint, 4>{{ 0, 0, m_viewportCapability->width(), m_viewportCapability->height() }};
+    
+    // the opaque layer does not depend on the transparency, so it is restored as long as camera and viewport are unchanged
+    if (m_opaqueLayerValid)
+    {
+        m_opaqueFbo->blit(GL_COLOR_ATTACHMENT0, rect, m_fbo, GL_COLOR_ATTACHMENT0, rect,
+            GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        
+        m_fbo->bind(GL_FRAMEBUFFER);
+        return;
+    }
+    
+    m_fbo->bind(GL_FRAMEBUFFER);
+    m_fbo->clearBuffer(GL_COLOR, 0, glm::vec4{0.85f, 0.87f, 0.91f, 1.0f});
+    m_fbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0.0f);
+    
+    glEnable(GL_DEPTH_TEST);
+    
+    m_grid->update(m_cameraCapability->eye(), transform);
+    m_grid->draw();
+    
+    m_program->use();
+    m_program->setUniform(m_transformLocation, transform);
+    m_program->setUniform(m_transparencyLocation, 1.0f);
+    
+    for (auto & drawable : m_opaqueDrawables)
+        drawable->draw();
+    
+    m_program->release();
+    
+    m_fbo->blit(GL_COLOR_ATTACHMENT0, rect, m_opaqueFbo, GL_COLOR_ATTACHMENT0, rect,
+        GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    
+    m_fbo->bind(GL_FRAMEBUFFER);
+    m_opaqueLayerValid = true;
 }
 
 void ScreenDoor::setupFramebuffer()
@@ -190,11 +306,17 @@ void ScreenDoor::setupFramebuffer()
         m_colorAttachment->bind(); // workaround
         m_depthAttachment = new Texture(GL_TEXTURE_2D_MULTISAMPLE);
         m_depthAttachment->bind(); // workaround
+        m_opaqueColorAttachment = new Texture(GL_TEXTURE_2D_MULTISAMPLE);
+        m_opaqueColorAttachment->bind(); // workaround
+        m_opaqueDepthAttachment = new Texture(GL_TEXTURE_2D_MULTISAMPLE);
+        m_opaqueDepthAttachment->bind(); // workaround
     }
     else
     {
         m_colorAttachment = Texture::createDefault(GL_TEXTURE_2D);
         m_depthAttachment = Texture::createDefault(GL_TEXTURE_2D);
+        m_opaqueColorAttachment = Texture::createDefault(GL_TEXTURE_2D);
+        m_opaqueDepthAttachment = Texture::createDefault(GL_TEXTURE_2D);
     }
     
     m_fbo = make_ref<Framebuffer>();
@@ -202,9 +324,15 @@ void ScreenDoor::setupFramebuffer()
     m_fbo->attachTexture(GL_COLOR_ATTACHMENT0, m_colorAttachment);
     m_fbo->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
     
+    m_opaqueFbo = make_ref<Framebuffer>();
+    
+    m_opaqueFbo->attachTexture(GL_COLOR_ATTACHMENT0, m_opaqueColorAttachment);
+    m_opaqueFbo->attachTexture(GL_DEPTH_ATTACHMENT, m_opaqueDepthAttachment);
+    
     updateFramebuffer();
     
     m_fbo->printStatus(true);
+    m_opaqueFbo->printStatus(true);
 }
 
 void ScreenDoor::setupProjection()
@@ -220,21 +348,42 @@ void ScreenDoor::setupProjection()
 
 void ScreenDoor::setupDrawable()
 {
-    // Load scene
-    const auto scene = m_resourceManager.load<gloperate::Scene>("data/transparency/transparency_scene.obj");
+    m_transparentDrawables.clear();
+    m_opaqueDrawables.clear();
+    
+    // the synthetic scene is entirely transparent
+    if (m_sceneOptions->source() == SceneSource::Synthetic)
+    {
+        const auto geometry = SyntheticSceneGenerator::generate(
+            m_sceneOptions->syntheticLayers(),
+            m_sceneOptions->syntheticInstances(),
+            m_sceneOptions->syntheticTessellation(),
+            m_sceneOptions->syntheticSize());
+        
+        m_transparentDrawables.push_back(gloperate::make_unique<MeshDrawable>(*geometry));
+        m_sceneOptions->setNumTriangles(static_cast<uint32_t>(geometry->indices().size() / 3u));
+        return;
+    }
+    
+    // Load scene, the cache imports the file only once and maps the stored arrays afterwards
+    const auto scene = MeshCache{CacheDirectory::path()}.load("data/transparency/transparency_scene.obj", m_resourceManager);
     if (!scene)
     {
         std::cout << "Could not load file" << std::endl;
         return;
     }
 
-    // Create a renderable for each mesh
-    for (const auto * geometry : scene->meshes()) {
-        m_drawables.push_back(gloperate::make_unique<gloperate::PolygonalDrawable>(*geometry));
+    auto numTriangles = 0u;
+
+    // Create a renderable for each mesh, the meshes of the file alternate between transparent and opaque
+    for (auto i = 0u; i < scene->meshes().size(); ++i) {
+        const auto & mesh = scene->meshes()[i];
+        auto & drawables = i % 2 == 0 ? m_transparentDrawables : m_opaqueDrawables;
+        drawables.push_back(gloperate::make_unique<MeshDrawable>(mesh));
+        numTriangles += mesh.numIndices / 3u;
     }
 
-    // Release scene
-    delete scene;
+    m_sceneOptions->setNumTriangles(numTriangles);
 }
 
 void ScreenDoor::setupProgram()
@@ -245,10 +394,13 @@ void ScreenDoor::setupProgram()
     const auto vertexShader = shaderPath + shaderName + ".vert";
     const auto fragmentShader = shaderPath + shaderName + ".frag";
     
+    const auto fragmentShaderSource = new StringTemplate(new File(fragmentShader));
+    fragmentShaderSource->replace("SAMPLE_MASK", m_sampleMask ? "1" : "0");
+    
     m_program = make_ref<Program>();
     m_program->attach(
         Shader::fromFile(GL_VERTEX_SHADER, vertexShader),
-        Shader::fromFile(GL_FRAGMENT_SHADER, fragmentShader));
+        new Shader(GL_FRAGMENT_SHADER, fragmentShaderSource));
     
     m_transformLocation = m_program->getUniformLocation("transform");
     m_transparencyLocation = m_program->getUniformLocation("transparency");
@@ -263,10 +415,16 @@ void ScreenDoor::updateFramebuffer()
     {
         m_colorAttachment->image2DMultisample(numSamples, GL_RGBA8, width, height, GL_TRUE);
         m_depthAttachment->image2DMultisample(numSamples, GL_DEPTH_COMPONENT, width, height, GL_TRUE);
+        m_opaqueColorAttachment->image2DMultisample(numSamples, GL_RGBA8, width, height, GL_TRUE);
+        m_opaqueDepthAttachment->image2DMultisample(numSamples, GL_DEPTH_COMPONENT, width, height, GL_TRUE);
     }
     else
     {
         m_colorAttachment->image2D(0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
         m_depthAttachment->image2D(0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
+        m_opaqueColorAttachment->image2D(0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        m_opaqueDepthAttachment->image2D(0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
     }
+    
+    m_opaqueLayerValid = false;
 }
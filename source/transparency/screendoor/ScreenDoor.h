@@ -6,6 +6,8 @@
 
 #include <glbinding/gl/types.h>
 
+#include <glm/fwd.hpp>
+
 #include <globjects/base/ref_ptr.h>
 
 #include <gloperate/painter/Painter.h>
@@ -26,9 +28,13 @@ namespace gloperate
     class AbstractViewportCapability;
     class AbstractPerspectiveProjectionCapability;
     class AbstractCameraCapability;
-    class PolygonalDrawable;
 }
 
+class DepthComplexityDiagnostics;
+class LodSelector;
+class MeshDrawable;
+class SceneOptions;
+
 
 class ScreenDoor : public gloperate::Painter
 {
@@ -42,6 +48,9 @@ public:
     bool multisampling() const;
     void setMultisampling(bool b);
     
+    bool sampleMask() const;
+    void setSampleMask(bool b);
+    
     float transparency() const;
     void setTransparency(float transparency);
     
@@ -55,6 +64,7 @@ protected:
     void setupDrawable();
     void setupProgram();
     void updateFramebuffer();
+    void renderOpaqueLayer(const glm::mat4 & transform);
 
 protected:
     /* capabilities */
@@ -68,13 +78,24 @@ protected:
     globjects::ref_ptr<globjects::Texture> m_colorAttachment;
     globjects::ref_ptr<globjects::Texture> m_depthAttachment;
     
+    globjects::ref_ptr<globjects::Framebuffer> m_opaqueFbo;
+    globjects::ref_ptr<globjects::Texture> m_opaqueColorAttachment;
+    globjects::ref_ptr<globjects::Texture> m_opaqueDepthAttachment;
+    bool m_opaqueLayerValid;
+    
     globjects::ref_ptr<gloperate::AdaptiveGrid> m_grid;
     globjects::ref_ptr<globjects::Program> m_program;
     gl::GLint m_transformLocation;
     gl::GLint m_transparencyLocation;
-    std::vector<std::unique_ptr<gloperate::PolygonalDrawable>> m_drawables;
+    std::vector<std::unique_ptr<MeshDrawable>> m_transparentDrawables;
+    std::vector<std::unique_ptr<MeshDrawable>> m_opaqueDrawables;
+    std::unique_ptr<SceneOptions> m_sceneOptions;
+    std::unique_ptr<LodSelector> m_lodSelector;
+    std::unique_ptr<DepthComplexityDiagnostics> m_diagnostics;
 
     bool m_multisampling;
     bool m_multisamplingChanged;
+    bool m_sampleMask;
+    bool m_sampleMaskChanged;
     float m_transparency;
 };
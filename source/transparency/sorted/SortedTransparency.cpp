@@ -0,0 +1,389 @@
+#include "SortedTransparency.h"
+
+#include <chrono>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <glbinding/gl/boolean.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/bitfield.h>
+
+#include <globjects/globjects.h>
+#include <globjects/logging.h>
+#include <globjects/Buffer.h>
+#include <globjects/Framebuffer.h>
+#include <globjects/DebugMessage.h>
+#include <globjects/Program.h>
+#include <globjects/Shader.h>
+#include <globjects/Texture.h>
+#include <globjects/VertexArray.h>
+#include <globjects/VertexAttributeBinding.h>
+
+#include <gloperate/base/make_unique.hpp>
+#include <gloperate/resources/ResourceManager.h>
+#include <gloperate/painter/TargetFramebufferCapability.h>
+#include <gloperate/painter/ViewportCapability.h>
+#include <gloperate/painter/PerspectiveProjectionCapability.h>
+#include <gloperate/painter/CameraCapability.h>
+#include <gloperate/primitives/AdaptiveGrid.h>
+#include <gloperate/primitives/PolygonalGeometry.h>
+
+#include <reflectionzeug/PropertyGroup.h>
+
+#include "CacheDirectory.h"
+#include "TriangleSorter.h"
+#include "diagnostics/DepthComplexityDiagnostics.h"
+#include "scene/MeshCache.h"
+#include "scene/VertexFormat.h"
+
+
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+SortedTransparency::SortedTransparency(gloperate::ResourceManager & resourceManager)
+:   Painter(resourceManager)
+,   m_targetFramebufferCapability(addCapability(new gloperate::TargetFramebufferCapability()))
+,   m_viewportCapability(addCapability(new gloperate::ViewportCapability()))
+,   m_projectionCapability(addCapability(new gloperate::PerspectiveProjectionCapability(m_viewportCapability)))
+,   m_cameraCapability(addCapability(new gloperate::CameraCapability()))
+,   m_sorted(false)
+,   m_transparency(160u)
+,   m_backFaceCulling(false)
+,   m_numTriangles(0u)
+,   m_sortTime(0.0f)
+,   m_diagnostics(new DepthComplexityDiagnostics(*this, m_viewportCapability, m_targetFramebufferCapability))
+{
+    setupPropertyGroup();
+}
+
+SortedTransparency::~SortedTransparency() = default;
+
+void SortedTransparency::setupPropertyGroup()
+{
+    addProperty<unsigned char>("transparency", this,
+        &SortedTransparency::transparency, &SortedTransparency::setTransparency)->setOptions({
+        { "minimum", 0 },
+        { "maximum", 255 },
+        { "step", 1 }});
+    
+    addProperty<bool>("back_face_culling", this,
+        &SortedTransparency::backFaceCulling, &SortedTransparency::setBackFaceCulling);
+    
+    addProperty<const unsigned int>("num_triangles", this,
+        &SortedTransparency::numTriangles);
+    
+    addProperty<const float>("sort_time_ms", this,
+        &SortedTransparency::sortTime)->setOptions({
+        { "precision", 3u }});
+}
+
+unsigned char SortedTransparency::transparency() const
+{
+    return m_transparency;
+}
+
+void SortedTransparency::setTransparency(unsigned char transparency)
+{
+    m_transparency = transparency;
+}
+
+bool SortedTransparency::backFaceCulling() const
+{
+    return m_backFaceCulling;
+}
+
+void SortedTransparency::setBackFaceCulling(bool b)
+{
+    m_backFaceCulling = b;
+}
+
+unsigned int SortedTransparency::numTriangles() const
+{
+    return m_numTriangles;
+}
+
+void SortedTransparency::setNumTriangles(unsigned int numTriangles)
+{
+    m_numTriangles = numTriangles;
+}
+
+float SortedTransparency::sortTime() const
+{
+    return m_sortTime;
+}
+
+void SortedTransparency::setSortTime(float milliseconds)
+{
+    m_sortTime = milliseconds;
+}
+
+void SortedTransparency::onInitialize()
+{
+    globjects::init();
+    globjects::DebugMessage::enable();
+
+#ifdef __APPLE__
+    Shader::clearGlobalReplacements();
+    Shader::globalReplace("#version 140", "#version 150");
+
+    debug() << "Using global OS X shader replacement '#version 140' -> '#version 150'" << std::endl;
+#endif
+
+    m_grid = make_ref<gloperate::AdaptiveGrid>();
+    m_grid->setColor({0.6f, 0.6f, 0.6f});
+    
+    setupPrograms();
+    setupProjection();
+    setupFramebuffer();
+    setupGeometry();
+    
+    m_diagnostics->initGL();
+}
+
+void SortedTransparency::onPaint()
+{
+    if (m_viewportCapability->hasChanged())
+    {
+        glViewport(
+            m_viewportCapability->x(),
+            m_viewportCapability->y(),
+            m_viewportCapability->width(),
+            m_viewportCapability->height());
+
+        m_viewportCapability->setChanged(false);
+        
+        updateFramebuffer();
+    }
+    
+    const auto view = m_cameraCapability->view();
+    const auto transform = m_projectionCapability->projection() * view;
+    
+    m_grid->update(m_cameraCapability->eye(), transform);
+    
+    m_program->setUniform("transform", transform);
+    m_program->setUniform("transparency", static_cast<unsigned int>(m_transparency));
+    
+    sortTransparentGeometry(view);
+    
+    m_diagnostics->begin();
+    
+    clearBuffers();
+    renderOpaqueGeometry();
+    renderTransparentGeometry();
+    blit();
+    
+    m_diagnostics->end();
+    m_diagnostics->render(transform, [this] () { m_grid->draw(); }, [this] () { drawTriangles(); });
+    
+    Framebuffer::unbind(GL_FRAMEBUFFER);
+}
+
+void SortedTransparency::setupFramebuffer()
+{
+    m_colorAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    m_depthAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    
+    m_fbo = make_ref<Framebuffer>();
+    
+    m_fbo->attachTexture(GL_COLOR_ATTACHMENT0, m_colorAttachment);
+    m_fbo->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
+    
+    updateFramebuffer();
+    
+    m_fbo->printStatus(true);
+}
+
+void SortedTransparency::setupProjection()
+{
+    static const auto zNear = 0.3f, zFar = 30.f, fovy = 50.f;
+
+    m_projectionCapability->setZNear(zNear);
+    m_projectionCapability->setZFar(zFar);
+    m_projectionCapability->setFovy(radians(fovy));
+
+    m_grid->setNearFar(zNear, zFar);
+}
+
+void SortedTransparency::setupPrograms()
+{
+    static const auto shaderPath = std::string{"data/transparency/"};
+    
+    m_program = make_ref<Program>();
+    m_program->attach(
+        Shader::fromFile(GL_VERTEX_SHADER, shaderPath + "transparent_colors.vert"),
+        Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + "transparent_colors.frag"));
+}
+
+void SortedTransparency::setupGeometry()
+{
+    // Load scene, the cache imports the file only once and maps the stored arrays afterwards
+    const auto scene = MeshCache{CacheDirectory::path()}.load("data/transparency/transparency_scene.obj", m_resourceManager);
+    if (!scene)
+    {
+        std::cout << "Could not load file" << std::endl;
+        return;
+    }
+
+    // Merge meshes
+    auto vertices = std::vector<glm::vec3>{};
+    auto normals = std::vector<glm::vec3>{};
+    auto indices = std::vector<unsigned int>{};
+    
+    for (const auto & mesh : scene->meshes())
+    {
+        const auto baseVertex = static_cast<unsigned int>(vertices.size());
+        
+        for (auto i = 0u; i < mesh.numIndices; ++i)
+            indices.push_back(baseVertex + mesh.indices[i]);
+        
+        vertices.insert(vertices.end(), mesh.vertices, mesh.vertices + mesh.numVertices);
+        normals.insert(normals.end(), mesh.normals, mesh.normals + mesh.numVertices);
+    }
+    
+    m_sorter = gloperate::make_unique<TriangleSorter>(vertices, indices);
+    setNumTriangles(m_sorter->numTriangles());
+    
+    m_vertices = make_ref<Buffer>();
+    m_vertices->setData(vertices, GL_STATIC_DRAW);
+    
+    m_normals = make_ref<Buffer>();
+    m_normals->setData(normals, GL_STATIC_DRAW);
+    
+    m_indices = make_ref<Buffer>();
+    m_indices->setData(m_sorter->sortedIndices(), GL_STREAM_DRAW);
+    
+    m_vao = make_ref<VertexArray>();
+    m_vao->bind();
+    
+    m_indices->bind(GL_ELEMENT_ARRAY_BUFFER);
+    
+    auto vertexBinding = m_vao->binding(0);
+    vertexBinding->setAttribute(0);
+    vertexBinding->setBuffer(m_vertices, 0, sizeof(glm::vec3));
+    vertexBinding->setFormat(3, GL_FLOAT);
+    m_vao->enable(0);
+    
+    auto normalBinding = m_vao->binding(1);
+    normalBinding->setAttribute(1);
+    normalBinding->setBuffer(m_normals, 0, sizeof(glm::vec3));
+    normalBinding->setFormat(3, GL_FLOAT, GL_TRUE);
+    m_vao->enable(1);
+    
+    m_vao->unbind();
+}
+
+void SortedTransparency::updateFramebuffer()
+{
+    const auto width = m_viewportCapability->width(), height = m_viewportCapability->height();
+    
+    m_colorAttachment->image2D(0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    m_depthAttachment->image2D(0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
+}
+
+void SortedTransparency::clearBuffers()
+{
+    m_fbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+    
+    m_fbo->clearBuffer(GL_COLOR, 0, glm::vec4(0.85f, 0.87f, 0.91f, 1.0f));
+    m_fbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+}
+
+void SortedTransparency::renderOpaqueGeometry()
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+
+    m_fbo->bind(GL_FRAMEBUFFER);
+    m_fbo->setDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+    m_grid->draw();
+}
+
+void SortedTransparency::sortTransparentGeometry(const glm::mat4 & view)
+{
+    if (!m_sorter)
+        return;
+    
+    // the order only depends on the view, so an unchanged camera needs neither sort nor upload
+    if (m_sorted && view == m_sortedView)
+        return;
+    
+    const auto start = std::chrono::high_resolution_clock::now();
+    
+    m_sorter->sort(view);
+    
+    const auto end = std::chrono::high_resolution_clock::now();
+    setSortTime(std::chrono::duration<float, std::milli>(end - start).count());
+    
+    // respecifying the whole store lets the driver orphan the buffer still in use by the last frame
+    m_indices->setData(m_sorter->sortedIndices(), GL_STREAM_DRAW);
+    
+    m_sortedView = view;
+    m_sorted = true;
+}
+
+void SortedTransparency::renderTransparentGeometry()
+{
+    if (!m_vao)
+        return;
+    
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    
+    if (m_backFaceCulling)
+        glEnable(GL_CULL_FACE);
+    
+    // colors are premultiplied by the shader
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    
+    m_fbo->bind(GL_FRAMEBUFFER);
+    
+    m_program->use();
+    
+    drawTriangles();
+    
+    m_program->release();
+    
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+}
+
+void SortedTransparency::drawTriangles()
+{
+    if (!m_vao)
+        return;
+    
+    // the sorted arrays are plain floats
+    VertexFormatEncoder::resetDequantization();
+    
+    m_vao->bind();
+    m_vao->drawElements(GL_TRIANGLES, static_cast<GLsizei>(m_sorter->numTriangles() * 3u), GL_UNSIGNED_INT, nullptr);
+    m_vao->unbind();
+}
+
+void SortedTransparency::blit()
+{
+    auto targetfbo = m_targetFramebufferCapability->framebuffer();
+    auto drawBuffer = GL_COLOR_ATTACHMENT0;
+    
+    if (!targetfbo)
+    {
+        targetfbo = Framebuffer::defaultFBO();
+        drawBuffer = GL_BACK_LEFT;
+    }
+    
+    const auto rect = std::array<GLint, 4>{{
+        m_viewportCapability->x(),
+        m_viewportCapability->y(),
+        m_viewportCapability->width(),
+        m_viewportCapability->height()
+    }};
+    
+    m_fbo->blit(GL_COLOR_ATTACHMENT0, rect, targetfbo, drawBuffer, rect,
+        GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
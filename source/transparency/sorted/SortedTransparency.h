@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <glbinding/gl/types.h>
+
+#include <globjects/base/ref_ptr.h>
+
+#include <gloperate/painter/Painter.h>
+
+
+namespace globjects
+{
+    class Buffer;
+    class Framebuffer;
+    class Program;
+    class Texture;
+    class VertexArray;
+}
+
+namespace gloperate
+{
+    class AdaptiveGrid;
+    class ResourceManager;
+    class AbstractTargetFramebufferCapability;
+    class AbstractViewportCapability;
+    class AbstractPerspectiveProjectionCapability;
+    class AbstractCameraCapability;
+}
+
+class DepthComplexityDiagnostics;
+class TriangleSorter;
+
+class SortedTransparency : public gloperate::Painter
+{
+public:
+    SortedTransparency(gloperate::ResourceManager & resourceManager);
+    virtual ~SortedTransparency() override;
+    
+public:
+    void setupPropertyGroup();
+    
+    unsigned char transparency() const;
+    void setTransparency(unsigned char transparency);
+    
+    bool backFaceCulling() const;
+    void setBackFaceCulling(bool b);
+    
+    unsigned int numTriangles() const;
+    void setNumTriangles(unsigned int numTriangles);
+    
+    float sortTime() const;
+    void setSortTime(float milliseconds);
+    
+protected:
+    virtual void onInitialize() override;
+    virtual void onPaint() override;
+
+protected:
+    void setupFramebuffer();
+    void setupProjection();
+    void setupPrograms();
+    void setupGeometry();
+    void updateFramebuffer();
+    
+protected:
+    void clearBuffers();
+    void renderOpaqueGeometry();
+    void sortTransparentGeometry(const glm::mat4 & view);
+    void renderTransparentGeometry();
+    void drawTriangles();
+    void blit();
+
+private:
+    /** \name Capabilities */
+    /** \{ */
+    
+    gloperate::AbstractTargetFramebufferCapability * m_targetFramebufferCapability;
+    gloperate::AbstractViewportCapability * m_viewportCapability;
+    gloperate::AbstractPerspectiveProjectionCapability * m_projectionCapability;
+    gloperate::AbstractCameraCapability * m_cameraCapability;
+    
+    /** \} */
+
+    /** \name Framebuffers and Textures */
+    /** \{ */
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_fbo;
+    globjects::ref_ptr<globjects::Texture> m_colorAttachment;
+    globjects::ref_ptr<globjects::Texture> m_depthAttachment;
+    
+    /** \} */
+    
+    /** \name Programs */
+    /** \{ */
+    
+    globjects::ref_ptr<globjects::Program> m_program;
+    
+    /** \} */
+    
+    /** \name Geometry */
+    /** \{ */
+    
+    globjects::ref_ptr<gloperate::AdaptiveGrid> m_grid;
+    
+    // all meshes are merged, so triangles are sorted across mesh boundaries
+    globjects::ref_ptr<globjects::VertexArray> m_vao;
+    globjects::ref_ptr<globjects::Buffer> m_vertices;
+    globjects::ref_ptr<globjects::Buffer> m_normals;
+    globjects::ref_ptr<globjects::Buffer> m_indices;
+    
+    std::unique_ptr<TriangleSorter> m_sorter;
+    glm::mat4 m_sortedView;
+    bool m_sorted;
+    
+    /** \} */
+
+    /** \name Properties */
+    /** \{ */
+    
+    unsigned char m_transparency;
+    bool m_backFaceCulling;
+    unsigned int m_numTriangles;
+    float m_sortTime;
+    std::unique_ptr<DepthComplexityDiagnostics> m_diagnostics;
+    
+    /** \} */
+};
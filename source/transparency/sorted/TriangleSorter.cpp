@@ -0,0 +1,298 @@
+#include "TriangleSorter.h"
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRIANGLE_SORTER_SSE2
+#endif
+
+
+namespace
+{
+
+const auto kRadixBits = 8u;
+const auto kNumBuckets = 1u << kRadixBits;
+
+// below this, handing a chunk to a worker costs more than it saves
+const auto kMinItemsPerChunk = 16384u;
+
+using histogram_t = std::array<uint32_t, kNumBuckets>;
+
+// maps the float ordering onto the unsigned integer ordering
+uint32_t sortableKey(float value)
+{
+    auto bits = uint32_t{};
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const auto mask = static_cast<uint32_t>(-static_cast<int32_t>(bits >> 31u)) | 0x80000000u;
+    return bits ^ mask;
+}
+
+unsigned int numChunks(unsigned int numItems, unsigned int numThreads)
+{
+    const auto maxChunks = std::max((numItems + kMinItemsPerChunk - 1u) / kMinItemsPerChunk, 1u);
+    return std::min(numThreads, maxChunks);
+}
+
+}
+
+TriangleSorter::TriangleSorter(
+    const std::vector<glm::vec3> & vertices,
+    const std::vector<unsigned int> & indices,
+    unsigned int numThreads)
+:   m_numTriangles{static_cast<unsigned int>(indices.size() / 3u)}
+,   m_numThreads{numThreads > 0u ? numThreads : std::max(std::thread::hardware_concurrency(), 1u)}
+,   m_indices(indices.begin(), indices.begin() + m_numTriangles * 3u)
+,   m_centroidsX(m_numTriangles)
+,   m_centroidsY(m_numTriangles)
+,   m_centroidsZ(m_numTriangles)
+,   m_keys(m_numTriangles)
+,   m_keysBuffer(m_numTriangles)
+,   m_triangles(m_numTriangles)
+,   m_trianglesBuffer(m_numTriangles)
+,   m_sortedIndices(m_indices)
+,   m_jobItems{0u}
+,   m_jobItemsPerChunk{0u}
+,   m_jobChunks{0u}
+,   m_jobGeneration{0u}
+,   m_pendingChunks{0u}
+,   m_stopWorkers{false}
+{
+    for (auto i = 0u; i < m_numTriangles; ++i)
+    {
+        const auto centroid = (vertices.at(m_indices[i * 3u])
+            + vertices.at(m_indices[i * 3u + 1u])
+            + vertices.at(m_indices[i * 3u + 2u])) / 3.0f;
+
+        m_centroidsX[i] = centroid.x;
+        m_centroidsY[i] = centroid.y;
+        m_centroidsZ[i] = centroid.z;
+    }
+
+    // the calling thread always takes the first chunk
+    const auto numWorkers = numChunks(m_numTriangles, m_numThreads) - 1u;
+
+    m_workers.reserve(numWorkers);
+    for (auto chunk = 1u; chunk <= numWorkers; ++chunk)
+        m_workers.emplace_back(&TriangleSorter::runWorker, this, chunk);
+}
+
+TriangleSorter::~TriangleSorter()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_jobMutex};
+        m_stopWorkers = true;
+    }
+
+    m_jobStarted.notify_all();
+
+    for (auto & worker : m_workers)
+        worker.join();
+}
+
+unsigned int TriangleSorter::numTriangles() const
+{
+    return m_numTriangles;
+}
+
+unsigned int TriangleSorter::numThreads() const
+{
+    return m_numThreads;
+}
+
+const std::vector<unsigned int> & TriangleSorter::sortedIndices() const
+{
+    return m_sortedIndices;
+}
+
+void TriangleSorter::parallelFor(unsigned int numItems, const Job & job)
+{
+    const auto chunks = std::min(numChunks(numItems, m_numThreads), static_cast<unsigned int>(m_workers.size()) + 1u);
+    const auto itemsPerChunk = (numItems + chunks - 1u) / chunks;
+
+    if (chunks == 1u)
+    {
+        job(0u, 0u, numItems);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{m_jobMutex};
+        m_job = job;
+        m_jobItems = numItems;
+        m_jobItemsPerChunk = itemsPerChunk;
+        m_jobChunks = chunks;
+        m_pendingChunks = chunks - 1u;
+        ++m_jobGeneration;
+    }
+
+    m_jobStarted.notify_all();
+
+    job(0u, 0u, std::min(itemsPerChunk, numItems));
+
+    std::unique_lock<std::mutex> lock{m_jobMutex};
+    m_jobFinished.wait(lock, [this] { return m_pendingChunks == 0u; });
+}
+
+void TriangleSorter::runWorker(unsigned int chunk)
+{
+    auto generation = 0u;
+
+    std::unique_lock<std::mutex> lock{m_jobMutex};
+
+    while (true)
+    {
+        m_jobStarted.wait(lock, [this, &generation] { return m_stopWorkers || m_jobGeneration != generation; });
+
+        if (m_stopWorkers)
+            return;
+
+        generation = m_jobGeneration;
+
+        // workers past the chunk count sit this job out, parallelFor does not wait for them
+        if (chunk >= m_jobChunks)
+            continue;
+
+        const auto begin = std::min(chunk * m_jobItemsPerChunk, m_jobItems);
+        const auto end = std::min(begin + m_jobItemsPerChunk, m_jobItems);
+
+        // the job stays untouched until every chunk reported back
+        lock.unlock();
+        m_job(chunk, begin, end);
+        lock.lock();
+
+        if (--m_pendingChunks == 0u)
+            m_jobFinished.notify_one();
+    }
+}
+
+void TriangleSorter::sort(const glm::mat4 & view)
+{
+    // view space depth of the centroid, the farthest triangle has the smallest value
+    const auto viewRow = glm::vec4{view[0][2], view[1][2], view[2][2], view[3][2]};
+
+    parallelFor(m_numTriangles, [this, &viewRow](unsigned int, unsigned int begin, unsigned int end)
+    {
+        computeKeys(viewRow, begin, end);
+    });
+
+    radixSort();
+
+    parallelFor(m_numTriangles, [this](unsigned int, unsigned int begin, unsigned int end)
+    {
+        gatherIndices(begin, end);
+    });
+}
+
+void TriangleSorter::computeKeys(const glm::vec4 & viewRow, unsigned int begin, unsigned int end)
+{
+    std::iota(m_triangles.begin() + begin, m_triangles.begin() + end, begin);
+
+    auto i = begin;
+
+#ifdef TRIANGLE_SORTER_SSE2
+    const auto rowX = _mm_set1_ps(viewRow.x);
+    const auto rowY = _mm_set1_ps(viewRow.y);
+    const auto rowZ = _mm_set1_ps(viewRow.z);
+    const auto rowW = _mm_set1_ps(viewRow.w);
+    const auto signBit = _mm_set1_epi32(static_cast<int>(0x80000000u));
+
+    for (; i + 4u <= end; i += 4u)
+    {
+        const auto x = _mm_mul_ps(rowX, _mm_loadu_ps(&m_centroidsX[i]));
+        const auto y = _mm_mul_ps(rowY, _mm_loadu_ps(&m_centroidsY[i]));
+        const auto z = _mm_mul_ps(rowZ, _mm_loadu_ps(&m_centroidsZ[i]));
+        const auto depth = _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, rowW));
+
+        // same mapping as sortableKey, the arithmetic shift replicates the sign bit
+        const auto bits = _mm_castps_si128(depth);
+        const auto mask = _mm_or_si128(_mm_srai_epi32(bits, 31), signBit);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&m_keys[i]), _mm_xor_si128(bits, mask));
+    }
+#endif
+
+    for (; i < end; ++i)
+    {
+        const auto depth = viewRow.x * m_centroidsX[i] + viewRow.y * m_centroidsY[i]
+            + (viewRow.z * m_centroidsZ[i] + viewRow.w);
+
+        m_keys[i] = sortableKey(depth);
+    }
+}
+
+void TriangleSorter::radixSort()
+{
+    const auto chunks = numChunks(m_numTriangles, m_numThreads);
+    auto histograms = std::vector<histogram_t>(chunks);
+
+    for (auto shift = 0u; shift < 32u; shift += kRadixBits)
+    {
+        parallelFor(m_numTriangles, [this, shift, &histograms](unsigned int chunk, unsigned int begin, unsigned int end)
+        {
+            auto & histogram = histograms[chunk];
+            histogram.fill(0u);
+
+            for (auto i = begin; i < end; ++i)
+                ++histogram[(m_keys[i] >> shift) & (kNumBuckets - 1u)];
+        });
+
+        // turn the counts into scatter offsets, chunks keep their order within a bucket to stay stable
+        auto offset = uint32_t{0u};
+        auto skip = false;
+
+        for (auto bucket = 0u; bucket < kNumBuckets; ++bucket)
+        {
+            auto bucketSize = uint32_t{0u};
+
+            for (auto & histogram : histograms)
+            {
+                const auto count = histogram[bucket];
+                histogram[bucket] = offset + bucketSize;
+                bucketSize += count;
+            }
+
+            skip |= bucketSize == m_numTriangles;
+            offset += bucketSize;
+        }
+
+        // all keys share this digit, the pass would not change the order
+        if (skip)
+            continue;
+
+        parallelFor(m_numTriangles, [this, shift, &histograms](unsigned int chunk, unsigned int begin, unsigned int end)
+        {
+            auto & offsets = histograms[chunk];
+
+            for (auto i = begin; i < end; ++i)
+            {
+                const auto destination = offsets[(m_keys[i] >> shift) & (kNumBuckets - 1u)]++;
+
+                m_keysBuffer[destination] = m_keys[i];
+                m_trianglesBuffer[destination] = m_triangles[i];
+            }
+        });
+
+        std::swap(m_keys, m_keysBuffer);
+        std::swap(m_triangles, m_trianglesBuffer);
+    }
+}
+
+void TriangleSorter::gatherIndices(unsigned int begin, unsigned int end)
+{
+    for (auto i = begin; i < end; ++i)
+    {
+        const auto triangle = m_triangles[i];
+
+        m_sortedIndices[i * 3u] = m_indices[triangle * 3u];
+        m_sortedIndices[i * 3u + 1u] = m_indices[triangle * 3u + 1u];
+        m_sortedIndices[i * 3u + 2u] = m_indices[triangle * 3u + 2u];
+    }
+}
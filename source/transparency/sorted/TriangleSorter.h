@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/fwd.hpp>
+
+
+class TriangleSorter
+{
+public:
+    TriangleSorter(
+        const std::vector<glm::vec3> & vertices,
+        const std::vector<unsigned int> & indices,
+        unsigned int numThreads = 0u);
+    ~TriangleSorter();
+
+    unsigned int numTriangles() const;
+    unsigned int numThreads() const;
+
+    // sorts back to front with respect to the view, sortedIndices() is valid afterwards
+    void sort(const glm::mat4 & view);
+
+    const std::vector<unsigned int> & sortedIndices() const;
+
+protected:
+    using Job = std::function<void(unsigned int chunk, unsigned int begin, unsigned int end)>;
+
+    void computeKeys(const glm::vec4 & viewRow, unsigned int begin, unsigned int end);
+    void radixSort();
+    void gatherIndices(unsigned int begin, unsigned int end);
+
+    // runs the first chunk on the calling thread and the others on the workers
+    void parallelFor(unsigned int numItems, const Job & job);
+    void runWorker(unsigned int chunk);
+
+private:
+    const unsigned int m_numTriangles;
+    const unsigned int m_numThreads;
+
+    std::vector<unsigned int> m_indices;
+
+    // triangle centroids as structure of arrays for the vectorized key computation
+    std::vector<float> m_centroidsX;
+    std::vector<float> m_centroidsY;
+    std::vector<float> m_centroidsZ;
+
+    std::vector<uint32_t> m_keys;
+    std::vector<uint32_t> m_keysBuffer;
+    std::vector<uint32_t> m_triangles;
+    std::vector<uint32_t> m_trianglesBuffer;
+
+    std::vector<unsigned int> m_sortedIndices;
+
+    // persistent workers, sort() runs about ten parallel passes per frame
+    std::vector<std::thread> m_workers;
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobStarted;
+    std::condition_variable m_jobFinished;
+    Job m_job;
+    unsigned int m_jobItems;
+    unsigned int m_jobItemsPerChunk;
+    unsigned int m_jobChunks;
+    unsigned int m_jobGeneration;
+    unsigned int m_pendingChunks;
+    bool m_stopWorkers;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+
+// tables precomputed at build time for the common sample counts, defined in the generated EmbeddedMasksTables.cpp
+struct EmbeddedMasksTable
+{
+    uint32_t numSamples;
+    uint32_t seed;
+    uint32_t version;
+    const uint8_t * masks;
+};
+
+extern const EmbeddedMasksTable kEmbeddedMasksTables[];
+extern const unsigned int kNumEmbeddedMasksTables;
@@ -0,0 +1,200 @@
+#include "MasksTableCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <globjects/logging.h>
+
+#include <widgetzeug/make_unique.hpp>
+
+#include "CacheDirectory.h"
+#include "EmbeddedMasksTables.h"
+
+
+using widgetzeug::make_unique;
+
+namespace
+{
+
+struct MasksTableHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t numSamples;
+    uint32_t seed;
+    uint32_t alphaRes;
+    uint32_t numMasks;
+};
+
+const char kMagic[4] = { 'S', 'T', 'M', 'T' };
+
+MasksTableHeader makeHeader(unsigned int numSamples, uint32_t seed)
+{
+    auto header = MasksTableHeader{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = MasksTableGenerator::s_version;
+    header.numSamples = numSamples;
+    header.seed = seed;
+    header.alphaRes = MasksTableGenerator::s_alphaRes;
+    header.numMasks = MasksTableGenerator::s_numMasks;
+    return header;
+}
+
+bool matches(const MasksTableHeader & lhs, const MasksTableHeader & rhs)
+{
+    return std::memcmp(&lhs, &rhs, sizeof(MasksTableHeader)) == 0;
+}
+
+}
+
+MasksTableCache::MasksTableCache(const std::string & directory)
+:   m_directory{directory}
+{
+}
+
+MasksTableCache::~MasksTableCache() = default;
+
+auto MasksTableCache::load(unsigned int numSamples, uint32_t seed) const -> std::unique_ptr<maskDistributions_t>
+{
+    auto table = loadEmbedded(numSamples, seed);
+
+    if (table)
+        return table;
+
+    table = loadFile(numSamples, seed);
+
+    if (table)
+        return table;
+
+    table = MasksTableGenerator::generateDistributions(numSamples, seed);
+    storeFile(numSamples, seed, *table);
+
+    return table;
+}
+
+auto MasksTableCache::loadEmbedded(unsigned int numSamples, uint32_t seed) const -> std::unique_ptr<maskDistributions_t>
+{
+    for (auto i = 0u; i < kNumEmbeddedMasksTables; ++i)
+    {
+        const auto & embedded = kEmbeddedMasksTables[i];
+
+        if (embedded.numSamples != numSamples || embedded.seed != seed || embedded.version != MasksTableGenerator::s_version)
+            continue;
+
+        auto table = make_unique<maskDistributions_t>();
+        auto masks = embedded.masks;
+
+        for (auto & distribution : *table)
+        {
+            for (auto & mask : distribution)
+                mask = *masks++;
+        }
+
+        return table;
+    }
+
+    return nullptr;
+}
+
+auto MasksTableCache::loadFile(unsigned int numSamples, uint32_t seed) const -> std::unique_ptr<maskDistributions_t>
+{
+    const auto path = filePath(numSamples, seed);
+    const auto expectedHeader = makeHeader(numSamples, seed);
+    const auto fileSize = sizeof(MasksTableHeader) + sizeof(maskDistributions_t);
+
+    auto table = make_unique<maskDistributions_t>();
+
+#ifdef _WIN32
+    std::ifstream stream{path, std::ios::binary};
+
+    if (!stream)
+        return nullptr;
+
+    auto header = MasksTableHeader{};
+    stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+    stream.read(reinterpret_cast<char *>(table->data()), sizeof(maskDistributions_t));
+
+    if (!stream || !matches(header, expectedHeader))
+        return nullptr;
+#else
+    const auto file = open(path.c_str(), O_RDONLY);
+
+    if (file < 0)
+        return nullptr;
+
+    struct stat status;
+
+    if (fstat(file, &status) != 0 || static_cast<std::size_t>(status.st_size) != fileSize)
+    {
+        close(file);
+        return nullptr;
+    }
+
+    const auto mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (mapped == MAP_FAILED)
+        return nullptr;
+
+    const auto bytes = static_cast<const char *>(mapped);
+    const auto valid = matches(*reinterpret_cast<const MasksTableHeader *>(bytes), expectedHeader);
+
+    if (valid)
+        std::memcpy(table->data(), bytes + sizeof(MasksTableHeader), sizeof(maskDistributions_t));
+
+    munmap(mapped, fileSize);
+
+    if (!valid)
+        return nullptr;
+#endif
+
+    return table;
+}
+
+void MasksTableCache::storeFile(unsigned int numSamples, uint32_t seed, const maskDistributions_t & table) const
+{
+    const auto path = filePath(numSamples, seed);
+    const auto temporaryPath = CacheDirectory::temporaryFilePath(path);
+    const auto header = makeHeader(numSamples, seed);
+
+    // written to a temporary file first, so concurrent readers never see a partially written table,
+    // superseded and current jobs for the same table each write their own
+    {
+        std::ofstream stream{temporaryPath, std::ios::binary | std::ios::trunc};
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(table.data()), sizeof(maskDistributions_t));
+
+        if (!stream)
+        {
+            globjects::warning() << "Could not write masks table cache " << temporaryPath;
+            std::remove(temporaryPath.c_str());
+            return;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        std::remove(temporaryPath.c_str());
+}
+
+std::string MasksTableCache::filePath(unsigned int numSamples, uint32_t seed) const
+{
+    std::stringstream stream;
+    stream << m_directory << "masks_" << numSamples << "_" << seed << "_"
+        << MasksTableGenerator::s_alphaRes << "x" << MasksTableGenerator::s_numMasks
+        << "_v" << MasksTableGenerator::s_version << ".bin";
+
+    return stream.str();
+}
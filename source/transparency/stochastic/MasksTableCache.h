@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "MasksTableGenerator.h"
+
+
+class MasksTableCache
+{
+public:
+    using maskDistributions_t = MasksTableGenerator::maskDistributions_t;
+
+public:
+    MasksTableCache(const std::string & directory);
+    ~MasksTableCache();
+
+    /** Returns the embedded or cached table, generates and caches it otherwise */
+    std::unique_ptr<maskDistributions_t> load(unsigned int numSamples, uint32_t seed) const;
+
+protected:
+    std::unique_ptr<maskDistributions_t> loadEmbedded(unsigned int numSamples, uint32_t seed) const;
+    std::unique_ptr<maskDistributions_t> loadFile(unsigned int numSamples, uint32_t seed) const;
+    void storeFile(unsigned int numSamples, uint32_t seed, const maskDistributions_t & table) const;
+
+    std::string filePath(unsigned int numSamples, uint32_t seed) const;
+
+private:
+    const std::string m_directory;
+};
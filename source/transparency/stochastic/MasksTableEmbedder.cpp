@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "MasksTableGenerator.h"
+
+
+// Generates EmbeddedMasksTables.cpp at build time, so the common tables do not have to be generated at runtime
+
+int main(int argc, char * argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output file>" << std::endl;
+        return 1;
+    }
+
+    static const unsigned int numSamplesToEmbed[] = { 4u, 8u };
+    const auto seed = static_cast<uint32_t>(MasksTableGenerator::s_defaultSeed);
+    const auto version = static_cast<uint32_t>(MasksTableGenerator::s_version);
+
+    std::ofstream stream{argv[1]};
+
+    stream << "// generated by the masks table embedder, do not edit" << std::endl << std::endl;
+    stream << "#include \"stochastic/EmbeddedMasksTables.h\"" << std::endl << std::endl;
+    stream << "namespace" << std::endl << "{" << std::endl << std::endl;
+
+    for (const auto numSamples : numSamplesToEmbed)
+    {
+        const auto table = MasksTableGenerator::generateDistributions(numSamples, seed);
+
+        stream << "const uint8_t masks" << numSamples << "[] = {";
+
+        auto i = 0u;
+        char value[8];
+
+        for (const auto & distribution : *table)
+        {
+            for (const auto mask : distribution)
+            {
+                std::snprintf(value, sizeof(value), "0x%02x,", static_cast<unsigned int>(mask));
+                stream << (i++ % 16u == 0u ? "\n    " : " ") << value;
+            }
+        }
+
+        stream << std::endl << "};" << std::endl << std::endl;
+    }
+
+    stream << "}" << std::endl << std::endl;
+    stream << "const EmbeddedMasksTable kEmbeddedMasksTables[] = {" << std::endl;
+
+    for (const auto numSamples : numSamplesToEmbed)
+        stream << "    { " << numSamples << "u, " << seed << "u, " << version << "u, masks" << numSamples << " }," << std::endl;
+
+    stream << "};" << std::endl << std::endl;
+    stream << "const unsigned int kNumEmbeddedMasksTables = " << sizeof(numSamplesToEmbed) / sizeof(numSamplesToEmbed[0]) << "u;" << std::endl;
+
+    return stream ? 0 : 1;
+}
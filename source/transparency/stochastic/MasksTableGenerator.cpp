@@ -2,6 +2,8 @@
 
 #include <cassert>
 #include <algorithm>
+#include <numeric>
+#include <thread>
 
 #include <glm/common.hpp>
 
@@ -10,56 +12,135 @@
 
 using widgetzeug::make_unique;
 
-auto MasksTableGenerator::generateDistributions(unsigned int numSamples) -> std::unique_ptr<maskDistributions_t>
+namespace
 {
-    return MasksTableGenerator(numSamples).generateDistributions();
+
+uint64_t binomialCoefficient(unsigned int n, unsigned int k)
+{
+    k = std::min(k, n - k);
+
+    auto result = uint64_t{1u};
+
+    for (auto i = 1u; i <= k; ++i)
+        result = result * (n - k + i) / i;
+
+    return result;
+}
+
+}
+
+auto MasksTableGenerator::generateDistributions(
+    unsigned int numSamples,
+    uint32_t seed) -> std::unique_ptr<maskDistributions_t>
+{
+    return MasksTableGenerator(numSamples, seed).generateDistributions();
 }
 
-MasksTableGenerator::MasksTableGenerator(unsigned int numSamples)
+MasksTableGenerator::MasksTableGenerator(unsigned int numSamples, uint32_t seed)
 :   m_numSamples{numSamples}
+,   m_seed{seed}
 {
+    assert(m_numSamples > 0u && m_numSamples <= s_maxNumSamples);
 }
 
 MasksTableGenerator::~MasksTableGenerator() = default;
 
 auto MasksTableGenerator::generateDistributions() -> std::unique_ptr<maskDistributions_t>
-{    
-    generateCombinations();
-    
+{
     auto masks = make_unique<maskDistributions_t>();
-    
-    for (auto i = 0u; i < masks->size(); ++i)
-        generateDistributionForAlpha(i, masks->at(i));
+
+    const auto numThreads = std::max(std::min(std::thread::hardware_concurrency(), s_alphaRes), 1u);
+    const auto alphaIndicesPerThread = (s_alphaRes + numThreads - 1u) / numThreads;
+
+    auto threads = std::vector<std::thread>{};
+
+    for (auto begin = 0u; begin < s_alphaRes; begin += alphaIndicesPerThread)
+    {
+        const auto end = std::min(begin + alphaIndicesPerThread, s_alphaRes);
+        threads.emplace_back(&MasksTableGenerator::generateDistributionsForRange, this, begin, end, std::ref(*masks));
+    }
+
+    for (auto & thread : threads)
+        thread.join();
 
     return std::move(masks);
 }
 
-void MasksTableGenerator::generateCombinations()
+void MasksTableGenerator::generateDistributionsForRange(
+    unsigned int beginAlphaIndex,
+    unsigned int endAlphaIndex,
+    maskDistributions_t & masks) const
+{
+    for (auto i = beginAlphaIndex; i < endAlphaIndex; ++i)
+        generateDistributionForAlpha(i, masks.at(i));
+}
+
+void MasksTableGenerator::generateDistributionForAlpha(
+    unsigned int alphaIndex,
+    maskDistribution_t & masks) const
 {
-    m_combinationMasks = std::vector<std::vector<mask_t>>{};
-        
-    for (auto k = 0u; k <= m_numSamples; ++k)
+    // one generator per row keeps the result independent of the thread partitioning
+    std::seed_seq sequence{m_seed, alphaIndex};
+    auto generator = std::mt19937{sequence};
+
+    const auto avgNumSamples = m_numSamples * (static_cast<float>(alphaIndex) / (s_alphaRes - 1));
+    const auto lowNumSamples = glm::floor(avgNumSamples);
+    const auto highNumSamples = lowNumSamples + 1.0f;
+    const auto ratio = 1.0f - glm::fract(avgNumSamples);
+
+    const auto lowNumMasks = static_cast<unsigned int>(ratio * s_numMasks);
+    const auto highNumMasks = s_numMasks - lowNumMasks;
+
+    auto maskIt = masks.begin();
+
+    copyMasks(lowNumMasks, generateMasksForK(static_cast<unsigned int>(lowNumSamples), lowNumMasks, generator), maskIt);
+    copyMasks(highNumMasks, generateMasksForK(static_cast<unsigned int>(highNumSamples), highNumMasks, generator), maskIt);
+
+    assert(maskIt == masks.end());
+
+    std::shuffle(masks.begin(), masks.end(), generator);
+}
+
+auto MasksTableGenerator::generateMasksForK(
+    unsigned int k,
+    unsigned int numMasks,
+    std::mt19937 & generator) const -> std::vector<mask_t>
+{
+    auto masks = std::vector<mask_t>{};
+
+    if (numMasks == 0u)
+        return masks;
+
+    assert(k <= m_numSamples);
+
+    // enumerate all combinations while they fit into a row, so each of them is used equally often
+    if (binomialCoefficient(m_numSamples, k) <= s_numMasks)
     {
-        auto kCombinations = std::vector<mask_t>{};
-        generateCombinationsForK(0x00, 0, k, kCombinations);
-        
-        std::random_shuffle(kCombinations.begin(), kCombinations.end());
-        m_combinationMasks.push_back(kCombinations);
+        generateCombinationsForK(0x00, 0, k, masks);
+        std::shuffle(masks.begin(), masks.end(), generator);
+        return masks;
     }
+
+    masks.reserve(numMasks);
+
+    for (auto i = 0u; i < numMasks; ++i)
+        masks.push_back(generateRandomCombination(k, generator));
+
+    return masks;
 }
 
 void MasksTableGenerator::generateCombinationsForK(
-    const std::bitset<8> & combination,
+    const std::bitset<s_maxNumSamples> & combination,
     unsigned char offset,
     unsigned char k,
-    std::vector<mask_t> & combinationMasks)
+    std::vector<mask_t> & combinationMasks) const
 {
     if (k == 0)
     {
         combinationMasks.push_back(combination.to_ulong());
         return;
     }
-    
+
     for (auto i = offset; i < m_numSamples - (k - 1); ++i)
     {
         auto newCombination = combination;
@@ -68,35 +149,34 @@ void MasksTableGenerator::generateCombinationsForK(
     }
 }
 
-void MasksTableGenerator::generateDistributionForAlpha(
-    unsigned int alphaIndex, 
-    maskDistribution_t & masks)
+auto MasksTableGenerator::generateRandomCombination(
+    unsigned int k,
+    std::mt19937 & generator) const -> mask_t
 {
-    const auto avgNumSamples = m_numSamples * (static_cast<float>(alphaIndex) / (s_alphaRes - 1));
-    const auto lowNumSamples = glm::floor(avgNumSamples);
-    const auto highNumSamples = lowNumSamples + 1.0f;
-    const auto ratio = 1.0f - glm::fract(avgNumSamples);
-    
-    const auto lowNumMasks = static_cast<unsigned int>(ratio * s_numMasks);
-    const auto highNumMasks = s_numMasks - lowNumMasks;
+    auto samples = std::array<unsigned char, s_maxNumSamples>{};
+    std::iota(samples.begin(), samples.begin() + m_numSamples, 0);
 
-    auto maskIt = masks.begin();
+    auto mask = mask_t{0u};
 
-    copyMasks(lowNumMasks, m_combinationMasks[lowNumSamples], maskIt);
-    copyMasks(highNumMasks, m_combinationMasks[highNumSamples], maskIt);
-    
-    assert(maskIt == masks.end());
-    
-    std::random_shuffle(masks.begin(), masks.end());
+    // partial Fisher-Yates shuffle, the first k samples form the combination
+    for (auto i = 0u; i < k; ++i)
+    {
+        const auto j = std::uniform_int_distribution<unsigned int>{i, m_numSamples - 1u}(generator);
+        std::swap(samples[i], samples[j]);
+
+        mask |= mask_t{1u} << samples[i];
+    }
+
+    return mask;
 }
 
 void MasksTableGenerator::copyMasks(
     unsigned int numMasks,
     const std::vector<mask_t> & fromMasks,
-    maskDistribution_t::iterator & toMaskIt)
+    maskDistribution_t::iterator & toMaskIt) const
 {
     while (numMasks > 0)
-    {        
+    {
         if (numMasks >= fromMasks.size())
         {
             toMaskIt = std::copy(fromMasks.begin(), fromMasks.end(), toMaskIt);
@@ -108,6 +188,6 @@ void MasksTableGenerator::copyMasks(
             numMasks -= numMasks;
         }
     }
-        
+
     assert(numMasks == 0);
 }
@@ -4,6 +4,7 @@
 #include <array>
 #include <bitset>
 #include <memory>
+#include <random>
 #include <vector>
 
 
@@ -12,40 +13,59 @@ class MasksTableGenerator
 public:
     static const auto s_alphaRes = 256u;
     static const auto s_numMasks = 1024u;
+    static const auto s_maxNumSamples = 32u;
+    static const auto s_defaultSeed = 5489u;
 
-    using mask_t = uint8_t;
+    // increment whenever a change alters the generated tables, invalidates cached tables
+    static const auto s_version = 2u;
+
+    using mask_t = uint32_t;
     using maskDistribution_t = std::array<mask_t, s_numMasks>;
-    
+
     using maskDistributions_t = std::array<maskDistribution_t, s_alphaRes>;
 
 public:
-    static std::unique_ptr<maskDistributions_t> generateDistributions(unsigned int numSamples);
+    static std::unique_ptr<maskDistributions_t> generateDistributions(
+        unsigned int numSamples,
+        uint32_t seed = s_defaultSeed);
 
 public:
-    MasksTableGenerator(unsigned int numSamples);
+    MasksTableGenerator(unsigned int numSamples, uint32_t seed = s_defaultSeed);
     ~MasksTableGenerator();
 
     std::unique_ptr<maskDistributions_t> generateDistributions();
 
 protected:
-    void generateCombinations();
+    void generateDistributionsForRange(
+        unsigned int beginAlphaIndex,
+        unsigned int endAlphaIndex,
+        maskDistributions_t & masks) const;
+
+    void generateDistributionForAlpha(
+        unsigned int alphaIndex,
+        maskDistribution_t & masks) const;
+
+    std::vector<mask_t> generateMasksForK(
+        unsigned int k,
+        unsigned int numMasks,
+        std::mt19937 & generator) const;
 
     void generateCombinationsForK(
-        const std::bitset<8> & combination,
+        const std::bitset<s_maxNumSamples> & combination,
         unsigned char offset,
         unsigned char k,
-        std::vector<mask_t> & combinationMasks);
+        std::vector<mask_t> & combinationMasks) const;
 
-    void generateDistributionForAlpha(
-        unsigned int alphaIndex,
-        maskDistribution_t & masks);
+    mask_t generateRandomCombination(
+        unsigned int k,
+        std::mt19937 & generator) const;
 
     void copyMasks(
         unsigned int numMasks,
         const std::vector<mask_t> & fromMasks,
-        maskDistribution_t::iterator & toMaskIt);
+        maskDistribution_t::iterator & toMaskIt) const;
 
 private:
     const unsigned int m_numSamples;
-    std::vector<std::vector<mask_t>> m_combinationMasks;
+    const uint32_t m_seed;
 };
@@ -1,5 +1,8 @@
 #include "StochasticTransparency.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 
 #include <glm/glm.hpp>
@@ -9,12 +12,16 @@
 #include <glbinding/gl/boolean.h>
 #include <glbinding/gl/enum.h>
 #include <glbinding/gl/bitfield.h>
+#include <glbinding/gl/extension.h>
 
 #include <globjects/globjects.h>
+#include <globjects/base/File.h>
+#include <globjects/base/StringTemplate.h>
 #include <globjects/logging.h>
 #include <globjects/Framebuffer.h>
 #include <globjects/DebugMessage.h>
 #include <globjects/Program.h>
+#include <globjects/Shader.h>
 #include <globjects/Texture.h>
 
 #include <gloperate/base/RenderTargetType.h>
@@ -24,18 +31,25 @@
 #include <gloperate/painter/ViewportCapability.h>
 #include <gloperate/painter/PerspectiveProjectionCapability.h>
 #include <gloperate/painter/CameraCapability.h>
+#include <gloperate/painter/VirtualTimeCapability.h>
 #include <gloperate/primitives/AdaptiveGrid.h>
 #include <gloperate/primitives/ScreenAlignedQuad.h>
-#include <gloperate/primitives/Scene.h>
 
-#include <gloperate/primitives/PolygonalDrawable.h>
 #include <gloperate/primitives/PolygonalGeometry.h>
 
 #include <reflectionzeug/PropertyGroup.h>
 #include <widgetzeug/make_unique.hpp>
 
+#include "CacheDirectory.h"
+#include "MasksTableCache.h"
 #include "MasksTableGenerator.h"
 #include "StochasticTransparencyOptions.h"
+#include "diagnostics/DepthComplexityDiagnostics.h"
+#include "scene/LodSelector.h"
+#include "scene/MeshCache.h"
+#include "scene/MeshDrawable.h"
+#include "scene/SceneOptions.h"
+#include "scene/SyntheticSceneGenerator.h"
 
 
 using namespace gl;
@@ -44,14 +58,117 @@ using namespace globjects;
 
 using widgetzeug::make_unique;
 
+namespace
+{
+
+GLenum transparentColorFormat(StochasticTransparencyAttachmentFormat format)
+{
+    return format == StochasticTransparencyAttachmentFormat::Float32 ? GL_RGBA32F : GL_RGBA16F;
+}
+
+GLenum totalAlphaFormat(StochasticTransparencyAttachmentFormat format)
+{
+    switch (format)
+    {
+    case StochasticTransparencyAttachmentFormat::Float16:
+        return GL_R16F;
+    case StochasticTransparencyAttachmentFormat::Float16WithUnormAlpha:
+        return GL_R8;
+    default:
+        return GL_R32F;
+    }
+}
+
+unsigned int transparentColorBytes(StochasticTransparencyAttachmentFormat format)
+{
+    return format == StochasticTransparencyAttachmentFormat::Float32 ? 16u : 8u;
+}
+
+GLenum masksFormat(uint16_t numSamples)
+{
+    if (numSamples <= 8u)
+        return GL_R8UI;
+    
+    return numSamples <= 16u ? GL_R16UI : GL_R32UI;
+}
+
+GLenum masksType(uint16_t numSamples)
+{
+    if (numSamples <= 8u)
+        return GL_UNSIGNED_BYTE;
+    
+    return numSamples <= 16u ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+unsigned int bytesPerMask(uint16_t numSamples)
+{
+    if (numSamples <= 8u)
+        return 1u;
+    
+    return numSamples <= 16u ? 2u : 4u;
+}
+
+template <typename T>
+void packMasks(const MasksTableGenerator::maskDistributions_t & table, unsigned char * data)
+{
+    auto packed = reinterpret_cast<T *>(data);
+    
+    for (const auto & distribution : table)
+    {
+        for (const auto mask : distribution)
+            *packed++ = static_cast<T>(mask);
+    }
+}
+
+// narrows the masks to the width of the texture format
+std::vector<unsigned char> packMasks(const MasksTableGenerator::maskDistributions_t & table, uint16_t numSamples)
+{
+    const auto bytes = bytesPerMask(numSamples);
+    auto data = std::vector<unsigned char>(MasksTableGenerator::s_alphaRes * MasksTableGenerator::s_numMasks * bytes);
+    
+    if (bytes == 1u)
+        packMasks<uint8_t>(table, data.data());
+    else if (bytes == 2u)
+        packMasks<uint16_t>(table, data.data());
+    else
+        packMasks<uint32_t>(table, data.data());
+    
+    return data;
+}
+
+unsigned int totalAlphaBytes(StochasticTransparencyAttachmentFormat format)
+{
+    switch (format)
+    {
+    case StochasticTransparencyAttachmentFormat::Float16:
+        return 2u;
+    case StochasticTransparencyAttachmentFormat::Float16WithUnormAlpha:
+        return 1u;
+    default:
+        return 4u;
+    }
+}
+
+}
+
 StochasticTransparency::StochasticTransparency(gloperate::ResourceManager & resourceManager)
 :   Painter(resourceManager)
 ,   m_targetFramebufferCapability(addCapability(new gloperate::TargetFramebufferCapability()))
 ,   m_viewportCapability(addCapability(new gloperate::ViewportCapability()))
 ,   m_projectionCapability(addCapability(new gloperate::PerspectiveProjectionCapability(m_viewportCapability)))
 ,   m_cameraCapability(addCapability(new gloperate::CameraCapability()))
+,   m_timeCapability(addCapability(new gloperate::VirtualTimeCapability()))
+,   m_opaqueLayerValid(false)
+,   m_accumulatedFrames(0u)
+,   m_attachedMaskShader(nullptr)
+,   m_pendingMasksNumSamples(0u)
+,   m_singlePassSupported(false)
 ,   m_options(new StochasticTransparencyOptions(*this))
+,   m_sceneOptions(new SceneOptions(*this))
+,   m_lodSelector(new LodSelector(*this, m_viewportCapability, m_projectionCapability, m_cameraCapability))
+,   m_diagnostics(new DepthComplexityDiagnostics(*this, m_viewportCapability, m_targetFramebufferCapability))
 {
+    m_timeCapability->setEnabled(false);
 }
 
 StochasticTransparency::~StochasticTransparency() = default;
@@ -69,6 +186,7 @@ void StochasticTransparency::onInitialize()
 #endif
 
     m_options->initGL();
+    m_textureClear.initGL();
     
     m_grid = make_ref<gloperate::AdaptiveGrid>();
     m_grid->setColor({0.6f, 0.6f, 0.6f});
@@ -76,8 +194,9 @@ void StochasticTransparency::onInitialize()
     setupPrograms();
     setupProjection();
     setupFramebuffer();
-    setupMasksTexture();
     setupDrawable();
+    
+    m_diagnostics->initGL();
 }
 
 void StochasticTransparency::onPaint()
@@ -94,13 +213,77 @@ void StochasticTransparency::onPaint()
         
         const auto viewport = glm::vec2{m_viewportCapability->width(), m_viewportCapability->height()};
         m_alphaToCoverageProgram->setUniform("viewport", viewport);
+        m_alphaToSampleMaskProgram->setUniform("viewport", viewport);
         
         updateFramebuffer();
+        
+        m_accumulatedFrames = 0u;
+    }
+    
+    if (m_cameraCapability->hasChanged())
+    {
+        m_cameraCapability->setChanged(false);
+        m_accumulatedFrames = 0u;
+        m_opaqueLayerValid = false;
     }
     
+    if (m_options->optionsChanged())
+        m_accumulatedFrames = 0u;
+    
+    if (m_sceneOptions->sceneChanged())
+    {
+        setupDrawable();
+        m_accumulatedFrames = 0u;
+    }
+    
+    m_lodSelector->setNumTriangles(m_lodSelector->select(m_drawables));
+    
+    if (m_lodSelector->selectionChanged())
+        m_accumulatedFrames = 0u;
+    
     if (m_options->numSamplesChanged())
         updateNumSamples();
     
+    if (m_options->maskGenerationChanged())
+        updateMaskGeneration();
+    
+    if (m_options->maskSeedChanged())
+        setupMasksTexture();
+    
+    updatePendingMasksTexture();
+    
+    if (m_options->attachmentFormatChanged())
+        updateFramebuffer();
+    
+    if (m_options->transparencyResolutionChanged())
+        updateFramebuffer();
+    
+    if (m_options->optimizationChanged())
+    {
+        updateAccumulationFramebuffer();
+        updateMemoryFootprint();
+    }
+    
+    if (m_options->precisionErrorRequested())
+    {
+        measurePrecisionError();
+        m_options->setPrecisionErrorRequested(false);
+    }
+    
+    const auto accumulate = m_options->temporalAccumulation() &&
+        m_options->optimization() != StochasticTransparencyOptimization::NoOptimization;
+    
+    // keeps the viewer repainting only while the history has not converged
+    m_timeCapability->setEnabled(accumulate && m_accumulatedFrames < kMaxAccumulatedFrames);
+    
+    if (accumulate && m_accumulatedFrames >= kMaxAccumulatedFrames)
+    {
+        blitHistory();
+        return;
+    }
+    
+    m_diagnostics->begin();
+    
     clearBuffers();
     updateUniforms();
     
@@ -111,12 +294,11 @@ void StochasticTransparency::onPaint()
         if (m_options->backFaceCulling())
             glEnable(GL_CULL_FACE);
         
-        glEnable(GL_SAMPLE_SHADING);
-        glMinSampleShading(1.0);
+        enableSampleShading();
         
         renderAlphaToCoverage(kOpaqueColorAttachment);
         
-        glDisable(GL_SAMPLE_SHADING);
+        disableSampleShading();
         glDisable(GL_CULL_FACE);
         
         blit();
@@ -125,9 +307,18 @@ void StochasticTransparency::onPaint()
     {
         renderOpaqueGeometry();
         renderTransparentGeometry();
-        composite();
+        
+        if (accumulate)
+            accumulateHistory();
+        else
+            composite();
     }
     
+    const auto transform = m_projectionCapability->projection() * m_cameraCapability->view();
+    
+    m_diagnostics->end();
+    m_diagnostics->render(transform, [this] () { m_grid->draw(); }, [this] () { for (auto & drawable : m_drawables) drawable->draw(); });
+    
     Framebuffer::unbind(GL_FRAMEBUFFER);
 }
 
@@ -137,17 +328,48 @@ void StochasticTransparency::setupFramebuffer()
     m_transparentColorAttachment = make_ref<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
     m_totalAlphaAttachment = make_ref<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
     m_depthAttachment = make_ref<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
+    m_transparentDepthAttachment = make_ref<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
+    m_historyAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    m_opaqueLayerColorAttachment = make_ref<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
+    m_opaqueLayerDepthAttachment = make_ref<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
     
-    updateFramebuffer();
+    m_tileCoverageTexture = make_ref<Texture>(GL_TEXTURE_2D);
+    m_tileCoverageTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_tileCoverageTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     
     m_fbo = make_ref<Framebuffer>();
     
     m_fbo->attachTexture(kOpaqueColorAttachment, m_opaqueColorAttachment);
-    m_fbo->attachTexture(kTransparentColorAttachment, m_transparentColorAttachment);
-    m_fbo->attachTexture(kTotalAlphaAttachment, m_totalAlphaAttachment);
     m_fbo->attachTexture(GL_DEPTH_ATTACHMENT, m_depthAttachment);
+    
+    m_transparentFbo = make_ref<Framebuffer>();
+    
+    m_transparentFbo->attachTexture(kTransparentColorAttachment, m_transparentColorAttachment);
+    m_transparentFbo->attachTexture(kTotalAlphaAttachment, m_totalAlphaAttachment);
+    
+    m_accumulationFbo = make_ref<Framebuffer>();
+    
+    m_accumulationFbo->attachTexture(kTransparentColorAttachment, m_transparentColorAttachment);
+    m_accumulationFbo->attachTexture(kTotalAlphaAttachment, m_totalAlphaAttachment);
+    
+    m_opaqueLayerFbo = make_ref<Framebuffer>();
+    
+    m_opaqueLayerFbo->attachTexture(kOpaqueColorAttachment, m_opaqueLayerColorAttachment);
+    m_opaqueLayerFbo->attachTexture(GL_DEPTH_ATTACHMENT, m_opaqueLayerDepthAttachment);
+    
+    updateFramebuffer();
 
     m_fbo->printStatus(true);
+    m_transparentFbo->printStatus(true);
+    m_opaqueLayerFbo->printStatus(true);
+    
+    m_precisionColorAttachment = Texture::createDefault(GL_TEXTURE_2D);
+    
+    m_precisionFbo = make_ref<Framebuffer>();
+    m_precisionFbo->attachTexture(GL_COLOR_ATTACHMENT0, m_precisionColorAttachment);
+    
+    m_historyFbo = make_ref<Framebuffer>();
+    m_historyFbo->attachTexture(GL_COLOR_ATTACHMENT0, m_historyAttachment);
 }
 
 void StochasticTransparency::setupProjection()
@@ -163,100 +385,391 @@ void StochasticTransparency::setupProjection()
 
 void StochasticTransparency::setupDrawable()
 {
-    // Load scene
-    const auto scene = m_resourceManager.load<gloperate::Scene>("data/transparency/transparency_scene.obj");
+    m_drawables.clear();
+    
+    if (m_sceneOptions->source() == SceneSource::Synthetic)
+    {
+        const auto geometry = SyntheticSceneGenerator::generate(
+            m_sceneOptions->syntheticLayers(),
+            m_sceneOptions->syntheticInstances(),
+            m_sceneOptions->syntheticTessellation(),
+            m_sceneOptions->syntheticSize());
+        
+        m_drawables.push_back(gloperate::make_unique<MeshDrawable>(*geometry));
+        m_sceneOptions->setNumTriangles(static_cast<uint32_t>(geometry->indices().size() / 3u));
+        return;
+    }
+    
+    // Load scene, the cache imports the file only once and maps the stored arrays afterwards
+    const auto scene = MeshCache{CacheDirectory::path()}.load("data/transparency/transparency_scene.obj", m_resourceManager);
     if (!scene)
     {
         std::cout << "Could not load file" << std::endl;
         return;
     }
 
+    auto numTriangles = 0u;
+
     // Create a renderable for each mesh
-    for (const auto * geometry : scene->meshes()) {
-        m_drawables.push_back(gloperate::make_unique<gloperate::PolygonalDrawable>(*geometry));
+    for (const auto & mesh : scene->meshes()) {
+        m_drawables.push_back(gloperate::make_unique<MeshDrawable>(mesh));
+        numTriangles += mesh.numIndices / 3u;
     }
 
-    // Release scene
-    delete scene;
+    m_sceneOptions->setNumTriangles(numTriangles);
 }
 
 void StochasticTransparency::setupPrograms()
 {
     static const auto totalAlphaShaders = "total_alpha";
     static const auto alphaToCoverageShaders = "alpha_to_coverage";
+    static const auto alphaToSampleMaskShaders = "alpha_to_sample_mask";
     static const auto transparentColorsShaders = "transparent_colors";
-    static const auto compositingShaders = "compositing";
+    static const auto accumulationShaders = "total_alpha_and_transparent_colors";
     
-    const auto initProgram = [] (globjects::ref_ptr<globjects::Program> & program, const char * shaders)
+    const auto initProgram = [] (globjects::ref_ptr<globjects::Program> & program,
+        const char * vertexShaders, const char * fragmentShaders)
     {
         static const auto shaderPath = std::string{"data/transparency/"};
         
         program = make_ref<Program>();
         program->attach(
-            Shader::fromFile(GL_VERTEX_SHADER, shaderPath + shaders + ".vert"),
-            Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + shaders + ".frag"));
+            Shader::fromFile(GL_VERTEX_SHADER, shaderPath + vertexShaders + ".vert"),
+            Shader::fromFile(GL_FRAGMENT_SHADER, shaderPath + fragmentShaders + ".frag"));
     };
     
-    initProgram(m_totalAlphaProgram, totalAlphaShaders);
-    initProgram(m_alphaToCoverageProgram, alphaToCoverageShaders);
-    initProgram(m_colorAccumulationProgram, transparentColorsShaders);
-    initProgram(m_compositingProgram, compositingShaders);
+    initProgram(m_totalAlphaProgram, totalAlphaShaders, totalAlphaShaders);
+    initProgram(m_alphaToCoverageProgram, alphaToCoverageShaders, alphaToCoverageShaders);
+    initProgram(m_alphaToSampleMaskProgram, alphaToCoverageShaders, alphaToSampleMaskShaders);
+    initProgram(m_colorAccumulationProgram, transparentColorsShaders, transparentColorsShaders);
+    
+    // the single pass shades per pixel and needs the coverage after the depth test to weight the color
+    m_singlePassSupported = hasExtension(GLextension::GL_ARB_post_depth_coverage) &&
+        hasExtension(GLextension::GL_ARB_gpu_shader5);
+    
+    if (m_singlePassSupported)
+        initProgram(m_accumulationProgram, accumulationShaders, accumulationShaders);
+    
+    m_tableMaskShader = Shader::fromFile(GL_FRAGMENT_SHADER, "data/transparency/coverage_mask_table.frag");
+    m_proceduralMaskShader = Shader::fromFile(GL_FRAGMENT_SHADER, "data/transparency/coverage_mask_procedural.frag");
+    
+    // the table based masks are generated in the background, until then the procedural ones are used
+    attachMaskShader(m_proceduralMaskShader);
+    
+    m_adaptiveSamplesShader = Shader::fromFile(GL_FRAGMENT_SHADER, "data/transparency/adaptive_samples.frag");
+    
+    for (auto program : { m_alphaToCoverageProgram.get(), m_alphaToSampleMaskProgram.get(), m_colorAccumulationProgram.get() })
+    {
+        program->attach(m_adaptiveSamplesShader);
+        program->setUniform("tileCoverageTexture", 1);
+    }
     
     m_alphaToCoverageProgram->setUniform("masksTexture", 0);
+    m_alphaToSampleMaskProgram->setUniform("masksTexture", 0);
     
-    updateNumSamplesUniforms();
+    m_totalAlphaProgram->setUniform("tileCoverageImage", 0);
     
-    const auto opaqueColorLocation = m_compositingProgram->getUniformLocation("opaqueColorTexture");
-    const auto totalAlphaLocation = m_compositingProgram->getUniformLocation("totalAlphaTexture");
-    const auto transparentColorLocation = m_compositingProgram->getUniformLocation("transparentColorTexture");
+    if (m_singlePassSupported)
+    {
+        m_accumulationProgram->setUniform("stochasticDepthTexture", 0);
+        m_accumulationProgram->setUniform("tileCoverageImage", 0);
+    }
     
-    m_compositingProgram->setUniform(opaqueColorLocation, 0);
-    m_compositingProgram->setUniform(totalAlphaLocation, 1);
-    m_compositingProgram->setUniform(transparentColorLocation, 2);
+    for (auto numSamples = 1u; numSamples <= m_options->maxNumSamples(); numSamples *= 2u)
+        setupCompositingProgram(numSamples);
     
-    m_compositingQuad = make_ref<gloperate::ScreenAlignedQuad>(m_compositingProgram);
+    updateCompositingProgram();
+}
+
+void StochasticTransparency::setupCompositingProgram(uint16_t numSamples)
+{
+    static const auto compositingShaders = std::string{"data/transparency/compositing"};
+    
+    const auto fragmentShaderSource = new StringTemplate(new File(compositingShaders + ".frag"));
+    fragmentShaderSource->replace("NUM_SAMPLES", std::to_string(numSamples));
+    
+    const auto program = make_ref<Program>();
+    program->attach(
+        Shader::fromFile(GL_VERTEX_SHADER, compositingShaders + ".vert"),
+        new Shader(GL_FRAGMENT_SHADER, fragmentShaderSource));
+    
+    const auto opaqueColorLocation = program->getUniformLocation("opaqueColorTexture");
+    const auto totalAlphaLocation = program->getUniformLocation("totalAlphaTexture");
+    const auto transparentColorLocation = program->getUniformLocation("transparentColorTexture");
+    
+    program->setUniform(opaqueColorLocation, 0);
+    program->setUniform(totalAlphaLocation, 1);
+    program->setUniform(transparentColorLocation, 2);
+    program->setUniform("tileCoverageTexture", 3);
+    program->setUniform("opaqueDepthTexture", 4);
+    program->setUniform("tileSize", static_cast<int>(kTileSize));
+    
+    m_compositingPrograms[numSamples] = program;
+    m_compositingQuads[numSamples] = make_ref<gloperate::ScreenAlignedQuad>(program);
 }
 
 void StochasticTransparency::setupMasksTexture()
 {
-    static const auto numSamples = m_options->numSamples();
-    const auto table = MasksTableGenerator::generateDistributions(numSamples);
+    if (m_options->maskGeneration() == StochasticTransparencyMaskGeneration::Procedural)
+    {
+        retirePendingMasks();
+        m_masksTexture = nullptr;
+        
+        attachMaskShader(m_proceduralMaskShader);
+        return;
+    }
+    
+    const auto numSamples = m_options->numSamples();
+    const auto seed = m_options->maskSeed();
+    
+    retirePendingMasks();
+    
+    m_pendingMasksNumSamples = numSamples;
+    m_pendingMasks = std::async(std::launch::async, [numSamples, seed] ()
+    {
+        const auto table = MasksTableCache{CacheDirectory::path()}.load(numSamples, seed);
+        return packMasks(*table, numSamples);
+    });
+    
+    attachMaskShader(m_proceduralMaskShader);
+}
+
+void StochasticTransparency::updatePendingMasksTexture()
+{
+    m_retiredMasks.erase(std::remove_if(m_retiredMasks.begin(), m_retiredMasks.end(),
+        [] (const std::future<std::vector<unsigned char>> & masks)
+        {
+            return masks.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }), m_retiredMasks.end());
+    
+    if (!m_pendingMasks.valid() || m_pendingMasks.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    
+    const auto data = m_pendingMasks.get();
+    const auto numSamples = m_pendingMasksNumSamples;
+    
+    m_masksTexture = make_ref<Texture>(GL_TEXTURE_2D);
+    m_masksTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_masksTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    m_masksTexture->image2D(0, masksFormat(numSamples), MasksTableGenerator::s_numMasks, MasksTableGenerator::s_alphaRes,
+        0, GL_RED_INTEGER, masksType(numSamples), data.data());
+    
+    attachMaskShader(m_tableMaskShader);
+    
+    m_accumulatedFrames = 0u;
+}
+
+void StochasticTransparency::retirePendingMasks()
+{
+    // destroying the future of an unfinished std::async job blocks until the job is done,
+    // superseded jobs are kept until updatePendingMasksTexture finds them ready
+    if (m_pendingMasks.valid())
+        m_retiredMasks.push_back(std::move(m_pendingMasks));
+}
+
+void StochasticTransparency::attachMaskShader(globjects::Shader * shader)
+{
+    if (shader == m_attachedMaskShader)
+        return;
+    
+    for (auto program : { m_alphaToCoverageProgram.get(), m_alphaToSampleMaskProgram.get() })
+    {
+        if (m_attachedMaskShader)
+            program->detach(m_attachedMaskShader);
+        
+        program->attach(shader);
+    }
     
-    m_masksTexture = Texture::createDefault(GL_TEXTURE_2D);
-    m_masksTexture->image2D(0, GL_R8, table->at(0).size(), table->size(), 0, GL_RED, GL_UNSIGNED_BYTE, table->data());
+    m_attachedMaskShader = shader;
+}
+
+void StochasticTransparency::updateMaskGeneration()
+{
+    setupMasksTexture();
+    updateMemoryFootprint();
 }
 
 void StochasticTransparency::updateFramebuffer()
+{
+    const auto format = m_options->attachmentFormat();
+    
+    updateFramebuffer(format);
+    updateMemoryFootprint();
+    
+    m_historyAttachment->image2D(0, GL_RGBA32F, m_viewportCapability->width(), m_viewportCapability->height(),
+        0, GL_RGBA, GL_FLOAT, nullptr);
+    
+    const auto tileSize = static_cast<int>(kTileSize);
+    const auto numTiles = (glm::ivec2{m_viewportCapability->width(), m_viewportCapability->height()} + tileSize - 1) / tileSize;
+    m_tileCoverageTexture->image2D(0, GL_R32UI, numTiles.x, numTiles.y, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void StochasticTransparency::updateMemoryFootprint()
+{
+    const auto format = m_options->attachmentFormat();
+    const auto numSamples = m_options->numSamples();
+    const auto numPixels = static_cast<float>(m_viewportCapability->width()) * m_viewportCapability->height();
+    const auto transparentSize = transparentFramebufferSize();
+    const auto numTransparentPixels = static_cast<float>(transparentSize.x) * transparentSize.y;
+    
+    // depth attachments and opaque color use four bytes per sample each, the opaque layer cache doubles them
+    const auto opaqueBytesPerSample = 2u * 2u * 4u;
+    
+    // separate transparent depth only at reduced resolution, opaque depth copy only for the single pass
+    const auto numTransparentDepths = (transparentResolutionDivisor() > 1 ? 1u : 0u) + (m_opaqueDepthAttachment ? 1u : 0u);
+    const auto transparentBytesPerSample = transparentColorBytes(format) + totalAlphaBytes(format) + numTransparentDepths * 4u;
+    const auto masksBytes = m_options->maskGeneration() == StochasticTransparencyMaskGeneration::Table
+        ? static_cast<float>(MasksTableGenerator::s_alphaRes * MasksTableGenerator::s_numMasks * bytesPerMask(numSamples))
+        : 0.0f;
+    const auto historyBytes = numPixels * 16u;
+    
+    const auto bytes = (numPixels * opaqueBytesPerSample + numTransparentPixels * transparentBytesPerSample) * numSamples;
+    m_options->setMemoryFootprint((bytes + masksBytes + historyBytes) / (1024.0f * 1024.0f));
+}
+
+void StochasticTransparency::updateFramebuffer(StochasticTransparencyAttachmentFormat format)
 {
     const auto numSamples = m_options->numSamples();
     const auto size = glm::ivec2{m_viewportCapability->width(), m_viewportCapability->height()};
+    const auto transparentSize = transparentFramebufferSize();
+    const auto reducedResolution = transparentResolutionDivisor() > 1;
     
     m_opaqueColorAttachment->image2DMultisample(numSamples, GL_RGBA8, size, GL_FALSE);
-    m_transparentColorAttachment->image2DMultisample(numSamples, GL_RGBA32F, size, GL_FALSE);
-    m_totalAlphaAttachment->image2DMultisample(numSamples, GL_R32F, size, GL_FALSE);
-    m_depthAttachment->image2DMultisample(numSamples, GL_DEPTH_COMPONENT, size, GL_FALSE);
+    m_transparentColorAttachment->image2DMultisample(numSamples, transparentColorFormat(format), transparentSize, GL_FALSE);
+    m_totalAlphaAttachment->image2DMultisample(numSamples, totalAlphaFormat(format), transparentSize, GL_FALSE);
+    m_depthAttachment->image2DMultisample(numSamples, GL_DEPTH_COMPONENT24, size, GL_FALSE);
+    m_transparentDepthAttachment->image2DMultisample(numSamples, GL_DEPTH_COMPONENT24,
+        reducedResolution ? transparentSize : glm::ivec2{1, 1}, GL_FALSE);
+    
+    // at full resolution the transparent passes test against and write to the opaque depth directly
+    m_transparentFbo->attachTexture(GL_DEPTH_ATTACHMENT,
+        reducedResolution ? m_transparentDepthAttachment : m_depthAttachment);
+    
+    m_opaqueLayerColorAttachment->image2DMultisample(numSamples, GL_RGBA8, size, GL_FALSE);
+    m_opaqueLayerDepthAttachment->image2DMultisample(numSamples, GL_DEPTH_COMPONENT24, size, GL_FALSE);
+    
+    m_opaqueLayerValid = false;
+    
+    updateAccumulationFramebuffer();
+    
+    if (!m_singlePassSupported)
+        return;
+    
+    // the stochastic depth is compared with a tolerance of one step of the format the driver actually allocated
+    const auto depthBits = m_depthAttachment->getLevelParameter(0, GL_TEXTURE_DEPTH_SIZE);
+    m_accumulationProgram->setUniform("depthEpsilon", 1.0f / static_cast<float>((1ull << depthBits) - 1ull));
+}
+
+void StochasticTransparency::updateAccumulationFramebuffer()
+{
+    // only the single pass tests against a copy of the opaque depth, the other modes keep no memory for it
+    if (!singlePassActive())
+    {
+        if (m_opaqueDepthAttachment)
+        {
+            m_accumulationFbo->detach(GL_DEPTH_ATTACHMENT);
+            m_opaqueDepthAttachment = nullptr;
+        }
+        
+        return;
+    }
+    
+    const auto created = !m_opaqueDepthAttachment;
+    
+    if (created)
+        m_opaqueDepthAttachment = make_ref<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
+    
+    m_opaqueDepthAttachment->image2DMultisample(m_options->numSamples(), GL_DEPTH_COMPONENT24,
+        transparentFramebufferSize(), GL_FALSE);
+    
+    if (!created)
+        return;
+    
+    m_accumulationFbo->attachTexture(GL_DEPTH_ATTACHMENT, m_opaqueDepthAttachment);
+    m_accumulationFbo->printStatus(true);
+}
+
+bool StochasticTransparency::singlePassActive() const
+{
+    return m_singlePassSupported &&
+        m_options->optimization() == StochasticTransparencyOptimization::AlphaCorrectionAndDepthBasedSinglePass;
+}
+
+bool StochasticTransparency::adaptiveSamplesActive() const
+{
+    // the fragments are counted by the total alpha pass, which the single pass and no optimization do not run
+    return m_options->adaptiveSamples() &&
+        m_options->optimization() != StochasticTransparencyOptimization::NoOptimization &&
+        !singlePassActive() &&
+        m_options->adaptiveNumSamples() < m_options->numSamples();
+}
+
+unsigned int StochasticTransparency::adaptiveFragmentThreshold() const
+{
+    // fragments a tile of the transparent framebuffer holds at the layer threshold
+    const auto tileSize = static_cast<float>(kTileSize / transparentResolutionDivisor());
+    
+    return static_cast<unsigned int>(m_options->adaptiveLayerThreshold() * tileSize * tileSize);
+}
+
+int StochasticTransparency::transparentResolutionDivisor() const
+{
+    switch (m_options->transparencyResolution())
+    {
+    case StochasticTransparencyResolution::Half:
+        return 2;
+    case StochasticTransparencyResolution::Quarter:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+glm::ivec2 StochasticTransparency::transparentFramebufferSize() const
+{
+    const auto size = glm::ivec2{m_viewportCapability->width(), m_viewportCapability->height()};
+    
+    return glm::max(size / transparentResolutionDivisor(), glm::ivec2{1, 1});
 }
 
 void StochasticTransparency::updateNumSamples()
 {
+    const auto numSamples = static_cast<unsigned int>(m_options->numSamples());
+    
+    m_alphaToCoverageProgram->setUniform("numSamples", numSamples);
+    m_alphaToSampleMaskProgram->setUniform("numSamples", numSamples);
+    
+    if (m_singlePassSupported)
+        m_accumulationProgram->setUniform("numSamples", numSamples);
+    
     setupMasksTexture();
     updateFramebuffer();
-    updateNumSamplesUniforms();
+    updateCompositingProgram();
 }
 
-void StochasticTransparency::updateNumSamplesUniforms()
+void StochasticTransparency::updateCompositingProgram()
 {
-    m_compositingProgram->setUniform("numSamples", static_cast<int>(m_options->numSamples()));
+    const auto numSamples = m_options->numSamples();
+    
+    if (m_compositingQuads.find(numSamples) == m_compositingQuads.end())
+        setupCompositingProgram(numSamples);
+    
+    m_compositingProgram = m_compositingPrograms.at(numSamples);
+    m_compositingQuad = m_compositingQuads.at(numSamples);
 }
 
 void StochasticTransparency::clearBuffers()
 {
-    m_fbo->setDrawBuffers({ kOpaqueColorAttachment, kTransparentColorAttachment, kTotalAlphaAttachment });
+    m_transparentFbo->setDrawBuffers({ kTransparentColorAttachment, kTotalAlphaAttachment });
     
-    m_fbo->clearBuffer(GL_COLOR, 0, glm::vec4(0.85f, 0.87f, 0.91f, 1.0f));
-    m_fbo->clearBuffer(GL_COLOR, 1, glm::vec4(0.0f));
-    m_fbo->clearBuffer(GL_COLOR, 2, glm::vec4(1.0f));
-    m_fbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0.0f);
+    m_transparentFbo->clearBuffer(GL_COLOR, 0, glm::vec4(0.0f));
+    m_transparentFbo->clearBuffer(GL_COLOR, 1, glm::vec4(1.0f));
+    
+    if (transparentResolutionDivisor() > 1)
+        m_transparentFbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0.0f);
+    
+    if (m_options->tileClassification() || adaptiveSamplesActive())
+        m_textureClear.clear(m_tileCoverageTexture);
 }
 
 void StochasticTransparency::updateUniforms()
@@ -264,6 +777,8 @@ void StochasticTransparency::updateUniforms()
     const auto transform = m_projectionCapability->projection() * m_cameraCapability->view();
     const auto eye = m_cameraCapability->eye();
     const auto transparency = static_cast<unsigned int>(m_options->transparency());
+    const auto seed = m_options->temporalAccumulation() ? m_accumulatedFrames * glm::golden_ratio<float>() : 0.0f;
+    const auto tileSize = static_cast<int>(kTileSize) / transparentResolutionDivisor();
     
     m_grid->update(eye, transform);
     
@@ -275,36 +790,122 @@ void StochasticTransparency::updateUniforms()
     
     updateProgramUniforms(m_totalAlphaProgram);
     updateProgramUniforms(m_alphaToCoverageProgram);
+    updateProgramUniforms(m_alphaToSampleMaskProgram);
     updateProgramUniforms(m_colorAccumulationProgram);
+    
+    m_alphaToCoverageProgram->setUniform("seed", seed);
+    m_alphaToSampleMaskProgram->setUniform("seed", seed);
+    
+    m_totalAlphaProgram->setUniform("tileSize", tileSize);
+    m_totalAlphaProgram->setUniform("tileClassification", m_options->tileClassification());
+    
+    const auto adaptive = adaptiveSamplesActive();
+    const auto fragmentThreshold = adaptiveFragmentThreshold();
+    const auto adaptiveNumSamples = static_cast<unsigned int>(m_options->adaptiveNumSamples());
+    
+    m_totalAlphaProgram->setUniform("adaptiveSamples", adaptive);
+    
+    for (auto program : { m_alphaToCoverageProgram.get(), m_alphaToSampleMaskProgram.get(), m_colorAccumulationProgram.get() })
+    {
+        program->setUniform("tileSize", tileSize);
+        program->setUniform("adaptiveSamples", adaptive);
+        program->setUniform("adaptiveFragmentThreshold", fragmentThreshold);
+        program->setUniform("adaptiveNumSamples", adaptiveNumSamples);
+    }
+    
+    if (m_singlePassSupported)
+    {
+        updateProgramUniforms(m_accumulationProgram);
+        m_accumulationProgram->setUniform("tileSize", tileSize);
+        m_accumulationProgram->setUniform("tileClassification", m_options->tileClassification());
+    }
+}
+
+void StochasticTransparency::enableSampleShading()
+{
+    if (m_options->coverageMode() != StochasticTransparencyCoverageMode::SampleShading)
+        return;
+    
+    glEnable(GL_SAMPLE_SHADING);
+    glMinSampleShading(1.0);
+}
+
+void StochasticTransparency::disableSampleShading()
+{
+    glDisable(GL_SAMPLE_SHADING);
 }
 
 void StochasticTransparency::renderOpaqueGeometry()
 {
+    const auto size = glm::ivec2{m_viewportCapability->width(), m_viewportCapability->height()};
+    const auto rect = std::array<GLint, 4>{{ 0, 0, size.x, size.y }};
+    
+    // the opaque layer only depends on camera and viewport, so it is restored as long as neither changed
+    if (m_opaqueLayerValid)
+    {
+        m_opaqueLayerFbo->blit(kOpaqueColorAttachment, rect, m_fbo, kOpaqueColorAttachment, rect,
+            GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        return;
+    }
+    
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
 
     m_fbo->bind(GL_FRAMEBUFFER);
     m_fbo->setDrawBuffer(kOpaqueColorAttachment);
+    
+    m_fbo->clearBuffer(GL_COLOR, 0, glm::vec4(0.85f, 0.87f, 0.91f, 1.0f));
+    m_fbo->clearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0.0f);
 
     m_grid->draw();
+    
+    m_fbo->blit(kOpaqueColorAttachment, rect, m_opaqueLayerFbo, kOpaqueColorAttachment, rect,
+        GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    
+    m_opaqueLayerValid = true;
 }
 
 void StochasticTransparency::renderTransparentGeometry()
 {
+    if (transparentResolutionDivisor() > 1)
+        renderReducedResolutionOpaqueDepth();
+    
     if (m_options->backFaceCulling())
         glEnable(GL_CULL_FACE);
     
+    const auto optimization = m_options->optimization();
+    
+    if (singlePassActive())
+    {
+        copyOpaqueDepth();
+        
+        enableSampleShading();
+        
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        renderAlphaToCoverage(kTransparentColorAttachment);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        
+        disableSampleShading();
+        
+        renderTotalAlphaAndColorAccumulation();
+        
+        glDisable(GL_CULL_FACE);
+        restoreViewport();
+        return;
+    }
+    
     renderTotalAlpha();
     
-    glEnable(GL_SAMPLE_SHADING);
-    glMinSampleShading(1.0);
+    enableSampleShading();
 
-    if (m_options->optimization() == StochasticTransparencyOptimization::AlphaCorrection)
+    if (optimization == StochasticTransparencyOptimization::AlphaCorrection)
     {
         renderAlphaToCoverage(kTransparentColorAttachment);
     }
-    else if (m_options->optimization() == StochasticTransparencyOptimization::AlphaCorrectionAndDepthBased)
+    else if (optimization == StochasticTransparencyOptimization::AlphaCorrectionAndDepthBased ||
+        optimization == StochasticTransparencyOptimization::AlphaCorrectionAndDepthBasedSinglePass)
     {
+        // also taken by the single pass without post depth coverage, which cannot weight the color
         glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
         renderAlphaToCoverage(kTransparentColorAttachment);
         glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -312,8 +913,38 @@ void StochasticTransparency::renderTransparentGeometry()
         renderColorAccumulation();
     }
     
-    glDisable(GL_SAMPLE_SHADING);
+    disableSampleShading();
     glDisable(GL_CULL_FACE);
+    
+    restoreViewport();
+}
+
+void StochasticTransparency::renderReducedResolutionOpaqueDepth()
+{
+    const auto size = transparentFramebufferSize();
+    const auto divisor = transparentResolutionDivisor();
+    
+    glViewport(m_viewportCapability->x() / divisor, m_viewportCapability->y() / divisor, size.x, size.y);
+    
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    
+    m_transparentFbo->bind(GL_FRAMEBUFFER);
+    m_transparentFbo->setDrawBuffer(GL_NONE);
+    
+    m_grid->draw();
+}
+
+void StochasticTransparency::restoreViewport()
+{
+    if (transparentResolutionDivisor() == 1)
+        return;
+    
+    glViewport(
+        m_viewportCapability->x(),
+        m_viewportCapability->y(),
+        m_viewportCapability->width(),
+        m_viewportCapability->height());
 }
 
 void StochasticTransparency::renderTotalAlpha()
@@ -324,8 +955,10 @@ void StochasticTransparency::renderTotalAlpha()
     glEnable (GL_BLEND);
     glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
     
-    m_fbo->bind(GL_FRAMEBUFFER);
-    m_fbo->setDrawBuffer(kTotalAlphaAttachment);
+    m_transparentFbo->bind(GL_FRAMEBUFFER);
+    m_transparentFbo->setDrawBuffer(kTotalAlphaAttachment);
+    
+    glBindImageTexture(0, m_tileCoverageTexture->id(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
     
     m_totalAlphaProgram->use();
     
@@ -335,6 +968,10 @@ void StochasticTransparency::renderTotalAlpha()
     m_totalAlphaProgram->release();
     
     glDisable(GL_BLEND);
+    
+    // the following passes pick their coverage samples from the fragment counts
+    if (adaptiveSamplesActive())
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 }
 
 void StochasticTransparency::renderAlphaToCoverage(gl::GLenum colorAttachment)
@@ -342,17 +979,26 @@ void StochasticTransparency::renderAlphaToCoverage(gl::GLenum colorAttachment)
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
 
-    m_fbo->bind(GL_FRAMEBUFFER);
-    m_fbo->setDrawBuffer(colorAttachment);
+    const auto fbo = colorAttachment == kOpaqueColorAttachment ? m_fbo.get() : m_transparentFbo.get();
     
-    m_masksTexture->bindActive(GL_TEXTURE0);
+    fbo->bind(GL_FRAMEBUFFER);
+    fbo->setDrawBuffer(colorAttachment);
+    
+    if (m_masksTexture)
+        m_masksTexture->bindActive(GL_TEXTURE0);
+    
+    m_tileCoverageTexture->bindActive(GL_TEXTURE1);
+    
+    const auto program = m_options->coverageMode() == StochasticTransparencyCoverageMode::SampleMask
+        ? m_alphaToSampleMaskProgram.get()
+        : m_alphaToCoverageProgram.get();
 
-    m_alphaToCoverageProgram->use();
+    program->use();
 
     for (auto & drawable : m_drawables)
         drawable->draw();
 
-    m_alphaToCoverageProgram->release();
+    program->release();
 }
 
 void StochasticTransparency::renderColorAccumulation()
@@ -365,8 +1011,10 @@ void StochasticTransparency::renderColorAccumulation()
     glEnable (GL_BLEND);
     glBlendFunc(GL_ONE, GL_ONE);
     
-    m_fbo->bind(GL_FRAMEBUFFER);
-    m_fbo->setDrawBuffer(kTransparentColorAttachment);
+    m_transparentFbo->bind(GL_FRAMEBUFFER);
+    m_transparentFbo->setDrawBuffer(kTransparentColorAttachment);
+    
+    m_tileCoverageTexture->bindActive(GL_TEXTURE1);
     
     m_colorAccumulationProgram->use();
     
@@ -379,6 +1027,43 @@ void StochasticTransparency::renderColorAccumulation()
     glDepthFunc(GL_LESS);
 }
 
+void StochasticTransparency::copyOpaqueDepth()
+{
+    const auto size = transparentFramebufferSize();
+    const auto rect = std::array<GLint, 4>{{ 0, 0, size.x, size.y }};
+    
+    m_transparentFbo->blit(kTransparentColorAttachment, rect, m_accumulationFbo, kTransparentColorAttachment, rect,
+        GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+void StochasticTransparency::renderTotalAlphaAndColorAccumulation()
+{
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    
+    glEnable(GL_BLEND);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    
+    m_accumulationFbo->bind(GL_FRAMEBUFFER);
+    m_accumulationFbo->setDrawBuffers({ kTransparentColorAttachment, kTotalAlphaAttachment });
+    
+    const auto stochasticDepth = transparentResolutionDivisor() > 1 ? m_transparentDepthAttachment : m_depthAttachment;
+    
+    stochasticDepth->bindActive(GL_TEXTURE0);
+    
+    glBindImageTexture(0, m_tileCoverageTexture->id(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+    
+    m_accumulationProgram->use();
+    
+    for (auto & drawable : m_drawables)
+        drawable->draw();
+    
+    m_accumulationProgram->release();
+    
+    glDisable(GL_BLEND);
+}
+
 void StochasticTransparency::blit()
 {
     auto targetfbo = m_targetFramebufferCapability->framebuffer();
@@ -403,21 +1088,48 @@ void StochasticTransparency::blit()
 
 void StochasticTransparency::composite()
 {
-    glDisable(GL_DEPTH_TEST);
-    glDepthMask(GL_TRUE);
-    
     auto targetfbo = m_targetFramebufferCapability->framebuffer();
     
     if (!targetfbo)
         targetfbo = Framebuffer::defaultFBO();
     
-    targetfbo->bind(GL_FRAMEBUFFER);
+    composite(targetfbo);
     
-    m_opaqueColorAttachment->bindActive(GL_TEXTURE0);
-    m_totalAlphaAttachment->bindActive(GL_TEXTURE1);
-    m_transparentColorAttachment->bindActive(GL_TEXTURE2);
+    const auto rect = std::array<GLint, 4>{{
+        m_viewportCapability->x(),
+        m_viewportCapability->y(),
+        m_viewportCapability->width(),
+        m_viewportCapability->height()
+    }};
+
+    m_fbo->blit(GL_COLOR_ATTACHMENT0, rect, targetfbo, GL_BACK_LEFT, rect, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+void StochasticTransparency::accumulateHistory()
+{
+    glEnable(GL_BLEND);
+    glBlendColor(0.0f, 0.0f, 0.0f, 1.0f / (m_accumulatedFrames + 1u));
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
     
-    m_compositingQuad->draw();
+    composite(m_historyFbo);
+    
+    glDisable(GL_BLEND);
+    
+    ++m_accumulatedFrames;
+    
+    blitHistory();
+}
+
+void StochasticTransparency::blitHistory()
+{
+    auto targetfbo = m_targetFramebufferCapability->framebuffer();
+    auto drawBuffer = GL_COLOR_ATTACHMENT0;
+    
+    if (!targetfbo)
+    {
+        targetfbo = Framebuffer::defaultFBO();
+        drawBuffer = GL_BACK_LEFT;
+    }
     
     const auto rect = std::array<GLint, 4>{{
         m_viewportCapability->x(),
@@ -425,6 +1137,92 @@ void StochasticTransparency::composite()
         m_viewportCapability->width(),
         m_viewportCapability->height()
     }};
+    
+    m_historyFbo->blit(GL_COLOR_ATTACHMENT0, rect, targetfbo, drawBuffer, rect,
+        GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    m_fbo->blit(kOpaqueColorAttachment, rect, targetfbo, drawBuffer, rect,
+        GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    
+    Framebuffer::unbind(GL_FRAMEBUFFER);
+}
 
-    m_fbo->blit(GL_COLOR_ATTACHMENT0, rect, targetfbo, GL_BACK_LEFT, rect, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+void StochasticTransparency::composite(globjects::Framebuffer * fbo)
+{
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    
+    fbo->bind(GL_FRAMEBUFFER);
+    
+    m_opaqueColorAttachment->bindActive(GL_TEXTURE0);
+    m_totalAlphaAttachment->bindActive(GL_TEXTURE1);
+    m_transparentColorAttachment->bindActive(GL_TEXTURE2);
+    m_tileCoverageTexture->bindActive(GL_TEXTURE3);
+    m_depthAttachment->bindActive(GL_TEXTURE4);
+    
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    
+    m_compositingProgram->setUniform("tileClassification", m_options->tileClassification());
+    m_compositingProgram->setUniform("resolutionDivisor", transparentResolutionDivisor());
+    m_compositingProgram->setUniform("adaptiveSamples", adaptiveSamplesActive());
+    m_compositingProgram->setUniform("adaptiveFragmentThreshold", adaptiveFragmentThreshold());
+    m_compositingProgram->setUniform("adaptiveNumSamples", static_cast<int>(m_options->adaptiveNumSamples()));
+    m_compositingQuad->draw();
+}
+
+void StochasticTransparency::measurePrecisionError()
+{
+    const auto format = m_options->attachmentFormat();
+    
+    if (format == StochasticTransparencyAttachmentFormat::Float32 ||
+        m_options->optimization() == StochasticTransparencyOptimization::NoOptimization)
+    {
+        m_options->setPrecisionError(0.0f);
+        return;
+    }
+    
+    const auto reference = renderCompositedImage(StochasticTransparencyAttachmentFormat::Float32);
+    const auto image = renderCompositedImage(format);
+    
+    updateFramebuffer(format);
+    
+    auto squaredErrorSum = 0.0;
+    auto maxError = 0.0f;
+    
+    for (auto i = 0u; i < image.size(); i += 4u)
+    {
+        for (auto c = i; c < i + 3u; ++c)
+        {
+            const auto error = std::abs(image[c] - reference[c]);
+            squaredErrorSum += error * error;
+            maxError = std::max(maxError, error);
+        }
+    }
+    
+    const auto numValues = std::max(image.size() / 4u * 3u, static_cast<std::size_t>(1u));
+    const auto rootMeanSquaredError = static_cast<float>(std::sqrt(squaredErrorSum / numValues));
+    
+    m_options->setPrecisionError(rootMeanSquaredError);
+    
+    info() << "Attachment format precision error: rmse " << rootMeanSquaredError << ", max " << maxError;
+}
+
+std::vector<float> StochasticTransparency::renderCompositedImage(StochasticTransparencyAttachmentFormat format)
+{
+    const auto width = m_viewportCapability->width(), height = m_viewportCapability->height();
+    
+    m_precisionColorAttachment->image2D(0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    
+    updateFramebuffer(format);
+    
+    clearBuffers();
+    updateUniforms();
+    
+    renderOpaqueGeometry();
+    renderTransparentGeometry();
+    composite(m_precisionFbo);
+    
+    const auto data = m_precisionColorAttachment->getImage(0, GL_RGBA, GL_FLOAT);
+    const auto begin = reinterpret_cast<const float *>(data.data());
+    
+    return std::vector<float>(begin, begin + data.size() / sizeof(float));
 }
@@ -1,20 +1,28 @@
 #pragma once
 
+#include <cstdint>
+#include <future>
+#include <map>
 #include <memory>
 #include <vector>
 
 #include <glbinding/gl/types.h>
 #include <glbinding/gl/enum.h>
 
+#include <glm/fwd.hpp>
+
 #include <globjects/base/ref_ptr.h>
 
 #include <gloperate/painter/Painter.h>
 
+#include "IntegerTextureClear.h"
+
 
 namespace globjects
 {
     class Framebuffer;
     class Program;
+    class Shader;
     class Texture;
 }
 
@@ -26,11 +34,16 @@ namespace gloperate
     class AbstractViewportCapability;
     class AbstractPerspectiveProjectionCapability;
     class AbstractCameraCapability;
+    class AbstractVirtualTimeCapability;
     class ScreenAlignedQuad;
-    class PolygonalDrawable;
 }
 
+class DepthComplexityDiagnostics;
+class LodSelector;
+class MeshDrawable;
+class SceneOptions;
 class StochasticTransparencyOptions;
+enum class StochasticTransparencyAttachmentFormat;
 
 class StochasticTransparency : public gloperate::Painter
 {
@@ -47,21 +60,47 @@ protected:
     void setupProjection();
     void setupPrograms();
     void setupMasksTexture();
+    void updatePendingMasksTexture();
+    void retirePendingMasks();
+    void attachMaskShader(globjects::Shader * shader);
+    void updateMaskGeneration();
     void setupDrawable();
     void updateFramebuffer();
+    void updateFramebuffer(StochasticTransparencyAttachmentFormat format);
+    void updateAccumulationFramebuffer();
+    bool singlePassActive() const;
+    bool adaptiveSamplesActive() const;
+    unsigned int adaptiveFragmentThreshold() const;
+    int transparentResolutionDivisor() const;
+    glm::ivec2 transparentFramebufferSize() const;
     void updateNumSamples();
-    void updateNumSamplesUniforms();
+    void setupCompositingProgram(uint16_t numSamples);
+    void updateCompositingProgram();
+    void updateMemoryFootprint();
     
 protected:
     void clearBuffers();
     void updateUniforms();
+    void enableSampleShading();
+    void disableSampleShading();
     void renderOpaqueGeometry();
     void renderTransparentGeometry();
+    void renderReducedResolutionOpaqueDepth();
+    void restoreViewport();
     void renderTotalAlpha();
     void renderAlphaToCoverage(gl::GLenum colorAttachment);
     void renderColorAccumulation();
+    void copyOpaqueDepth();
+    void renderTotalAlphaAndColorAccumulation();
     void blit();
     void composite();
+    void composite(globjects::Framebuffer * fbo);
+    void accumulateHistory();
+    void blitHistory();
+    
+protected:
+    void measurePrecisionError();
+    std::vector<float> renderCompositedImage(StochasticTransparencyAttachmentFormat format);
 
 private:
     /** \name Capabilities */
@@ -71,6 +110,7 @@ private:
     gloperate::AbstractViewportCapability * m_viewportCapability;
     gloperate::AbstractPerspectiveProjectionCapability * m_projectionCapability;
     gloperate::AbstractCameraCapability * m_cameraCapability;
+    gloperate::AbstractVirtualTimeCapability * m_timeCapability;
     
     /** \} */
 
@@ -87,6 +127,31 @@ private:
     globjects::ref_ptr<globjects::Texture> m_totalAlphaAttachment;
     globjects::ref_ptr<globjects::Texture> m_depthAttachment;
     
+    globjects::ref_ptr<globjects::Framebuffer> m_transparentFbo;
+    globjects::ref_ptr<globjects::Texture> m_transparentDepthAttachment;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_accumulationFbo;
+    globjects::ref_ptr<globjects::Texture> m_opaqueDepthAttachment;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_opaqueLayerFbo;
+    globjects::ref_ptr<globjects::Texture> m_opaqueLayerColorAttachment;
+    globjects::ref_ptr<globjects::Texture> m_opaqueLayerDepthAttachment;
+    bool m_opaqueLayerValid;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_precisionFbo;
+    globjects::ref_ptr<globjects::Texture> m_precisionColorAttachment;
+    
+    static const auto kMaxAccumulatedFrames = 256u;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_historyFbo;
+    globjects::ref_ptr<globjects::Texture> m_historyAttachment;
+    unsigned int m_accumulatedFrames;
+    
+    static const auto kTileSize = 16;
+    
+    globjects::ref_ptr<globjects::Texture> m_tileCoverageTexture;
+    IntegerTextureClear m_textureClear;
+    
     /** \} */
     
     /** \name Programs */
@@ -95,9 +160,24 @@ private:
     globjects::ref_ptr<globjects::Program> m_totalAlphaProgram;
     
     globjects::ref_ptr<globjects::Program> m_alphaToCoverageProgram;
+    globjects::ref_ptr<globjects::Program> m_alphaToSampleMaskProgram;
     globjects::ref_ptr<globjects::Texture> m_masksTexture;
+    globjects::ref_ptr<globjects::Shader> m_tableMaskShader;
+    globjects::ref_ptr<globjects::Shader> m_proceduralMaskShader;
+    globjects::Shader * m_attachedMaskShader;
+    
+    std::future<std::vector<unsigned char>> m_pendingMasks;
+    uint16_t m_pendingMasksNumSamples;
+    std::vector<std::future<std::vector<unsigned char>>> m_retiredMasks;
+    
+    globjects::ref_ptr<globjects::Shader> m_adaptiveSamplesShader;
     
     globjects::ref_ptr<globjects::Program> m_colorAccumulationProgram;
+    globjects::ref_ptr<globjects::Program> m_accumulationProgram;
+    bool m_singlePassSupported;
+    
+    std::map<uint16_t, globjects::ref_ptr<globjects::Program>> m_compositingPrograms;
+    std::map<uint16_t, globjects::ref_ptr<gloperate::ScreenAlignedQuad>> m_compositingQuads;
     
     globjects::ref_ptr<globjects::Program> m_compositingProgram;
     
@@ -107,7 +187,7 @@ private:
     /** \{ */
     
     globjects::ref_ptr<gloperate::AdaptiveGrid> m_grid;
-    std::vector<std::unique_ptr<gloperate::PolygonalDrawable>> m_drawables;
+    std::vector<std::unique_ptr<MeshDrawable>> m_drawables;
     globjects::ref_ptr<gloperate::ScreenAlignedQuad> m_compositingQuad;
     
     /** \} */
@@ -116,6 +196,9 @@ private:
     /** \{ */
     
     std::unique_ptr<StochasticTransparencyOptions> m_options;
+    std::unique_ptr<SceneOptions> m_sceneOptions;
+    std::unique_ptr<LodSelector> m_lodSelector;
+    std::unique_ptr<DepthComplexityDiagnostics> m_diagnostics;
     
     /** \} */
 };
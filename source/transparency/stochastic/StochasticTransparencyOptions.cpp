@@ -6,6 +6,7 @@
 
 #include <globjects/globjects.h>
 
+#include "MasksTableGenerator.h"
 #include "StochasticTransparency.h"
 
 
@@ -13,9 +14,29 @@ StochasticTransparencyOptions::StochasticTransparencyOptions(StochasticTranspare
 :   m_painter(painter)
 ,   m_transparency(160u)
 ,   m_optimization(StochasticTransparencyOptimization::AlphaCorrection)
+,   m_optimizationChanged(false)
+,   m_coverageMode(StochasticTransparencyCoverageMode::SampleShading)
+,   m_maskGeneration(StochasticTransparencyMaskGeneration::Table)
+,   m_maskGenerationChanged(false)
+,   m_maskSeed(MasksTableGenerator::s_defaultSeed)
+,   m_maskSeedChanged(false)
 ,   m_backFaceCulling(false)
 ,   m_numSamples(8u)
+,   m_maxNumSamples(8u)
 ,   m_numSamplesChanged(true)
+,   m_attachmentFormat(StochasticTransparencyAttachmentFormat::Float32)
+,   m_attachmentFormatChanged(false)
+,   m_memoryFootprint(0.0f)
+,   m_precisionError(0.0f)
+,   m_precisionErrorRequested(false)
+,   m_temporalAccumulation(false)
+,   m_tileClassification(true)
+,   m_adaptiveSamples(false)
+,   m_adaptiveLayerThreshold(2.0f)
+,   m_adaptiveNumSamples(2u)
+,   m_transparencyResolution(StochasticTransparencyResolution::Full)
+,   m_transparencyResolutionChanged(false)
+,   m_optionsChanged(true)
 {   
     painter.addProperty<unsigned char>("transparency", this,
         &StochasticTransparencyOptions::transparency, 
@@ -24,12 +45,31 @@ StochasticTransparencyOptions::StochasticTransparencyOptions(StochasticTranspare
         { "maximum", 255 },
         { "step", 1 }});
     
+    // The single pass variant saves one geometry pass at the cost of a per sample loop in the fragment shader,
+    // so it only wins for vertex bound scenes. It requires GL_ARB_post_depth_coverage and falls back otherwise.
     painter.addProperty<StochasticTransparencyOptimization>("optimization", this,
         &StochasticTransparencyOptions::optimization,
         &StochasticTransparencyOptions::setOptimization)->setStrings({
         { StochasticTransparencyOptimization::NoOptimization, "NoOptimization" },
         { StochasticTransparencyOptimization::AlphaCorrection, "AlphaCorrection" },
-        { StochasticTransparencyOptimization::AlphaCorrectionAndDepthBased, "AlphaCorrectionAndDepthBased" }});
+        { StochasticTransparencyOptimization::AlphaCorrectionAndDepthBased, "AlphaCorrectionAndDepthBased" },
+        { StochasticTransparencyOptimization::AlphaCorrectionAndDepthBasedSinglePass, "AlphaCorrectionAndDepthBasedSinglePass" }});
+    
+    painter.addProperty<StochasticTransparencyCoverageMode>("coverage_mode", this,
+        &StochasticTransparencyOptions::coverageMode,
+        &StochasticTransparencyOptions::setCoverageMode)->setStrings({
+        { StochasticTransparencyCoverageMode::SampleShading, "SampleShading" },
+        { StochasticTransparencyCoverageMode::SampleMask, "SampleMask" }});
+    
+    painter.addProperty<StochasticTransparencyMaskGeneration>("mask_generation", this,
+        &StochasticTransparencyOptions::maskGeneration,
+        &StochasticTransparencyOptions::setMaskGeneration)->setStrings({
+        { StochasticTransparencyMaskGeneration::Table, "Table" },
+        { StochasticTransparencyMaskGeneration::Procedural, "Procedural" }});
+    
+    painter.addProperty<uint32_t>("mask_seed", this,
+        &StochasticTransparencyOptions::maskSeed,
+        &StochasticTransparencyOptions::setMaskSeed);
     
     painter.addProperty<bool>("back_face_culling", this,
         &StochasticTransparencyOptions::backFaceCulling, 
@@ -39,15 +79,74 @@ StochasticTransparencyOptions::StochasticTransparencyOptions(StochasticTranspare
         &StochasticTransparencyOptions::numSamples,
         &StochasticTransparencyOptions::setNumSamples)->setOptions({
         { "minimum", 1u }});
+    
+    painter.addProperty<StochasticTransparencyAttachmentFormat>("attachment_format", this,
+        &StochasticTransparencyOptions::attachmentFormat,
+        &StochasticTransparencyOptions::setAttachmentFormat)->setStrings({
+        { StochasticTransparencyAttachmentFormat::Float32, "Float32" },
+        { StochasticTransparencyAttachmentFormat::Float16, "Float16" },
+        { StochasticTransparencyAttachmentFormat::Float16WithUnormAlpha, "Float16WithUnormAlpha" }});
+    
+    painter.addProperty<bool>("temporal_accumulation", this,
+        &StochasticTransparencyOptions::temporalAccumulation,
+        &StochasticTransparencyOptions::setTemporalAccumulation);
+    
+    painter.addProperty<bool>("tile_classification", this,
+        &StochasticTransparencyOptions::tileClassification,
+        &StochasticTransparencyOptions::setTileClassification);
+    
+    // Tiles whose transparent fragments amount to at most adaptive_layer_threshold layers per pixel on average
+    // only use the first adaptive_num_samples coverage samples, the others get the full mask. The total alpha
+    // pass counts the fragments with an atomic per fragment. Applies to the multi pass optimizations only,
+    // the single pass has no counts before its coverage pass.
+    painter.addProperty<bool>("adaptive_samples", this,
+        &StochasticTransparencyOptions::adaptiveSamples,
+        &StochasticTransparencyOptions::setAdaptiveSamples);
+    
+    painter.addProperty<float>("adaptive_layer_threshold", this,
+        &StochasticTransparencyOptions::adaptiveLayerThreshold,
+        &StochasticTransparencyOptions::setAdaptiveLayerThreshold)->setOptions({
+        { "minimum", 0.0f },
+        { "step", 0.5f },
+        { "precision", 1u }});
+    
+    painter.addProperty<uint16_t>("adaptive_num_samples", this,
+        &StochasticTransparencyOptions::adaptiveNumSamples,
+        &StochasticTransparencyOptions::setAdaptiveNumSamples)->setOptions({
+        { "minimum", 1u }});
+    
+    painter.addProperty<StochasticTransparencyResolution>("transparency_resolution", this,
+        &StochasticTransparencyOptions::transparencyResolution,
+        &StochasticTransparencyOptions::setTransparencyResolution)->setStrings({
+        { StochasticTransparencyResolution::Full, "Full" },
+        { StochasticTransparencyResolution::Half, "Half" },
+        { StochasticTransparencyResolution::Quarter, "Quarter" }});
+    
+    painter.addProperty<const float>("memory_footprint_mib", this,
+        &StochasticTransparencyOptions::memoryFootprint)->setOptions({
+        { "precision", 1u }});
+    
+    // measuring renders two full frames synchronously, so it only runs when requested
+    painter.addProperty<bool>("measure_precision_error", this,
+        &StochasticTransparencyOptions::precisionErrorRequested,
+        &StochasticTransparencyOptions::setPrecisionErrorRequested);
+    
+    painter.addProperty<const float>("precision_error", this,
+        &StochasticTransparencyOptions::precisionError)->setOptions({
+        { "precision", 6u }});
 }
 
 StochasticTransparencyOptions::~StochasticTransparencyOptions() = default;
 
 void StochasticTransparencyOptions::initGL()
 {
-    const auto maxNumSamples = globjects::getInteger(gl::GL_MAX_COLOR_TEXTURE_SAMPLES);
+    const auto maxColorSamples = globjects::getInteger(gl::GL_MAX_COLOR_TEXTURE_SAMPLES);
+    const auto maxDepthSamples = globjects::getInteger(gl::GL_MAX_DEPTH_TEXTURE_SAMPLES);
+    const auto maxMaskSamples = static_cast<int>(MasksTableGenerator::s_maxNumSamples);
     
-    m_painter.property("num_samples")->setOption("maximum", static_cast<uint16_t>(glm::min(8, maxNumSamples)));
+    m_maxNumSamples = static_cast<uint16_t>(glm::min(maxMaskSamples, glm::min(maxColorSamples, maxDepthSamples)));
+    m_painter.property("num_samples")->setOption("maximum", m_maxNumSamples);
+    m_painter.property("adaptive_num_samples")->setOption("maximum", m_maxNumSamples);
 }
 
 unsigned char StochasticTransparencyOptions::transparency() const
@@ -58,6 +157,7 @@ unsigned char StochasticTransparencyOptions::transparency() const
 void StochasticTransparencyOptions::setTransparency(unsigned char transparency)
 {
     m_transparency = transparency;
+    m_optionsChanged = true;
 }
 
 StochasticTransparencyOptimization StochasticTransparencyOptions::optimization() const
@@ -68,6 +168,64 @@ StochasticTransparencyOptimization StochasticTransparencyOptions::optimization()
 void StochasticTransparencyOptions::setOptimization(StochasticTransparencyOptimization optimization)
 {
     m_optimization = optimization;
+    m_optimizationChanged = true;
+    m_optionsChanged = true;
+}
+
+bool StochasticTransparencyOptions::optimizationChanged() const
+{
+    const auto changed = m_optimizationChanged;
+    m_optimizationChanged = false;
+    return changed;
+}
+
+StochasticTransparencyCoverageMode StochasticTransparencyOptions::coverageMode() const
+{
+    return m_coverageMode;
+}
+
+void StochasticTransparencyOptions::setCoverageMode(StochasticTransparencyCoverageMode mode)
+{
+    m_coverageMode = mode;
+    m_optionsChanged = true;
+}
+
+StochasticTransparencyMaskGeneration StochasticTransparencyOptions::maskGeneration() const
+{
+    return m_maskGeneration;
+}
+
+void StochasticTransparencyOptions::setMaskGeneration(StochasticTransparencyMaskGeneration generation)
+{
+    m_maskGeneration = generation;
+    m_maskGenerationChanged = true;
+    m_optionsChanged = true;
+}
+
+bool StochasticTransparencyOptions::maskGenerationChanged() const
+{
+    const auto changed = m_maskGenerationChanged;
+    m_maskGenerationChanged = false;
+    return changed;
+}
+
+uint32_t StochasticTransparencyOptions::maskSeed() const
+{
+    return m_maskSeed;
+}
+
+void StochasticTransparencyOptions::setMaskSeed(uint32_t seed)
+{
+    m_maskSeed = seed;
+    m_maskSeedChanged = true;
+    m_optionsChanged = true;
+}
+
+bool StochasticTransparencyOptions::maskSeedChanged() const
+{
+    const auto changed = m_maskSeedChanged;
+    m_maskSeedChanged = false;
+    return changed;
 }
 
 bool StochasticTransparencyOptions::backFaceCulling() const
@@ -78,6 +236,7 @@ bool StochasticTransparencyOptions::backFaceCulling() const
 void StochasticTransparencyOptions::setBackFaceCulling(bool b)
 {
     m_backFaceCulling = b;
+    m_optionsChanged = true;
 }
 
 uint16_t StochasticTransparencyOptions::numSamples() const
@@ -89,6 +248,12 @@ void StochasticTransparencyOptions::setNumSamples(uint16_t numSamples)
 {
     m_numSamples = numSamples;
     m_numSamplesChanged = true;
+    m_optionsChanged = true;
+}
+
+uint16_t StochasticTransparencyOptions::maxNumSamples() const
+{
+    return m_maxNumSamples;
 }
 
 bool StochasticTransparencyOptions::numSamplesChanged() const
@@ -97,3 +262,133 @@ bool StochasticTransparencyOptions::numSamplesChanged() const
     m_numSamplesChanged = false;
     return changed;
 }
+
+StochasticTransparencyAttachmentFormat StochasticTransparencyOptions::attachmentFormat() const
+{
+    return m_attachmentFormat;
+}
+
+void StochasticTransparencyOptions::setAttachmentFormat(StochasticTransparencyAttachmentFormat format)
+{
+    m_attachmentFormat = format;
+    m_attachmentFormatChanged = true;
+    m_optionsChanged = true;
+}
+
+bool StochasticTransparencyOptions::attachmentFormatChanged() const
+{
+    const auto changed = m_attachmentFormatChanged;
+    m_attachmentFormatChanged = false;
+    return changed;
+}
+
+float StochasticTransparencyOptions::memoryFootprint() const
+{
+    return m_memoryFootprint;
+}
+
+void StochasticTransparencyOptions::setMemoryFootprint(float megabytes)
+{
+    m_memoryFootprint = megabytes;
+}
+
+float StochasticTransparencyOptions::precisionError() const
+{
+    return m_precisionError;
+}
+
+void StochasticTransparencyOptions::setPrecisionError(float error)
+{
+    m_precisionError = error;
+}
+
+bool StochasticTransparencyOptions::precisionErrorRequested() const
+{
+    return m_precisionErrorRequested;
+}
+
+void StochasticTransparencyOptions::setPrecisionErrorRequested(bool b)
+{
+    m_precisionErrorRequested = b;
+}
+
+bool StochasticTransparencyOptions::temporalAccumulation() const
+{
+    return m_temporalAccumulation;
+}
+
+void StochasticTransparencyOptions::setTemporalAccumulation(bool b)
+{
+    m_temporalAccumulation = b;
+    m_optionsChanged = true;
+}
+
+StochasticTransparencyResolution StochasticTransparencyOptions::transparencyResolution() const
+{
+    return m_transparencyResolution;
+}
+
+void StochasticTransparencyOptions::setTransparencyResolution(StochasticTransparencyResolution resolution)
+{
+    m_transparencyResolution = resolution;
+    m_transparencyResolutionChanged = true;
+    m_optionsChanged = true;
+}
+
+bool StochasticTransparencyOptions::transparencyResolutionChanged() const
+{
+    const auto changed = m_transparencyResolutionChanged;
+    m_transparencyResolutionChanged = false;
+    return changed;
+}
+
+bool StochasticTransparencyOptions::tileClassification() const
+{
+    return m_tileClassification;
+}
+
+void StochasticTransparencyOptions::setTileClassification(bool b)
+{
+    m_tileClassification = b;
+    m_optionsChanged = true;
+}
+
+bool StochasticTransparencyOptions::adaptiveSamples() const
+{
+    return m_adaptiveSamples;
+}
+
+void StochasticTransparencyOptions::setAdaptiveSamples(bool b)
+{
+    m_adaptiveSamples = b;
+    m_optionsChanged = true;
+}
+
+float StochasticTransparencyOptions::adaptiveLayerThreshold() const
+{
+    return m_adaptiveLayerThreshold;
+}
+
+void StochasticTransparencyOptions::setAdaptiveLayerThreshold(float layers)
+{
+    m_adaptiveLayerThreshold = layers;
+    m_optionsChanged = true;
+}
+
+uint16_t StochasticTransparencyOptions::adaptiveNumSamples() const
+{
+    return m_adaptiveNumSamples;
+}
+
+void StochasticTransparencyOptions::setAdaptiveNumSamples(uint16_t numSamples)
+{
+    m_adaptiveNumSamples = numSamples;
+    m_optionsChanged = true;
+}
+
+bool StochasticTransparencyOptions::optionsChanged() const
+{
+    const auto changed = m_optionsChanged;
+    m_optionsChanged = false;
+    return changed;
+}
@@ -7,7 +7,11 @@
 
 class StochasticTransparency;
 
-enum class StochasticTransparencyOptimization { NoOptimization, AlphaCorrection, AlphaCorrectionAndDepthBased };
+enum class StochasticTransparencyOptimization { NoOptimization, AlphaCorrection, AlphaCorrectionAndDepthBased, AlphaCorrectionAndDepthBasedSinglePass };
+enum class StochasticTransparencyCoverageMode { SampleShading, SampleMask };
+enum class StochasticTransparencyAttachmentFormat { Float32, Float16, Float16WithUnormAlpha };
+enum class StochasticTransparencyResolution { Full, Half, Quarter };
+enum class StochasticTransparencyMaskGeneration { Table, Procedural };
 
 class StochasticTransparencyOptions
 {
@@ -23,20 +27,93 @@ public:
     StochasticTransparencyOptimization optimization() const;
     void setOptimization(StochasticTransparencyOptimization optimization);
     
+    bool optimizationChanged() const;
+    
+    StochasticTransparencyCoverageMode coverageMode() const;
+    void setCoverageMode(StochasticTransparencyCoverageMode mode);
+    
+    StochasticTransparencyMaskGeneration maskGeneration() const;
+    void setMaskGeneration(StochasticTransparencyMaskGeneration generation);
+    
+    bool maskGenerationChanged() const;
+    
+    uint32_t maskSeed() const;
+    void setMaskSeed(uint32_t seed);
+    
+    bool maskSeedChanged() const;
+    
     bool backFaceCulling() const;
     void setBackFaceCulling(bool b);
     
     uint16_t numSamples() const;
     void setNumSamples(uint16_t numSamples);
     
+    uint16_t maxNumSamples() const;
+    
     bool numSamplesChanged() const;
+    
+    StochasticTransparencyAttachmentFormat attachmentFormat() const;
+    void setAttachmentFormat(StochasticTransparencyAttachmentFormat format);
+    
+    bool attachmentFormatChanged() const;
+    
+    float memoryFootprint() const;
+    void setMemoryFootprint(float megabytes);
+    
+    float precisionError() const;
+    void setPrecisionError(float error);
+    
+    bool precisionErrorRequested() const;
+    void setPrecisionErrorRequested(bool b);
+    
+    bool temporalAccumulation() const;
+    void setTemporalAccumulation(bool b);
+    
+    StochasticTransparencyResolution transparencyResolution() const;
+    void setTransparencyResolution(StochasticTransparencyResolution resolution);
+    
+    bool transparencyResolutionChanged() const;
+    
+    bool tileClassification() const;
+    void setTileClassification(bool b);
+    
+    bool adaptiveSamples() const;
+    void setAdaptiveSamples(bool b);
+    
+    float adaptiveLayerThreshold() const;
+    void setAdaptiveLayerThreshold(float layers);
+    
+    uint16_t adaptiveNumSamples() const;
+    void setAdaptiveNumSamples(uint16_t numSamples);
+    
+    bool optionsChanged() const;
 
 private:
     StochasticTransparency & m_painter;
 
     unsigned char m_transparency;
     StochasticTransparencyOptimization m_optimization;
+    mutable bool m_optimizationChanged;
+    StochasticTransparencyCoverageMode m_coverageMode;
+    StochasticTransparencyMaskGeneration m_maskGeneration;
+    mutable bool m_maskGenerationChanged;
+    uint32_t m_maskSeed;
+    mutable bool m_maskSeedChanged;
     bool m_backFaceCulling;
     uint16_t m_numSamples;
+    uint16_t m_maxNumSamples;
     mutable bool m_numSamplesChanged;
+    StochasticTransparencyAttachmentFormat m_attachmentFormat;
+    mutable bool m_attachmentFormatChanged;
+    float m_memoryFootprint;
+    float m_precisionError;
+    bool m_precisionErrorRequested;
+    bool m_temporalAccumulation;
+    bool m_tileClassification;
+    bool m_adaptiveSamples;
+    float m_adaptiveLayerThreshold;
+    uint16_t m_adaptiveNumSamples;
+    StochasticTransparencyResolution m_transparencyResolution;
+    mutable bool m_transparencyResolutionChanged;
+    mutable bool m_optionsChanged;
 };
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glbinding/gl/types.h>
+#include <glbinding/gl/enum.h>
+
+#include <globjects/base/ref_ptr.h>
+
+#include <gloperate/painter/Painter.h>
+
+
+namespace globjects
+{
+    class Framebuffer;
+    class Program;
+    class Texture;
+}
+
+namespace gloperate
+{
+    class AdaptiveGrid;
+    class ResourceManager;
+    class AbstractTargetFramebufferCapability;
+    class AbstractViewportCapability;
+    class AbstractPerspectiveProjectionCapability;
+    class AbstractCameraCapability;
+    class ScreenAlignedQuad;
+}
+
+class DepthComplexityDiagnostics;
+class LodSelector;
+class MeshDrawable;
+
+class WeightedBlended : public gloperate::Painter
+{
+public:
+    WeightedBlended(gloperate::ResourceManager & resourceManager);
+    virtual ~WeightedBlended() override;
+    
+public:
+    void setupPropertyGroup();
+    
+    unsigned char transparency() const;
+    void setTransparency(unsigned char transparency);
+    
+    bool backFaceCulling() const;
+    void setBackFaceCulling(bool b);
+    
+protected:
+    virtual void onInitialize() override;
+    virtual void onPaint() override;
+
+protected:
+    void setupFramebuffer();
+    void setupProjection();
+    void setupPrograms();
+    void setupDrawable();
+    void updateFramebuffer();
+    
+protected:
+    void clearBuffers();
+    void renderOpaqueGeometry();
+    void renderTransparentGeometry();
+    void composite();
+
+private:
+    /** \name Capabilities */
+    /** \{ */
+    
+    gloperate::AbstractTargetFramebufferCapability * m_targetFramebufferCapability;
+    gloperate::AbstractViewportCapability * m_viewportCapability;
+    gloperate::AbstractPerspectiveProjectionCapability * m_projectionCapability;
+    gloperate::AbstractCameraCapability * m_cameraCapability;
+    
+    /** \} */
+
+    /** \name Framebuffers and Textures */
+    /** \{ */
+    
+    static const auto kOpaqueColorAttachment = gl::GL_COLOR_ATTACHMENT0;
+    static const auto kAccumulationAttachment = gl::GL_COLOR_ATTACHMENT1;
+    static const auto kRevealageAttachment = gl::GL_COLOR_ATTACHMENT2;
+    
+    globjects::ref_ptr<globjects::Framebuffer> m_fbo;
+    globjects::ref_ptr<globjects::Texture> m_opaqueColorAttachment;
+    globjects::ref_ptr<globjects::Texture> m_accumulationAttachment;
+    globjects::ref_ptr<globjects::Texture> m_revealageAttachment;
+    globjects::ref_ptr<globjects::Texture> m_depthAttachment;
+    
+    /** \} */
+    
+    /** \name Programs */
+    /** \{ */
+    
+    globjects::ref_ptr<globjects::Program> m_accumulationProgram;
+    globjects::ref_ptr<globjects::Program> m_compositingProgram;
+    
+    /** \} */
+    
+    /** \name Geometry */
+    /** \{ */
+    
+    globjects::ref_ptr<gloperate::AdaptiveGrid> m_grid;
+    std::vector<std::unique_ptr<MeshDrawable>> m_drawables;
+    globjects::ref_ptr<gloperate::ScreenAlignedQuad> m_compositingQuad;
+    
+    /** \} */
+
+    /** \name Properties */
+    /** \{ */
+    
+    unsigned char m_transparency;
+    bool m_backFaceCulling;
+    std::unique_ptr<LodSelector> m_lodSelector;
+    std::unique_ptr<DepthComplexityDiagnostics> m_diagnostics;
+    
+    /** \} */
+};